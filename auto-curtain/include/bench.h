@@ -0,0 +1,70 @@
+/**
+ * @file bench.h
+ * @brief 部品ごとのマイクロベンチマーク
+ *
+ * @details
+ * 同じベンチマークの定義（src/bench.cpp）を，実機ではコンソールの `bench` で，
+ * Linuxでは tools/bench_host.sh で走らせる．どちらも format() の同じ形式で
+ * 1回あたりの時間 [ns] とサイクル数を表示する．
+ * - 実機: 時間は esp_timer，サイクル数は CPU のサイクルカウンタ
+ * - ホスト: 時間は steady_clock，サイクル数は x86 なら TSC（それ以外は 0）
+ * 1件ごとに回数を倍にしながら MIN_DURATION_US を超えるまで回し，
+ * それを RUNS 回繰り返した最小値を結果にする（割り込みやタスク切り替えの分を除くため）．
+ * 実機だけで測るもの（FreeRTOSのキュー，esp_timer，Matterの属性）は add() で足す．
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace bench {
+
+// 1回の計測の最短時間 [us]
+const uint32_t MIN_DURATION_US = 20000;
+// 計測の繰り返し回数（最小値をとる）
+const uint8_t RUNS = 3;
+// add() で足せる数
+const uint8_t MAX_EXTRA_CASES = 8;
+
+/**
+ * @brief 測る処理．iterations 回繰り返す
+ */
+typedef void (*Body)(uint32_t iterations);
+
+/**
+ * @brief 結果
+ */
+struct Result {
+    const char *name;
+    uint32_t iterations;        ///< 最後の計測の回数
+    uint32_t ns_per_op_x100;    ///< 1回あたりの時間 [ns]（100倍）
+    uint32_t cycles_per_op_x100; ///< 1回あたりのサイクル数（100倍）
+};
+
+/**
+ * @brief ベンチマークを足す（実機だけで測るもの）
+ * @return 足せたらtrue
+ */
+bool add(const char *name, Body body);
+
+/**
+ * @brief ベンチマークを走らせる
+ * @param filter 名前にこの文字列を含むものだけ走らせる（nullptrなら全部）
+ * @param report 1件終わるごとに呼ばれる
+ */
+void run(const char *filter, void (*report)(const Result &result));
+
+/**
+ * @brief 結果を1行の文字列にする（実機とホストで同じ形式）
+ */
+void format(const Result &result, char *text, size_t size);
+
+/**
+ * @brief 値を計算したことにして，最適化で処理が消えないようにする
+ */
+template <typename T>
+inline void keep(const T &value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+} // namespace bench
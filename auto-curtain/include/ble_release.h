@@ -0,0 +1,40 @@
+/**
+ * @file ble_release.h
+ * @brief コミッショニングが済んだらBLEのスタックとコントローラーのメモリを手放す
+ *
+ * @details
+ * BLEはコミッショニング（CHIPoBLE）にしか使わないので，ファブリックが1つでもあれば
+ * 広告を止め，ホスト（NimBLE または Bluedroid）とコントローラーを止めて esp_bt_mem_release() でメモリを返す．
+ * 返したあとはBLEでのコミッショニングはできない（ファブリックの追加はオンネットワークの
+ * コミッショニング窓から行う．tools/capacity_test.sh も同じ方法で足している）．
+ * 最後のファブリックが消されたときは，再起動すればBLEが戻ってコミッショニングできる．
+ * 返したメモリの量はコンソールの `mem` で見られる．
+ */
+#pragma once
+
+#include <stddef.h>
+
+namespace ble_release {
+
+/**
+ * @brief 記録
+ */
+struct Stats {
+    bool released;      ///< BLEのメモリを返した
+    size_t heap_before; ///< 返す前の空きヒープ [byte]
+    size_t heap_after;  ///< 返した後の空きヒープ [byte]
+};
+
+/**
+ * @brief コミッショニング済みならBLEを止めてメモリを返す（2回目からは何もしない）
+ *
+ * CHIPのタスクから（kServerReady と kCommissioningComplete で）呼ぶこと．
+ */
+void release_if_commissioned();
+
+/**
+ * @brief 記録を取得する
+ */
+Stats stats();
+
+} // namespace ble_release
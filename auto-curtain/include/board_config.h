@@ -0,0 +1,93 @@
+/**
+ * @file board_config.h
+ * @brief ボードごとのピン割り当てとアナログ計測の換算係数
+ *
+ * @details
+ * platformio.ini の環境ごとに CURTAIN_BOARD_* を定義して切り替える．
+ * - CURTAIN_BOARD_XIAO_ESP32C3: Seeed XIAO ESP32C3（既定）
+ * - CURTAIN_BOARD_UPESY_WROOM: uPesy ESP32 Wroom DevKit
+ * 配線を変えたときはここだけを書き換えること．
+ * タスクの配置（コアと優先度）は task_layout.h を参照．
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#if defined(CURTAIN_BOARD_UPESY_WROOM)
+
+// PINを設定してください
+const int LED_PIN = 2;
+const int TOGGLE_BUTTON_PIN = 0;
+
+// モータードライバ（Hブリッジ）の入力．どちらもPWMで駆動する
+const int MOTOR_IN1_PIN = 25;
+const int MOTOR_IN2_PIN = 26;
+
+// モーター軸のエンコーダ（A相で割り込み，B相で回転方向を判定）
+const int ENCODER_A_PIN = 32;
+const int ENCODER_B_PIN = 33;
+
+// モーター電源電圧と電流のセンス入力（ADC1．ADC2はWi-Fiと同時に使えない）
+const int MOTOR_VOLTAGE_SENSE_PIN = 34;
+const int MOTOR_CURRENT_SENSE_PIN = 35;
+
+// 診断出力（diag_transport）のUART送信ピン
+const int DIAG_UART_TX_PIN = 17;
+
+// リモコンの受信機（remote_input）．つながっていなければ -1
+const int REMOTE_IR_PIN = 27; // IRの受光モジュール（38kHz，負論理）
+const int REMOTE_RF_PIN = 13; // 433MHzのASK受信機
+
+// ブリッジモード（bridge.h）のRS-485トランシーバー（UART2）．DEは送信の間だけHにする
+const int RS485_RX_PIN = 16;
+const int RS485_TX_PIN = 4;
+const int RS485_DE_PIN = 18;
+
+#else
+
+// PINを設定してください
+const int LED_PIN = D0;
+const int TOGGLE_BUTTON_PIN = D9;
+
+// モータードライバ（Hブリッジ）の入力．どちらもPWMで駆動する
+const int MOTOR_IN1_PIN = D3;
+const int MOTOR_IN2_PIN = D4;
+
+// モーター軸のエンコーダ（A相で割り込み，B相で回転方向を判定）
+// D6（GPIO21）は U0TXD で，起動中はROMがログを出すために駆動する．エンコーダの出力とぶつかるので入力には使わない．
+// D7（GPIO20）は U0RXD で，起動中も入力なのでB相に使える（Serial は USB CDC なのでUART0は使わない）
+const int ENCODER_A_PIN = D5;
+const int ENCODER_B_PIN = D7;
+
+// モーター電源電圧と電流のセンス入力（ADC）
+const int MOTOR_VOLTAGE_SENSE_PIN = A1;
+const int MOTOR_CURRENT_SENSE_PIN = A2;
+
+// 診断出力（diag_transport）のUART送信ピン（USB Serial/JTAGを使わないビルドのとき）
+// 出力なので U0TXD と共用する．起動直後はROMのログも同じ線に流れる
+const int DIAG_UART_TX_PIN = D6;
+
+// リモコンの受信機（remote_input）．つながっていなければ -1
+// GPIO8（D8）はストラッピングピンだが，IRの受光モジュールは待機中がHなので起動を妨げない
+const int REMOTE_IR_PIN = D8; // IRの受光モジュール（38kHz，負論理）
+const int REMOTE_RF_PIN = D10; // 433MHzのASK受信機
+
+// ブリッジモード（bridge.h）のRS-485トランシーバー．空いているピンがないので使えない
+const int RS485_RX_PIN = -1;
+const int RS485_TX_PIN = -1;
+const int RS485_DE_PIN = -1;
+#if defined(CURTAIN_BRIDGE_MODE)
+#error "CURTAIN_BRIDGE_MODE needs a board with free UART pins (upesy_wroom)"
+#endif
+
+#endif
+
+// 電圧センスの分圧比（実電圧 = ADC電圧 * NUM / DEN）
+const uint32_t VOLTAGE_SENSE_DIVIDER_NUM = 6;
+const uint32_t VOLTAGE_SENSE_DIVIDER_DEN = 1;
+
+// 電流センスアンプの感度 [mV/A]
+const uint32_t CURRENT_SENSE_MV_PER_A = 500;
+
+// カーテン全開から全閉までのエンコーダカウント数
+const int32_t CURTAIN_TRAVEL_COUNTS = 12000;
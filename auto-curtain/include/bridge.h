@@ -0,0 +1,44 @@
+/**
+ * @file bridge.h
+ * @brief ブリッジモード: RS-485のバスにつないだ多数のモーターを1台のMatterノードから動かす
+ *
+ * @details
+ * platformio.ini の env:upesy_wroom_bridge（CURTAIN_BRIDGE_MODE）でだけ使う．
+ * バスのモーター1台ごとに，アグリゲーターの下に WindowCovering のブリッジ先エンドポイントを作る
+ * （エンドポイントの作成と属性の反映は main.cpp）．
+ * バスの読み書きは専用のタスク（task_layout::BUS）が motor_bus::step() を回して行う．
+ * モーターの数，最初のスレーブアドレス，ボーレートはNVSに保存し，コンソールの
+ * `bus set <count> <first_address> <baud>` で変える（エンドポイントは起動時に作るので再起動で反映）．
+ */
+#pragma once
+
+#include <stdint.h>
+#include "motor_bus.h"
+
+namespace bridge {
+
+// 応答を待つ時間．つながっていないモーターは1周ごとにこれだけ時間を使う
+const uint32_t RESPONSE_TIMEOUT_US = 10000;
+// 設定がないときの値
+const uint8_t DEFAULT_MOTOR_COUNT = 0;
+const uint8_t DEFAULT_FIRST_ADDRESS = 1;
+const uint32_t DEFAULT_BAUD = 115200;
+
+/**
+ * @brief 設定を読み出し，モーターがあればRS-485を開いてバスのタスクを始める
+ * @return バスのモーターの数
+ */
+uint8_t begin();
+
+/**
+ * @brief 保存されている設定
+ */
+motor_bus::Config config();
+
+/**
+ * @brief 設定を保存する（次の起動から使う）
+ * @return 値が範囲外ならfalse
+ */
+bool set_config(uint8_t motor_count, uint8_t first_address, uint32_t baud);
+
+} // namespace bridge
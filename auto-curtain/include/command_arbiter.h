@@ -0,0 +1,83 @@
+/**
+ * @file command_arbiter.h
+ * @brief 移動指令の発行元と優先度による調停
+ *
+ * @details
+ * 移動指令はすべてここを通してから移動制御に渡す．
+ * - 優先度の高い指令（安全 > 原点出し > ローカル > スケジュール > リモート）は，
+ *   低い優先度の移動中でもすぐに割り込む．
+ * - 優先度の高い指令を受け付けてから一定時間（ホールドオフ）と，その移動が
+ *   終わるまでは，それより低い優先度の指令を受け付けない．
+ * - 原点出しの指令は，release() で解くまでそれより低い優先度の指令を受け付けない
+ *   （移動が終わってから位置を0にするまでの間に目標を差し替えられないように）．
+ * - 直前に受け付けた指令と同じ指令は移動制御に渡さずにまとめる．
+ * 受け付けた指令は次の制御周期で反映されるので，応答時間は制御周期で抑えられる．
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace command_arbiter {
+
+/**
+ * @brief 指令の発行元．値が小さいほど優先度が高い
+ */
+enum class Source : uint8_t {
+    SAFETY,   ///< 障害物検出（過電流）
+    HOMING,   ///< 原点出し
+    LOCAL,    ///< 本体のボタンやタッチ操作
+    SCHEDULE, ///< 本体のスケジュール
+    REMOTE,   ///< Matterコントローラー
+};
+
+/**
+ * @brief 指令の種類
+ */
+enum class Action : uint8_t {
+    MOVE_TO, ///< 目標位置へ移動
+    STOP,    ///< 停止
+};
+
+/**
+ * @brief 移動指令
+ */
+struct Command {
+    Source source;
+    Action action;
+    uint16_t position_100ths; ///< MOVE_TOの目標位置（0: 全開，10000: 全閉）
+};
+
+/**
+ * @brief 調停の結果
+ */
+enum class Result : uint8_t {
+    ACCEPTED,   ///< 移動制御に渡した
+    COLLAPSED,  ///< 直前の指令と同じなのでまとめた
+    SUPPRESSED, ///< 優先度の高い指令が有効なので捨てた
+};
+
+// 既定のホールドオフ時間 [ms]
+const uint32_t DEFAULT_HOLD_OFF_MS = 5000;
+
+/**
+ * @brief 指令を調停して，受け付けたら移動制御に渡す．どのタスクから呼んでもよい
+ *
+ * 移動制御の状態をシーケンスロックで読むので，割り込みやクリティカルセクションの中では呼ばないこと．
+ * @param command 移動指令
+ * @return 調停の結果
+ */
+Result submit(const Command &command);
+
+/**
+ * @brief 発行元 source の指令が有効なら，そのホールドオフを解く（原点出しが終わったとき）
+ * @param source 発行元
+ */
+void release(Source source);
+
+/**
+ * @brief ホールドオフ時間を設定する（リモート以外の発行元に適用する）
+ * @param hold_off_ms ホールドオフ時間 [ms]
+ */
+void set_hold_off_ms(uint32_t hold_off_ms);
+
+} // namespace command_arbiter
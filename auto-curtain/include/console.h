@@ -0,0 +1,17 @@
+/**
+ * @file console.h
+ * @brief シリアルコンソール（調整・デバッグ用のコマンド）
+ *
+ * @details
+ * 1行1コマンド．使えるコマンドは help で表示する．
+ */
+#pragma once
+
+namespace console {
+
+/**
+ * @brief 受信した文字を読み，1行そろっていればコマンドを実行する．loop()から呼ぶ
+ */
+void poll();
+
+} // namespace console
@@ -0,0 +1,31 @@
+/**
+ * @file device_flows.h
+ * @brief シーケンサで動かすカーテン本体のフロー（原点出し，LED，コミッショニング窓）
+ */
+#pragma once
+
+namespace device_flows {
+
+/**
+ * @brief フローをシーケンサに登録し，必要なら起動時の原点出しを始める
+ * @param position_known 前回止まった位置を復元できたらtrue（原点出しを省く）
+ */
+void begin(bool position_known);
+
+/**
+ * @brief 原点出しをやり直す
+ */
+void request_homing();
+
+/**
+ * @brief 原点出しの最中かどうか（原点出し中のストールは障害物として扱わず，位置の上書きを手で引かれたとみなさない）
+ */
+bool is_homing();
+
+/**
+ * @brief コミッショニング窓が開いた・閉じたことを知らせる．どのタスクから呼んでもよい
+ * @param open 開いたらtrue
+ */
+void notify_commissioning_window(bool open);
+
+} // namespace device_flows
@@ -0,0 +1,90 @@
+/**
+ * @file diag_transport.h
+ * @brief ログとトレースを非同期にまとめて送る診断出力
+ *
+ * @details
+ * 書き込み側（ログ，制御周期のトレース）はRAMのリングバッファにコピーするだけで，
+ * 待たされることはない．入りきらなければ捨てて数を数える．
+ * 低い優先度のタスクが，たまった分を大きなかたまりで出力先に吐き出す．
+ * このタスクは書き込みの通知で起きるので，何も書かれない間は起きない．
+ * - ESP32-C3（USB CDC On Boot）: 内蔵の USB Serial/JTAG（Serial）．ボーレートの制限がない．
+ * - それ以外: UART1（DIAG_UART_BAUD）．ドライバの送信バッファから割り込みでFIFOに詰める．
+ * 制御周期のトレースは trace_motion() で 0xFD から始まるフレームとして送る
+ * （tools/tlog_decode.py がCSVにして表示する）．
+ * コンソールの応答など人が読む文字列は console_output() に書く．
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Print;
+
+namespace diag_transport {
+
+// リングバッファの大きさ [byte]
+const size_t BUFFER_SIZE = 8192;
+// UARTを使うときのボーレート
+const uint32_t DIAG_UART_BAUD = 2000000;
+// トレースのフレームの先頭
+const uint8_t TRACE_FRAME_START = 0xFD;
+
+/**
+ * @brief 制御周期1回分のトレース
+ */
+struct MotionTrace {
+    uint32_t tick;        ///< 移動開始からの制御周期
+    int32_t position;     ///< 位置 [count]
+    int32_t setpoint;     ///< 指令位置 [count]
+    int16_t duty;         ///< 出力したデューティ
+    uint16_t current_ma;  ///< 電流 [mA]
+};
+
+/**
+ * @brief 統計
+ */
+struct Stats {
+    uint32_t sent_bytes;
+    uint32_t dropped_bytes;   ///< バッファがいっぱいで捨てた量
+    uint32_t max_used_bytes;  ///< バッファの使用量の最大
+};
+
+/**
+ * @brief 出力先を初期化して吐き出しのタスクを起動する
+ */
+void begin();
+
+/**
+ * @brief バッファに書き込む．どのタスクからでも，待たずに戻る
+ * @return 全部書けたらtrue（入りきらなければ何も書かない）
+ */
+bool write(const void *data, size_t length);
+
+/**
+ * @brief コンソールの応答など，人が読む文字列の出力先
+ *
+ * ESP32-C3 ではログとトレースも同じ Serial に出る．吐き出しのタスクはフレームの途中で区切って送るので，
+ * Serial に直接書くと 0xFE/0xFD のフレームの間に文字が割り込み，tools/tlog_decode.py が読めなくなる．
+ * そこで同じバッファを通す（1回の書き込みはフレームと混ざらない．入りきらなければ少し待つ）．
+ * それ以外では診断出力は UART1 に分かれているので，Serial をそのまま返す．
+ * 入力（available()，read()）は今までどおり Serial から読む．
+ */
+Print &console_output();
+
+/**
+ * @brief 制御周期のトレースを送るかどうか
+ */
+void set_trace_enabled(bool enabled);
+bool trace_enabled();
+
+/**
+ * @brief 制御周期のトレースを1件書き込む（制御周期から呼ぶ）
+ */
+void trace_motion(const MotionTrace &trace);
+
+/**
+ * @brief 統計を取得する
+ */
+Stats stats();
+
+} // namespace diag_transport
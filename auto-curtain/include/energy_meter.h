@@ -0,0 +1,66 @@
+/**
+ * @file energy_meter.h
+ * @brief モーターの電力量を移動ごとと累積で積算する
+ *
+ * @details
+ * 制御周期ごとに電圧・電流のサンプルを受け取り，固定小数点（整数）で積算する．
+ * サンプルごとのメモリ確保はしない．
+ * 単位は内部ではnJ，Matterへの公開はmWh（Electrical Energy Measurement クラスターの単位）．
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace energy_meter {
+
+/**
+ * @brief 積算値のスナップショット
+ */
+struct Totals {
+    uint64_t cumulative_nj; ///< 起動してからの累積電力量 [nJ]
+    uint64_t last_move_nj;  ///< 直前に完了した移動の電力量 [nJ]
+    uint32_t move_count;    ///< 完了した移動の回数
+};
+
+/**
+ * @brief 移動の開始を知らせる．移動中の積算値をクリアする
+ */
+void begin_move();
+
+/**
+ * @brief 電圧・電流のサンプルを1つ積算する．制御周期から呼ばれる
+ * @param voltage_mv 電圧 [mV]
+ * @param current_ma 電流 [mA]
+ * @param dt_us 前のサンプルからの経過時間 [us]
+ */
+void sample(uint32_t voltage_mv, uint32_t current_ma, uint32_t dt_us);
+
+/**
+ * @brief 移動の完了を知らせる．移動中の積算値を累積に足し込む
+ */
+void end_move();
+
+/**
+ * @brief 保存しておいた積算値から再開する．制御周期が動き出す前に呼ぶこと
+ */
+void restore(const Totals &saved);
+
+/**
+ * @brief 積算値を取得する
+ */
+Totals totals();
+
+/**
+ * @brief 前回呼んでから移動が完了していればtrueを返す（Matterへの報告用）
+ */
+bool take_pending_report();
+
+/**
+ * @brief nJをmWhに変換する（切り捨て）
+ */
+inline int64_t nj_to_mwh(uint64_t nj) {
+    // 1mWh = 3.6J = 3.6e9 nJ
+    return static_cast<int64_t>(nj / 3600000000ULL);
+}
+
+} // namespace energy_meter
@@ -0,0 +1,68 @@
+/**
+ * @file fixed_point.h
+ * @brief 固定小数点の演算（移動計画，グレア制御，予知保全で共有する）
+ *
+ * @details
+ * ESP32-C3 には浮動小数点ユニットがないので，制御やバックグラウンドの計算は整数で行う．
+ * - 角度は1周を 2^32 とする整数（BAM）
+ * - 三角関数の値は Q30
+ * Arduinoに依存しないので，ホストのベンチマーク（tools/bench_host.sh）でもそのまま使える．
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace fixed_point {
+
+const int32_t Q30_ONE = 1 << 30;
+const int32_t PI_HALF_Q30 = 1686629713;
+
+/**
+ * @brief Q30 どうしの積
+ */
+inline int32_t mul_q30(int32_t a, int32_t b) {
+    return static_cast<int32_t>((static_cast<int64_t>(a) * b) >> 30);
+}
+
+/**
+ * @brief sinとcosを求める（多項式近似．誤差は 1e-6 程度）
+ * @param angle 角度 [BAM]
+ */
+inline void sin_cos(uint32_t angle, int32_t *sin_out, int32_t *cos_out) {
+    // ±45度の範囲に寄せてから多項式で求め，象限で入れ替える
+    uint32_t quadrant = ((angle + (1u << 29)) >> 30) & 3;
+    int32_t rest = static_cast<int32_t>(angle - (quadrant << 30));
+    int32_t x = static_cast<int32_t>((static_cast<int64_t>(rest) * PI_HALF_Q30) >> 30);
+    int32_t x2 = mul_q30(x, x);
+    int32_t s = mul_q30(x, Q30_ONE - mul_q30(x2 / 6, Q30_ONE - mul_q30(x2 / 20, Q30_ONE - x2 / 42)));
+    int32_t c = Q30_ONE - mul_q30(x2 / 2, Q30_ONE - mul_q30(x2 / 12, Q30_ONE - mul_q30(x2 / 30, Q30_ONE - x2 / 56)));
+    switch (quadrant) {
+    case 0: *sin_out = s; *cos_out = c; break;
+    case 1: *sin_out = c; *cos_out = -s; break;
+    case 2: *sin_out = -s; *cos_out = -c; break;
+    default: *sin_out = -c; *cos_out = s; break;
+    }
+}
+
+/**
+ * @brief 整数の平方根（切り捨て）
+ */
+inline uint32_t isqrt(uint64_t value) {
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return static_cast<uint32_t>(root);
+}
+
+} // namespace fixed_point
@@ -0,0 +1,68 @@
+/**
+ * @file glare_control.h
+ * @brief 直射日光をさえぎる分だけカーテンを閉める（グレア制御モード）
+ *
+ * @details
+ * 設定した緯度・経度と窓の向きから太陽の方向を固定小数点で求め，
+ * 窓に日が差し込む割合に応じて目標位置を決める．
+ * - 赤緯と均時差は1日に1回だけ計算する．
+ * - 時角は更新のたびに一定の角度だけ回転させる（複素数の掛け算）ので，
+ *   1回の更新は掛け算十数回で済む．三角関数は日ごとの計算でだけ使う．
+ * - 窓の上のひさしの影を考え，日が差し込む割合 = 1 - ひさしの比 * tan(プロファイル角) とする．
+ * - 位置の変更は一定間隔ごとに，小さな幅に制限して行う．手で動かされたら，
+ *   日が窓から外れるまで調整をやめる．
+ * 1回の更新にかかったサイクル数を記録する（console の glare で確認できる）．
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace glare_control {
+
+/**
+ * @brief 設置場所と窓の設定
+ */
+struct Config {
+    bool enabled;
+    int32_t latitude_1e4;        ///< 緯度 [1e-4度]（北が正）
+    int32_t longitude_1e4;       ///< 経度 [1e-4度]（東が正）
+    int16_t window_azimuth_deg;  ///< 窓の外向きの方位 [度]（北0，東90，南180）
+    uint16_t overhang_percent;   ///< ひさしの出 / 窓の高さ [%]（0ならひさしなし）
+    uint16_t max_close_100ths;   ///< 日が一番差し込むときの位置（0: 全開，10000: 全閉）
+};
+
+/**
+ * @brief 計算の状態
+ */
+struct Stats {
+    int32_t sun_up_q30;          ///< 太陽方向の単位ベクトルの上成分（sin 高度）[Q30]
+    int32_t sun_east_q30;        ///< 同じく東成分 [Q30]
+    int32_t sun_north_q30;       ///< 同じく北成分 [Q30]
+    uint16_t sunlit_100ths;      ///< 窓に日が差し込む割合 [0.01%]
+    uint16_t target_100ths;      ///< 目標位置
+    bool overridden;             ///< 手で動かされたので調整を止めている
+    uint32_t last_cycles;        ///< 最後の更新にかかったサイクル数
+    uint32_t max_cycles;         ///< 更新にかかったサイクル数の最大
+};
+
+/**
+ * @brief 設定をNVSから読み出し，フローを登録する
+ */
+void begin();
+
+/**
+ * @brief 設定を取得する
+ */
+Config config();
+
+/**
+ * @brief 設定を変更する（NVSに保存し，次の更新で太陽の位置を計算し直す）．loopタスクから呼ぶこと
+ */
+void set_config(const Config &config);
+
+/**
+ * @brief 計算の状態を取得する
+ */
+Stats stats();
+
+} // namespace glare_control
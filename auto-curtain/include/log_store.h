@@ -0,0 +1,59 @@
+/**
+ * @file log_store.h
+ * @brief 頻繁に変わる値（位置，積算値など）を専用パーティションに追記していくストア
+ *
+ * @details
+ * NVSは更新のたびにエントリを書き直してガベージコレクションが走るので，
+ * 移動のたびに変わる値には向かない．ここでは値をキーごとの小さなレコードとして
+ * パーティション（curtainlog）の末尾に追記するだけにする．
+ * - 書き込みは常に追記なので一定時間で，セクタを順番に使うので摩耗も均等になる．
+ * - 起動時に全セクタを1回順に読んで，キーごとに最新のレコードの位置をRAMの索引に持つ．
+ * - 古いセクタの詰め直し（生きているレコードを末尾に写して消去）は
+ *   シーケンサのフローで少しずつ行う．
+ * 書き込みと詰め直しはloopタスクからだけ行うこと．
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace log_store {
+
+// キーの数と値の最大長
+const uint8_t MAX_KEYS = 16;
+const uint8_t MAX_VALUE_LENGTH = 32;
+
+// キーの割り当て
+const uint8_t KEY_POSITION = 0;      ///< 最後に止まった位置 [count]（int32_t）
+const uint8_t KEY_ENERGY_TOTALS = 1; ///< 電力量の積算値（energy_meter::Totals）
+
+/**
+ * @brief パーティションを走査して索引を作り，詰め直しのフローを登録する
+ * @return パーティションが見つかればtrue
+ */
+bool begin();
+
+/**
+ * @brief 値を書き込む（追記する）
+ * @param key キー（MAX_KEYS 未満）
+ * @param value 値
+ * @param length 値の長さ（MAX_VALUE_LENGTH 以下）
+ * @return 書き込めたらtrue
+ */
+bool write(uint8_t key, const void *value, size_t length);
+
+/**
+ * @brief 最新の値を読む
+ * @param key キー
+ * @param value 格納先
+ * @param length 格納先の長さ．記録された長さと一致しなければ失敗する
+ * @return 読めたらtrue
+ */
+bool read(uint8_t key, void *value, size_t length);
+
+/**
+ * @brief 使えるセクタ（消去済み）の数．詰め直しの進み具合の確認用
+ */
+uint16_t free_sectors();
+
+} // namespace log_store
@@ -0,0 +1,76 @@
+/**
+ * @file maintenance.h
+ * @brief 移動ごとの統計から，レールやモーターの劣化の兆候を見つける（予知保全）
+ *
+ * @details
+ * 移動が終わるたびに，全行程あたりの移動時間，電流の最大値，ストールの有無を受け取り，
+ * サンプルを溜めずに1回あたりO(1)で統計を更新する．
+ * - 設置直後の BASELINE_MOVES 回は Welford 法で平均と分散を求め，基準とする．
+ * - 以後は指数移動平均（EWMA）で最近の傾向を追う．
+ * - 傾向が基準の平均 + max(3σ, 平均の15%) を超えたら，またはストールの率が
+ *   10%を超えたら保守フラグを立てる．
+ * 基準と傾向はNVSに保存する．部品を交換したら reset() で基準を取り直す．
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace maintenance {
+
+// 基準を求める移動の回数
+const uint16_t BASELINE_MOVES = 100;
+
+// 保守フラグ（ビット）
+const uint8_t FLAG_TRAVEL_TIME_RISING = 1 << 0;  ///< 移動にかかる時間が延びている（摩擦の増加など）
+const uint8_t FLAG_PEAK_CURRENT_RISING = 1 << 1; ///< 電流の最大値が増えている
+const uint8_t FLAG_FREQUENT_STALLS = 1 << 2;     ///< ストールが増えている
+
+/**
+ * @brief Welford法の途中経過（固定小数点．値は Q8）
+ */
+struct Welford {
+    uint32_t count;
+    int64_t mean_q8;
+    uint64_t m2_q8;   ///< 偏差の2乗和 [Q8]
+};
+
+/**
+ * @brief 統計
+ */
+struct Stats {
+    Welford travel_time;        ///< 全行程あたりの移動時間 [ms] の基準
+    Welford peak_current;       ///< 電流の最大値 [mA] の基準
+    int64_t travel_time_ewma_q8;
+    int64_t peak_current_ewma_q8;
+    uint32_t stall_rate_q16;    ///< ストールの率の EWMA [Q16]
+    uint32_t move_count;        ///< 統計に入れた移動の数
+    uint8_t flags;              ///< 保守フラグ
+};
+
+/**
+ * @brief NVSから統計を読み戻す
+ */
+void begin();
+
+/**
+ * @brief 移動の完了を見て統計を更新する．loop()から定期的に呼ぶ
+ * @return 保守フラグか傾向が変わったらtrue（Matterへの報告用）
+ */
+bool poll();
+
+/**
+ * @brief 統計を取得する
+ */
+Stats stats();
+
+/**
+ * @brief 基準の標準偏差（Q8 の分散から求める．表示用）
+ */
+uint32_t stddev(const Welford &welford);
+
+/**
+ * @brief 統計を消して基準を取り直す
+ */
+void reset();
+
+} // namespace maintenance
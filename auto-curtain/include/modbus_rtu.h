@@ -0,0 +1,88 @@
+/**
+ * @file modbus_rtu.h
+ * @brief Modbus RTU のフレームの組み立てと解析（マスター側）
+ *
+ * @details
+ * 使う機能コードだけを扱う．
+ * - 0x03 Read Holding Registers
+ * - 0x06 Write Single Register
+ * - 0x10 Write Multiple Registers
+ * フレームは アドレス, 機能コード, データ, CRC16（下位バイトから）．
+ * Arduinoに依存しないので，ホストの模擬バス（tools/bus_sim）でもそのまま使う．
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace modbus_rtu {
+
+const uint8_t READ_HOLDING_REGISTERS = 0x03;
+const uint8_t WRITE_SINGLE_REGISTER = 0x06;
+const uint8_t WRITE_MULTIPLE_REGISTERS = 0x10;
+// 例外応答は機能コードの最上位ビットが立つ
+const uint8_t EXCEPTION_FLAG = 0x80;
+// ブロードキャスト（全スレーブ．応答はない）
+const uint8_t BROADCAST_ADDRESS = 0;
+
+// フレームの最大長（仕様上は256バイト．ここでは使う分だけ）
+const size_t MAX_FRAME_SIZE = 64;
+// 1回の読み書きのレジスタ数の上限
+const uint8_t MAX_REGISTERS = 16;
+
+/**
+ * @brief 応答の解析結果
+ */
+enum class Status : uint8_t {
+    OK,
+    BAD_CRC,       ///< CRCが合わない（雑音，衝突）
+    BAD_FRAME,     ///< 長さやアドレス，機能コードが要求と合わない
+    EXCEPTION,     ///< スレーブが例外応答を返した
+};
+
+/**
+ * @brief CRC16（多項式 0xA001，初期値 0xFFFF）
+ */
+uint16_t crc16(const uint8_t *data, size_t length);
+
+/**
+ * @brief Read Holding Registers の要求を組み立てる
+ * @return フレームの長さ
+ */
+size_t read_registers(uint8_t *frame, uint8_t address, uint16_t first, uint8_t count);
+
+/**
+ * @brief Write Single Register の要求を組み立てる
+ */
+size_t write_register(uint8_t *frame, uint8_t address, uint16_t reg, uint16_t value);
+
+/**
+ * @brief Write Multiple Registers の要求を組み立てる
+ */
+size_t write_registers(uint8_t *frame, uint8_t address, uint16_t first, const uint16_t *values, uint8_t count);
+
+/**
+ * @brief 要求に対して期待する応答の長さ（受信を早く切り上げるのに使う）
+ */
+size_t expected_response_size(const uint8_t *request);
+
+/**
+ * @brief 応答を解析する
+ * @param request 送った要求
+ * @param response 受け取った応答
+ * @param length 応答の長さ
+ * @param values Read Holding Registers のときに読んだ値の格納先（要求したレジスタ数分）
+ */
+Status parse_response(const uint8_t *request, const uint8_t *response, size_t length, uint16_t *values);
+
+/**
+ * @brief 文字数から送受信にかかる時間 [us]（1文字11ビット: スタート，8データ，パリティ，ストップ）
+ */
+uint32_t frame_time_us(size_t characters, uint32_t baud);
+
+/**
+ * @brief フレームの間に空ける時間 t3.5 [us]（19200bps を超えると 1750us に固定）
+ */
+uint32_t inter_frame_gap_us(uint32_t baud);
+
+} // namespace modbus_rtu
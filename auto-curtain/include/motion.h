@@ -0,0 +1,199 @@
+/**
+ * @file motion.h
+ * @brief カーテンの移動制御（台形速度プロファイル + 位置フィードバック）
+ *
+ * @details
+ * 制御周期（CONTROL_PERIOD_US）ごとにesp_timerが移動制御タスクを起こして制御処理を行う．
+ * タスクのコアと優先度はボードごとに task_layout.h で決める．
+ * 停止中はタイマーを止めるので，ライトスリープを妨げない．
+ * 移動指令は別タスク（Matterやloop）から受け取り，次の制御周期で反映する．
+ * 移動パラメータは2面バッファで持ち，実行中でも区間の境目で切り替える．
+ * 制御周期の側はロックを取らない．
+ * 位置・速度・状態は制御周期ごとにシーケンスロックで公開するので，
+ * 他のタスクは割り込みを禁止せずにそろったスナップショットを読める．
+ * 位置はエンコーダのカウント数で持ち，Matterへは 0（全開）〜10000（全閉）の
+ * percent100ths に換算して公開する．
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace motion {
+
+// 制御周期 [us]
+const uint32_t CONTROL_PERIOD_US = 1000;
+
+// Matterの位置の最大値（全閉）
+const uint16_t POSITION_100THS_MAX = 10000;
+
+/**
+ * @brief 移動制御の状態
+ */
+enum class State : uint8_t {
+    IDLE,    ///< 停止中
+    MOVING,  ///< 移動中
+    STALLED, ///< 過電流で停止した
+};
+
+/**
+ * @brief 移動のパラメータ
+ */
+struct Params {
+    uint32_t max_speed_cps;    ///< 最高速度 [count/s]
+    uint32_t accel_cps2;       ///< 加速度 [count/s^2]
+    int16_t max_duty;          ///< デューティの上限
+    uint16_t current_limit_ma; ///< この電流を超え続けたらストールとみなす [mA]
+    uint16_t kp;               ///< 位置偏差1カウントあたりのデューティ
+    uint16_t kff;              ///< 速度 1count/tick あたりのデューティ（フィードフォワード）
+};
+
+/**
+ * @brief 台形プロファイルの区間（加速・定速・減速）
+ */
+struct Segment {
+    uint32_t ticks;     ///< 区間の長さ [制御周期]
+    int32_t accel_q16;  ///< 1周期あたりの速度変化 [count/tick, Q16]
+};
+
+/**
+ * @brief 1回の移動の計画と進行状況
+ */
+struct Plan {
+    static const uint8_t SEGMENT_COUNT = 3;
+    Segment segments[SEGMENT_COUNT];
+    uint8_t index;         ///< 実行中の区間（SEGMENT_COUNTなら目標位置への整定中）
+    uint32_t remaining;    ///< 実行中の区間の残り周期
+    int32_t velocity_q16;  ///< 指令速度 [count/tick, Q16]
+    int64_t setpoint_q16;  ///< 指令位置 [count, Q16]
+    int32_t target;        ///< 目標位置 [count]
+    int8_t direction;      ///< +1: 閉方向，-1: 開方向
+};
+
+/**
+ * @brief 他のタスクへ公開する移動制御の状態
+ */
+struct Snapshot {
+    int32_t position_counts;  ///< 公開した時点の位置 [count]
+    int32_t velocity_q16;     ///< 指令速度（閉方向が正）[count/tick, Q16]
+    int32_t target_counts;    ///< 目標位置 [count]
+    uint32_t last_move_ticks; ///< 直前に完了した移動の長さ [制御周期]
+    uint32_t last_move_counts; ///< 直前に完了した移動の距離（始点から終点まで）[count]
+    uint32_t last_move_peak_ma; ///< 直前に完了した移動での電流の最大値 [mA]
+    bool last_move_stalled;   ///< 直前に完了した移動がストールで終わった（state と違い，次の移動が始まっても残る）
+    uint32_t move_count;      ///< 完了した移動の数（ストールを含む）
+    State state;
+    int8_t direction;         ///< +1: 閉方向，-1: 開方向，0: 停止中
+};
+
+/**
+ * @brief 制御周期のタイミングの計測値
+ */
+struct TimingStats {
+    uint32_t max_jitter_us;           ///< 周期のゆらぎの最大値 [us]
+    uint32_t last_command_latency_us; ///< 直前の指令が制御周期に反映されるまでの時間 [us]
+    uint32_t max_command_latency_us;  ///< その最大値 [us]
+};
+
+/**
+ * @brief 既定の移動パラメータ
+ */
+Params default_params();
+
+/**
+ * @brief 現在位置から目標位置までの台形プロファイルを計算する
+ * @param from 現在位置 [count]
+ * @param to 目標位置 [count]
+ * @param params 移動パラメータ
+ * @param initial_velocity_q16 目標に向かう向きの初速 [count/tick, Q16]
+ * @return 移動計画
+ */
+Plan plan_move(int32_t from, int32_t to, const Params &params, int32_t initial_velocity_q16 = 0);
+
+/**
+ * @brief モーター，エンコーダ，制御周期タイマーを初期化して制御を開始する
+ */
+void begin();
+
+/**
+ * @brief 最後に設定した移動パラメータを取得する
+ */
+Params params();
+
+/**
+ * @brief 移動パラメータを更新する．移動中なら次の区間の境目から反映する
+ * @param new_params 移動パラメータ
+ */
+void set_params(const Params &new_params);
+
+/**
+ * @brief 直前に完了した移動にかかった時間 [ms]
+ */
+uint32_t last_move_ms();
+
+/**
+ * @brief 目標位置への移動を指令する．移動中なら目標を差し替える
+ * @param position_100ths 目標位置（0: 全開，10000: 全閉）
+ */
+void move_to(uint16_t position_100ths);
+
+/**
+ * @brief 移動を止める
+ */
+void stop();
+
+/**
+ * @brief 現在位置を取得する
+ * @return 現在位置（0: 全開，10000: 全閉）
+ */
+uint16_t position_100ths();
+
+/**
+ * @brief 制御周期が最後に公開した状態を取得する．どのタスクから呼んでもよい
+ *
+ * 公開の途中だと少し待つことがあるので，割り込みやクリティカルセクションの中では呼ばないこと（state() なども同じ）．
+ */
+Snapshot snapshot();
+
+/**
+ * @brief 現在位置をエンコーダのカウント数で取得する
+ */
+int32_t position_counts();
+
+/**
+ * @brief 現在位置をエンコーダのカウント数で上書きする（原点出し用）
+ * @param counts 現在位置 [count]
+ */
+void set_position_counts(int32_t counts);
+
+/**
+ * @brief 移動方向を取得する
+ * @return +1: 閉方向，-1: 開方向，0: 停止中
+ */
+int8_t direction();
+
+/**
+ * @brief 移動制御の状態を取得する
+ */
+State state();
+
+/**
+ * @brief 制御周期のタイミングの計測値を取得する
+ */
+TimingStats timing_stats();
+
+/**
+ * @brief タイミングの最大値をリセットする
+ */
+void reset_timing_stats();
+
+/**
+ * @brief カウント数を percent100ths に換算する
+ */
+uint16_t counts_to_100ths(int32_t counts);
+
+/**
+ * @brief percent100ths をカウント数に換算する
+ */
+int32_t percent100ths_to_counts(uint16_t position_100ths);
+
+} // namespace motion
@@ -0,0 +1,37 @@
+/**
+ * @file motor.h
+ * @brief Hブリッジ経由のDCモーター駆動と電圧・電流の計測
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace motor {
+
+// PWMのデューティ最大値（10bit）
+const int16_t DUTY_MAX = 1023;
+
+/**
+ * @brief PWMとセンス入力を初期化する
+ */
+void begin();
+
+/**
+ * @brief モーターを駆動する
+ * @param duty 符号付きデューティ（正: 閉方向，負: 開方向，0: ブレーキ）
+ */
+void drive(int16_t duty);
+
+/**
+ * @brief モーター電源電圧を読む
+ * @return 電圧 [mV]
+ */
+uint32_t read_voltage_mv();
+
+/**
+ * @brief モーター電流を読む
+ * @return 電流 [mA]
+ */
+uint32_t read_current_ma();
+
+} // namespace motor
@@ -0,0 +1,116 @@
+/**
+ * @file motor_bus.h
+ * @brief RS-485（Modbus RTU）のバスにつないだモーターコントローラーを順に読み書きするマスター
+ *
+ * @details
+ * ブリッジモード（bridge.h）で，1台のMatterノードから多数のカーテンを動かすのに使う．
+ * step() が1回のトランザクション（要求と応答）を行う．バスのタスクから繰り返し呼ぶこと．
+ * - 目標位置や停止の書き込みは，状態の読み出しより先に行う（指令の遅れを1トランザクションに抑える）．
+ *   全モーターに同じ目標が来たとき（グループやシーンの指令）はブロードキャスト1回にまとめる．
+ * - 書き込みがなければ，モーターを順番に1回ずつ読む（位置と状態を1回の要求でまとめて読む）．
+ * - 応答は期待する長さがそろった時点で受け取りを終え，次の要求の組み立てと状態の公開を
+ *   フレーム間の t3.5 の待ちの間に済ませる．
+ * したがって1周の時間はおよそ モーター数 × (要求 + 応答 + 応答の遅れ + t3.5) で，モーター数に比例する．
+ * 115200bps（8E1）では1台あたり約 3.4ms（要求 0.8ms，応答 0.9ms，t3.5 1.75ms）+ コントローラーの応答の遅れ．
+ * 送受信は Transport で差し替えられるので，ホストでは模擬バス（tools/bus_sim）で動かせる．
+ * 状態は1台ずつシーケンスロックで公開するので，どのタスクからでも待たずに読める．
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace motor_bus {
+
+const uint8_t MAX_MOTORS = 32;
+
+// モーターコントローラーのレジスタ（Holding Register）
+const uint16_t REG_TARGET = 0;   ///< 目標位置 [0.01%]（0: 全開，10000: 全閉）．書くと動き出す
+const uint16_t REG_COMMAND = 1;  ///< COMMAND_* を書く
+const uint16_t REG_POSITION = 2; ///< 現在位置 [0.01%]
+const uint16_t REG_STATUS = 3;   ///< STATUS_* の組み合わせ
+const uint16_t COMMAND_STOP = 1;
+const uint16_t STATUS_MOVING = 1 << 0;
+const uint16_t STATUS_CLOSING = 1 << 1; ///< STATUS_MOVING のときの向き
+const uint16_t STATUS_FAULT = 1 << 2;   ///< 過電流などで止まった
+
+// 連続でこの回数応答がなければ到達できないとみなす
+const uint8_t OFFLINE_FAILURES = 3;
+
+/**
+ * @brief 送受信の手段
+ */
+struct Transport {
+    /// 要求を送る（送り終わるまで待つ）
+    void (*send)(const uint8_t *frame, size_t length);
+    /// 応答を受け取る．expected バイトそろうか timeout_us が過ぎたら戻る
+    size_t (*receive)(uint8_t *frame, size_t capacity, size_t expected, uint32_t timeout_us);
+    /// 現在時刻 [us]
+    uint32_t (*now_us)();
+    /// この時刻まで待つ [us]
+    void (*wait_until_us)(uint32_t time_us);
+};
+
+/**
+ * @brief バスの設定
+ */
+struct Config {
+    uint8_t motor_count;          ///< モーターの数（MAX_MOTORS まで）
+    uint8_t first_address;        ///< 最初のモーターのスレーブアドレス（以降は連番）
+    uint32_t baud;                ///< ボーレート
+    uint32_t response_timeout_us; ///< 応答を待つ時間
+};
+
+/**
+ * @brief 1台のモーターの状態
+ */
+struct MotorState {
+    uint16_t position_100ths; ///< 現在位置 [0.01%]
+    uint16_t status;          ///< STATUS_*
+    bool reachable;           ///< 応答している
+    uint32_t updated_us;      ///< 最後に応答を受けた時刻
+};
+
+/**
+ * @brief バスの統計
+ */
+struct Stats {
+    uint32_t transactions;
+    uint32_t timeouts;
+    uint32_t errors;                 ///< CRCの誤りや例外応答
+    uint32_t cycle_us;               ///< 全モーターを1周読むのにかかった時間（直近）
+    uint32_t max_age_us;             ///< 1周の終わりでの，状態の古さの最大
+    uint32_t last_command_latency_us; ///< 目標を受けてから書き込みが終わるまで（直近）
+    uint32_t max_command_latency_us;
+    uint8_t utilisation_percent;     ///< 回線が使われている時間の割合（直近の1周）
+};
+
+/**
+ * @brief 設定と送受信の手段を決める．以後 step() を繰り返し呼ぶ
+ */
+void begin(const Config &config, const Transport &transport);
+
+/**
+ * @brief トランザクションを1回行う（バスのタスクから呼ぶ）
+ */
+void step();
+
+/**
+ * @brief 目標位置を指令する（どのタスクからでもよい．次のトランザクションで書き込む）
+ */
+void set_target(uint8_t index, uint16_t position_100ths);
+
+/**
+ * @brief 停止を指令する
+ */
+void stop(uint8_t index);
+
+/**
+ * @brief モーターの状態を読む（どのタスクからでもよい）
+ */
+MotorState state(uint8_t index);
+
+uint8_t motor_count();
+Stats stats();
+
+} // namespace motor_bus
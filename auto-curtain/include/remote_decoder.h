@@ -0,0 +1,55 @@
+/**
+ * @file remote_decoder.h
+ * @brief RF（433MHz）とIRのリモコンのパルス列をボタンのコードにする
+ *
+ * @details
+ * パルス列は符号付きの長さ [us] の並び．正がマーク（送信中），負がスペース．
+ * 受信機の出力の極性（IRは負論理）は remote_input が吸収するので，ここでは気にしない．
+ * Arduinoに依存しないので，記録したパルス列をホストで再生して確かめられる（tools/remote_replay.sh）．
+ * 対応するプロトコル
+ * - NEC（IR）: 9ms/4.5ms のヘッダ，32ビット（アドレス，コマンドとその反転）．押し続けるとリピート符号
+ * - Samsung（IR）: 4.5ms/4.5ms のヘッダ，NECと同じビットの形
+ * - EV1527 / PT2262（RF）: T≈350us で 0 = 1T/3T，1 = 3T/1T の24ビット．フレームの間に 1T/31T の同期
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace remote_decoder {
+
+/**
+ * @brief プロトコル
+ */
+enum class Protocol : uint8_t {
+    NONE,
+    NEC,
+    SAMSUNG,
+    EV1527,
+};
+
+/**
+ * @brief 受け取ったボタンのコード
+ */
+struct Code {
+    Protocol protocol;
+    bool repeat;      ///< 押し続けのリピート符号（NEC）．address と command は持たない
+    uint32_t address; ///< リモコンの識別（NEC: 8/16ビット，EV1527: 20ビット）
+    uint32_t command; ///< ボタン（NEC: 8ビット，EV1527: 4ビット）
+};
+
+/**
+ * @brief パルス列を復号する
+ * @param pulses 長さ [us]（正: マーク，負: スペース）
+ * @param count パルスの数
+ * @param code 結果の格納先
+ * @return 復号できたらtrue
+ */
+bool decode(const int32_t *pulses, size_t count, Code *code);
+
+/**
+ * @brief プロトコルの名前
+ */
+const char *protocol_name(Protocol protocol);
+
+} // namespace remote_decoder
@@ -0,0 +1,90 @@
+/**
+ * @file remote_input.h
+ * @brief RF（433MHz）とIRのリモコンで操作する
+ *
+ * @details
+ * 受信機の出力のパルス列はRMTの受信チャネルが記録するので，CPUはエッジごとの割り込みを受けない．
+ * 線が一定時間動かなくなる（idle）と1回分の記録がリングバッファに入り，
+ * loop() の poll() がそれを remote_decoder で復号してボタンにする．
+ * リモコンのどのボタンを開く・閉じる・止める・反転に使うかは，コンソールの
+ * `remote learn <button>` のあとに実際に押して覚えさせる（NVSに保存する）．
+ * 受信機のピンは board_config.h の REMOTE_IR_PIN と REMOTE_RF_PIN（つながっていなければ -1）．
+ */
+#pragma once
+
+#include <stdint.h>
+#include "remote_decoder.h"
+
+namespace remote_input {
+
+// 覚えられるボタンの数
+const uint8_t MAX_BINDINGS = 8;
+// 同じコードをこの時間内にまた受け取ったら押し続けとみなす [ms]
+const uint32_t HOLD_MS = 300;
+
+/**
+ * @brief ボタンの役割
+ */
+enum class Button : uint8_t {
+    NONE,
+    OPEN,   ///< 全開へ移動
+    CLOSE,  ///< 全閉へ移動
+    STOP,   ///< 停止
+    TOGGLE, ///< 本体のボタンと同じ（動いていれば止め，止まっていれば反対側の端へ）
+};
+
+/**
+ * @brief リモコンのコードとボタンの役割の対応
+ */
+struct Binding {
+    remote_decoder::Protocol protocol;
+    Button button;
+    uint32_t address;
+    uint32_t command;
+};
+
+/**
+ * @brief 覚えたボタンを読み出し，RMTの受信を始める
+ */
+void begin();
+
+/**
+ * @brief 受信したパルス列を復号する（loopから呼ぶ）
+ * @return 押されたボタン（押し続けの間は最初の1回だけ）．なければ Button::NONE
+ */
+Button poll();
+
+/**
+ * @brief 次に受信したコードを button として覚える
+ */
+void learn(Button button);
+
+/**
+ * @brief 覚えたボタンをすべて忘れる
+ */
+void clear();
+
+/**
+ * @brief 受信したパルス列をコンソールに表示するか（tools/remote_replay.sh で再生できる形）
+ */
+void set_dump(bool enabled);
+
+/**
+ * @brief 覚えたボタン
+ */
+uint8_t binding_count();
+const Binding *bindings();
+
+/**
+ * @brief 最後に受信したコード
+ * @return まだ受信していなければfalse
+ */
+bool last_code(remote_decoder::Code *code);
+
+/**
+ * @brief 役割の名前（コンソール用）．名前から役割を引くときは from_name
+ */
+const char *button_name(Button button);
+Button from_name(const char *name);
+
+} // namespace remote_input
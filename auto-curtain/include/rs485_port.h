@@ -0,0 +1,29 @@
+/**
+ * @file rs485_port.h
+ * @brief ブリッジモードのRS-485の送受信（UART2，半二重）
+ *
+ * @details
+ * IDFのUARTドライバを RS-485 半二重モードで使う．DE（RTS）は送信の間だけハードウェアが立てる．
+ * 受信はドライバの割り込みがFIFOからリングバッファに移し，バスのタスクは
+ * 期待する長さがそろうまで寝て待つ（1文字ずつ起こされない）．
+ * 受信のタイムアウト割り込みを2文字分にしているので，応答の最後の文字から約2文字で起きる．
+ * motor_bus の Transport として使う．
+ */
+#pragma once
+
+#include <stdint.h>
+#include "motor_bus.h"
+
+namespace rs485_port {
+
+/**
+ * @brief UARTを 8E1，baud で設定する（board_config.h の RS485_*_PIN）
+ */
+void begin(uint32_t baud);
+
+/**
+ * @brief motor_bus に渡す送受信の手段
+ */
+motor_bus::Transport transport();
+
+} // namespace rs485_port
@@ -0,0 +1,67 @@
+/**
+ * @file schedule.h
+ * @brief 週単位のスケジュール（曜日と時刻ごとの目標位置）
+ *
+ * @details
+ * ハブなしで「平日は7:00に開ける，週末は9:00」のような動作をさせる．
+ * - 表は週の中の時刻（月曜 0:00 からの分）で並べてNVSに保存する．1件4バイト．
+ * - 次のイベントは二分探索で探し，そのイベントの時刻に1つのタイマーだけを仕掛ける．
+ *   件数が増えても評価の手間はほとんど変わらず，次のイベントまでは何もしない．
+ * - タイマーが切れたらシーケンサのフローからスケジュールの指令として調停に渡す．
+ * 時刻は wall_clock から取る．時刻が設定されるまではタイマーを仕掛けない．
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace schedule {
+
+// 表の最大件数と，週の分数
+const uint16_t MAX_ENTRIES = 256;
+const uint16_t MINUTES_PER_WEEK = 7 * 24 * 60;
+// 次のイベントがないことを表す値
+const uint16_t NO_EVENT = 0xFFFF;
+
+/**
+ * @brief 表の1件．Matterの属性にはこの並び（リトルエンディアン）のまま載せる
+ */
+struct Entry {
+    uint16_t minute_of_week;  ///< 月曜 0:00 からの分（0 - 10079）
+    uint16_t position_100ths; ///< 目標位置（0: 全開，10000: 全閉）
+};
+
+/**
+ * @brief 保存しておいた表を読み出し，フローとタイマーを用意する
+ */
+void begin();
+
+/**
+ * @brief 表を置き換える．どのタスクから呼んでもよい（反映はloopタスクで行う）
+ * @param data Entry を並べたバイト列（順不同．同じ時刻が複数あれば後のものを使う）
+ * @param length バイト数
+ * @return 形式が正しければtrue
+ */
+bool set_entries(const uint8_t *data, size_t length);
+
+/**
+ * @brief 時刻が設定し直されたので，次のイベントを探し直す．どのタスクから呼んでもよい
+ */
+void reschedule();
+
+/**
+ * @brief 表の件数
+ */
+uint16_t entry_count();
+
+/**
+ * @brief 表の先頭（loopタスクから使う）
+ */
+const Entry *entries();
+
+/**
+ * @brief 次のイベントの時刻（月曜 0:00 からの分）．なければ NO_EVENT
+ */
+uint16_t next_event_minute();
+
+} // namespace schedule
@@ -0,0 +1,94 @@
+/**
+ * @file seqlock.h
+ * @brief 書き込み側1つ・読み出し側複数のシーケンスロック
+ *
+ * @details
+ * 書き込み側（制御周期など）はロックも割り込み禁止もせずに値を更新する．
+ * 読み出し側は書き込み中の値を読んだら読み直すので，常にそろった値が得られる．
+ * 書き込み側は1つのタスクに限ること．
+ *
+ * 書き込み側より優先度の高いタスク（esp_timerなど）が書き込みの途中に割り込んで読むと，
+ * 書き込み側が再開するまで値はそろわない．read() は読み直しを SPIN_LIMIT 回で打ち切り，
+ * 1ティック寝て書き込み側を先に走らせるので回り続けることはないが，寝るので
+ * クリティカルセクションや割り込みの中で呼んではいけない（そこでは読む前に値を取っておく）．
+ */
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#if defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <thread>
+#endif
+
+/**
+ * @brief 読み直しが続いたときに書き込み側へ譲る
+ */
+inline void seqlock_backoff() {
+#if defined(ESP_PLATFORM)
+    // 優先度の低い書き込み側も走れるように寝る（taskYIELD では同じ優先度にしか譲らない）
+    vTaskDelay(1);
+#else
+    std::this_thread::yield();
+#endif
+}
+
+template <typename T>
+class Seqlock {
+public:
+    // 書き込み側へ譲るまでに読み直す回数
+    static const uint32_t SPIN_LIMIT = 64;
+
+    /**
+     * @brief 値を書き込む（書き込み側専用）
+     */
+    void write(const T &value) {
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        // 奇数の間は書き込み中
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        data = value;
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief そろった値を読み出す．書き込みと重なったら読み直し，続くときは書き込み側へ譲る
+     *
+     * 寝ることがあるので，クリティカルセクションや割り込みの中で呼ばないこと．
+     */
+    T read() const {
+        T value;
+        while (!try_read(value, SPIN_LIMIT)) {
+            seqlock_backoff();
+        }
+        return value;
+    }
+
+    /**
+     * @brief 寝ずに，attempts 回まで読み直してそろった値を読み出す
+     * @param value そろった値の格納先（読めなければ書き換えない）
+     * @param attempts 読む回数の上限
+     * @return 読めればtrue
+     */
+    bool try_read(T &value, uint32_t attempts) const {
+        for (uint32_t i = 0; i < attempts; i++) {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if ((before & 1) != 0) {
+                continue;
+            }
+            T candidate = data;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) {
+                value = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    std::atomic<uint32_t> sequence{0};
+    T data{};
+};
@@ -0,0 +1,121 @@
+/**
+ * @file sequencer.h
+ * @brief スタックを持たない協調型シーケンサ（protothread 風）
+ *
+ * @details
+ * 長く続く処理（原点出し，LEDの点滅，コミッショニング窓の監視など）を，
+ * それぞれFreeRTOSタスクにせずに1つのタスク（loop）の中で動かす．
+ * 各フローは小さな制御ブロック（Flow）と関数の組で，待つところで return して
+ * 次の poll() で続きから再開する．1フローあたりのRAMは Flow 1つ分だけで済む．
+ *
+ * @note
+ * 再開の位置は switch の case で覚えるので，フロー関数のローカル変数は
+ * 待ちをまたいで保持されない．保持したい値は static 変数か Flow の外に置くこと．
+ * また，フロー関数の中で switch 文は使えない．
+ *
+ * @code
+ * static sequencer::Status blink(sequencer::Flow &flow) {
+ *     SEQ_BEGIN(flow);
+ *     while (true) {
+ *         digitalWrite(LED_PIN, HIGH);
+ *         SEQ_SLEEP(flow, 100);
+ *         digitalWrite(LED_PIN, LOW);
+ *         SEQ_SLEEP(flow, 900);
+ *     }
+ *     SEQ_END(flow);
+ * }
+ * @endcode
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <stdint.h>
+
+namespace sequencer {
+
+/**
+ * @brief フロー関数の戻り値
+ */
+enum class Status : uint8_t {
+    WAITING, ///< 待ち合わせ中．次の poll() で再開する
+    DONE,    ///< 最後まで実行した．以後は呼ばれない
+};
+
+struct Flow;
+typedef Status (*FlowFunction)(Flow &flow);
+
+/**
+ * @brief フローの制御ブロック
+ */
+struct Flow {
+    const char *name;
+    FlowFunction function;
+    uint16_t resume_line;           ///< 再開する位置（0なら先頭から）
+    bool done;
+    uint32_t wake_at;               ///< SEQ_SLEEP の起床時刻 [ms]
+    std::atomic<uint32_t> events;   ///< post() で届いたイベントのビット
+    Flow *next;
+};
+
+/**
+ * @brief フローを登録する．flow は静的に確保しておくこと
+ * @param flow 制御ブロック
+ * @param name 名前（ログ用）
+ * @param function フロー関数
+ */
+void add(Flow &flow, const char *name, FlowFunction function);
+
+/**
+ * @brief フローにイベントを送る．どのタスクから呼んでもよい
+ * @param flow 送り先
+ * @param event_bits イベントのビット
+ */
+void post(Flow &flow, uint32_t event_bits);
+
+/**
+ * @brief 届いているイベントのうち event_bits のものを取り出す（フロー関数から呼ぶ）
+ * @return 取り出したイベントのビット
+ */
+uint32_t take_events(Flow &flow, uint32_t event_bits);
+
+/**
+ * @brief 登録されたフローを1回ずつ進める．loop()から呼ぶ
+ */
+void poll();
+
+/**
+ * @brief SEQ_SLEEP の待ち時間が過ぎたかどうか
+ */
+inline bool sleep_elapsed(const Flow &flow) {
+    return static_cast<int32_t>(millis() - flow.wake_at) >= 0;
+}
+
+} // namespace sequencer
+
+#define SEQ_BEGIN(flow) switch ((flow).resume_line) { case 0:
+
+#define SEQ_END(flow) } (flow).resume_line = 0; return sequencer::Status::DONE
+
+/// 条件が成り立つまで待つ
+#define SEQ_WAIT_UNTIL(flow, condition)                 \
+    do {                                                \
+        (flow).resume_line = __LINE__;                  \
+        case __LINE__:                                  \
+        if (!(condition)) return sequencer::Status::WAITING; \
+    } while (0)
+
+/// 一度ほかのフローに順番を譲る
+#define SEQ_YIELD(flow)                                 \
+    do {                                                \
+        (flow).resume_line = __LINE__;                  \
+        return sequencer::Status::WAITING;              \
+        case __LINE__:;                                 \
+    } while (0)
+
+/// ms ミリ秒待つ
+#define SEQ_SLEEP(flow, ms)                             \
+    do {                                                \
+        (flow).wake_at = millis() + (ms);               \
+        SEQ_WAIT_UNTIL(flow, sequencer::sleep_elapsed(flow)); \
+    } while (0)
@@ -0,0 +1,41 @@
+/**
+ * @file subscription_monitor.h
+ * @brief 再起動後にサブスクリプションが戻るまでの時間を計測する
+ *
+ * @details
+ * CASEセッションの再開（session resumption）とサブスクリプションの永続化は
+ * platformio.ini の CHIP_CONFIG_* で有効にしている．再起動後はデバイス側から
+ * サブスクリプションを張り直すので，コントローラーはCASEの再確立から
+ * やり直さずに新しい状態を受け取れる．
+ * ここでは，再起動前に張られていた数のサブスクリプションがそろうまでの時間を記録する．
+ * 張り直しを待つ時間（RESTORE_WINDOW_MS）が過ぎたら，そろわなくても計測を終え，戻った数を次の起動の expected にする
+ * （コントローラーが外されたなどで数が減ったとき，expected が古いまま残らないように）．
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace subscription_monitor {
+
+/**
+ * @brief 計測値
+ */
+struct Stats {
+    uint16_t active;          ///< 現在のサブスクリプション数
+    uint16_t expected;        ///< 再起動前のサブスクリプション数
+    uint32_t first_ms;        ///< 起動から最初のサブスクリプションまで [ms]（0ならまだ）
+    uint32_t all_restored_ms; ///< 起動から expected 個そろうまで [ms]（0ならまだ．そろわずに終わったときも0）
+    bool window_closed;       ///< 張り直しを待つ時間が過ぎた
+};
+
+/**
+ * @brief Interaction Modelにコールバックを登録する．CHIPのタスクから（kServerReadyで）呼ぶこと
+ */
+void begin();
+
+/**
+ * @brief 計測値を取得する
+ */
+Stats stats();
+
+} // namespace subscription_monitor
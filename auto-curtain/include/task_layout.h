@@ -0,0 +1,53 @@
+/**
+ * @file task_layout.h
+ * @brief ボードごとのFreeRTOSタスクの配置（コアと優先度）
+ *
+ * @details
+ * - デュアルコア（ESP32 / upesy_wroom）: Wi-FiとMatter（CHIP）のタスクはコア0で動くので，
+ *   移動制御はコア1（Arduinoのloopと同じコア）に固定し，loopより高い優先度にする．
+ * - シングルコア（ESP32-C3 / seeed_xiao_esp32c3）: コアは選べないので優先度で分ける．
+ *   Wi-Fi（23）とesp_timer（22）より下，lwIP（18）とCHIP（5）とloop（1）より上に置く．
+ * - 診断出力（diag_transport）はバッファを吐き出すだけなので一番低い優先度にし，
+ *   デュアルコアでは移動制御と別のコア0に置く．
+ * - ブリッジモードのRS-485のバス（bridge.h）は応答の受信待ちでほとんど寝ているので，
+ *   シングルコアではCHIPより少し下，デュアルコアではコア1の移動制御とloopの間に置く．
+ */
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace task_layout {
+
+/**
+ * @brief 1つのタスクの配置
+ */
+struct Placement {
+    const char *name;
+    uint32_t stack_size;
+    UBaseType_t priority;
+    BaseType_t core; ///< tskNO_AFFINITY ならコアを固定しない
+};
+
+#if CONFIG_FREERTOS_UNICORE
+const Placement MOTION = {"motion", 3072, 20, tskNO_AFFINITY};
+const Placement DIAG = {"diag", 2048, 1, tskNO_AFFINITY};
+const Placement BUS = {"bus", 3072, 4, tskNO_AFFINITY};
+#else
+const Placement MOTION = {"motion", 3072, 20, 1};
+const Placement DIAG = {"diag", 2048, 1, 0};
+const Placement BUS = {"bus", 3072, 2, 1};
+#endif
+
+/**
+ * @brief 配置に従ってタスクを作る
+ * @param placement 配置
+ * @param function タスク関数
+ * @param handle 作ったタスクのハンドルの格納先
+ */
+inline void create_task(const Placement &placement, TaskFunction_t function, TaskHandle_t *handle) {
+    xTaskCreatePinnedToCore(function, placement.name, placement.stack_size, nullptr,
+                            placement.priority, handle, placement.core);
+}
+
+} // namespace task_layout
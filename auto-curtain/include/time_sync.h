@@ -0,0 +1,51 @@
+/**
+ * @file time_sync.h
+ * @brief ファブリック上のコントローラーの Time Synchronization クラスターから時刻を得る
+ *
+ * @details
+ * SNTPサーバーには頼らず，コミッショニングしたコントローラー（ACLの管理者）に
+ * CASEでつなぎ，Time Synchronization クラスターの UTCTime 属性を読む．
+ * - 読み出しにかかった往復時間の中点をその時刻とみなして wall_clock に反映する．
+ * - 同期の合間は wall_clock がずれを補正して時刻を進める．
+ * - 同期のたびの誤差が小さければ間隔を倍に（最長1日），大きければ半分にする．
+ *   ずれの推定が落ち着けば同期はまれになり，無線を使う時間も減る．
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace time_sync {
+
+/**
+ * @brief 同期の記録
+ */
+struct Stats {
+    uint32_t sync_count;      ///< 成功した同期の回数
+    uint32_t failure_count;   ///< 失敗した同期の回数
+    int32_t last_error_ms;    ///< 最後の同期での時計の誤差 [ms]
+    uint32_t round_trip_ms;   ///< 最後の読み出しの往復時間 [ms]
+    uint32_t interval_s;      ///< 次の同期までの間隔 [s]
+    uint64_t peer_node_id;    ///< 時刻を読んだコントローラーのノードID
+};
+
+/**
+ * @brief 同期のフローをシーケンサに登録する．setup()から呼ぶ
+ */
+void begin();
+
+/**
+ * @brief Matterサーバーの準備ができたことを知らせる（最初の同期を始める）．どのタスクから呼んでもよい
+ */
+void notify_server_ready();
+
+/**
+ * @brief すぐに同期し直す．どのタスクから呼んでもよい
+ */
+void request_sync();
+
+/**
+ * @brief 同期の記録を取得する
+ */
+Stats stats();
+
+} // namespace time_sync
@@ -0,0 +1,96 @@
+/**
+ * @file tlog.h
+ * @brief トークン化したログ（書式文字列の代わりに番号と引数のバイナリを送る）
+ *
+ * @details
+ * TLOG("Obstruction at %d", position) のように printf と同じ書式で書く．
+ * - CURTAIN_TOKENIZED_LOG を定義すると，書式文字列はコンパイル時にハッシュ（FNV-1a）に
+ *   置き換わり，イメージには残らない．送るのはトークンと引数だけ（1件数バイト）．
+ * - 定義しなければ printf と同じように文字列にして出す．
+ * どちらも diag_transport のバッファに書くだけなので，呼び出し側は待たされない．
+ * トークンと書式の対応表はビルド時に tools/tlog_database.py が作り，
+ * ホストの tools/tlog_decode.py が受け取ったバイト列を元の文字列に戻す．
+ *
+ * フレーム: 0xFE, 長さ（以降のバイト数）, トークン（4バイト，リトルエンディアン）, 引数...
+ * - 整数: ジグザグ符号化したvarint
+ * - 浮動小数点: float（4バイト）
+ * - 文字列: 長さ（1バイト）と中身（最大 MAX_STRING_LENGTH バイト）
+ * 書式の変換指定（%d, %u, %f, %s など）と引数の型の種類は一致させること．
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+namespace tlog {
+
+const uint8_t FRAME_START = 0xFE;
+const size_t MAX_PAYLOAD_SIZE = 64;
+const size_t MAX_STRING_LENGTH = 24;
+
+/**
+ * @brief 書式文字列のトークン（FNV-1a 32ビット）．tools/tlog_database.py と同じ計算
+ */
+constexpr uint32_t hash(const char *text) {
+    uint32_t value = 2166136261u;
+    while (*text != '\0') {
+        value = (value ^ static_cast<uint8_t>(*text++)) * 16777619u;
+    }
+    return value;
+}
+
+/**
+ * @brief 1件分のフレームを組み立てて送る
+ */
+class Encoder {
+public:
+    explicit Encoder(uint32_t token);
+    void put_integer(int64_t value);
+    void put_float(float value);
+    void put_string(const char *value);
+    /// 組み立てたフレームを送る
+    void send();
+
+private:
+    void put_byte(uint8_t value);
+    uint8_t frame[2 + MAX_PAYLOAD_SIZE];
+    size_t size;
+};
+
+template <typename T>
+inline void put_argument(Encoder &encoder, T value) {
+    if constexpr (std::is_floating_point<T>::value) {
+        encoder.put_float(static_cast<float>(value));
+    } else if constexpr (std::is_integral<T>::value || std::is_enum<T>::value) {
+        encoder.put_integer(static_cast<int64_t>(value));
+    } else {
+        static_assert(std::is_convertible<T, const char *>::value, "TLOG: unsupported argument type");
+        encoder.put_string(value);
+    }
+}
+
+/**
+ * @brief 文字列にして送る（CURTAIN_TOKENIZED_LOG を定義しないとき）
+ */
+void print(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+template <typename... Args>
+inline void emit(uint32_t token, Args... args) {
+    Encoder encoder(token);
+    (put_argument(encoder, args), ...);
+    encoder.send();
+}
+
+} // namespace tlog
+
+#if defined(CURTAIN_TOKENIZED_LOG)
+#define TLOG(format, ...)                                            \
+    do {                                                             \
+        constexpr uint32_t tlog_token = tlog::hash(format);          \
+        tlog::emit(tlog_token, ##__VA_ARGS__);                       \
+    } while (0)
+#else
+#define TLOG(format, ...) tlog::print(format "\n", ##__VA_ARGS__)
+#endif
@@ -0,0 +1,45 @@
+/**
+ * @file touch_monitor.h
+ * @brief 停止中のカーテンが手で引かれたことを検出して自動で開閉する（タッチ操作）
+ *
+ * @details
+ * 移動制御が停止している間だけ，低い周期（SAMPLE_PERIOD_MS）でエンコーダの
+ * カウントを調べる．短い時間で一定以上動いていたら手で引かれたとみなし，
+ * 引かれた方向の端まで移動を指令する．
+ * サンプルは loop から poll() で取る．移動制御の状態はシーケンスロックで読むので，
+ * 移動制御タスクより優先度の高いタスク（esp_timerなど）では読まない．
+ *
+ * 待機電力とライトスリープについての要求（サンプルの間にライトスリープに入れること）は満たしていない．
+ * - loop は止まらずに回り，電源管理（esp_pm）も設定していないので，停止中でもライトスリープには入らない．
+ * - エンコーダはGPIOのエッジ割り込みで数えている．エッジ割り込みはライトスリープ中には起きないので，
+ *   ライトスリープを有効にすると，眠っている間に引かれた分は数えられない（ESP32-C3 にはPCNTもない）．
+ * ライトスリープを使うときは，エンコーダのピンのレベルでの起床（gpio_wakeup_enable）で引き始めに起き，
+ * 起きている間だけエッジで数えるように作り直すこと．
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace touch_monitor {
+
+// サンプル周期 [ms]
+const uint32_t SAMPLE_PERIOD_MS = 50;
+
+/**
+ * @brief 監視を開始する
+ */
+void begin();
+
+/**
+ * @brief サンプル周期が来ていればカウントを調べる（loop から呼ぶ）
+ */
+void poll();
+
+/**
+ * @brief 手で引かれて移動を指令していれば，その目標位置を取り出す
+ * @param target 目標位置（0: 全開，10000: 全閉）の格納先
+ * @return 新しい指令があればtrue
+ */
+bool take_triggered_target(uint16_t *target);
+
+} // namespace touch_monitor
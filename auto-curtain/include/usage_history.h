@@ -0,0 +1,88 @@
+/**
+ * @file usage_history.h
+ * @brief カーテンの使われ方の記録（位置と時刻の時系列）と集計
+ *
+ * @details
+ * 移動の完了と手で動かされた位置を，時刻と位置の差分（varint）でRAMのバッファに詰めて記録する．
+ * 1件は2〜4バイトほどなので，2KBで数週間分が入る．いっぱいになったら古いものから捨てる．
+ * - 集計（日ごとの移動回数，位置の区間ごとの滞在時間）は記録のたびに更新するので，
+ *   問い合わせで時系列を読み直す必要はない．
+ * - バッファと集計は一定間隔でNVSに書き出し，起動時に読み戻す．
+ * 時刻は wall_clock から取るので，時刻が設定されるまでは記録しない．
+ * 記録と問い合わせはloopタスクから行うこと．
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace usage_history {
+
+// 記録のバッファの大きさ [byte]
+const size_t BUFFER_SIZE = 2048;
+// 集計する日数と，位置の区間の数（10%ごと）
+const uint8_t DAYS = 14;
+const uint8_t POSITION_BUCKETS = 10;
+
+/**
+ * @brief 記録の種類
+ */
+enum class Kind : uint8_t {
+    MOVE,   ///< 移動が完了した
+    MANUAL, ///< 止まっているときに手で動かされた
+};
+
+/**
+ * @brief 1件の記録
+ */
+struct Event {
+    Kind kind;
+    uint32_t time;            ///< UTC [s]
+    uint16_t position_100ths; ///< その時点の位置
+};
+
+/**
+ * @brief 集計
+ */
+struct Aggregates {
+    uint32_t today;                               ///< moves_per_day[0] の日（1970-01-01からの日数，現地時刻）
+    uint16_t moves_per_day[DAYS];                 ///< 日ごとの移動回数（0が今日）
+    uint32_t seconds_in_bucket[POSITION_BUCKETS]; ///< 位置の区間ごとの滞在時間 [s]（0が全開側）
+    uint32_t event_count;                         ///< バッファに残っている記録の数
+    uint32_t dropped_count;                       ///< バッファからあふれて捨てた記録の数
+    uint32_t first_time;                          ///< 残っている一番古い記録の時刻 [s]
+};
+
+/**
+ * @brief NVSから記録と集計を読み戻す
+ */
+void begin();
+
+/**
+ * @brief 位置と移動の状態を見て記録する．loop()から定期的に呼ぶ
+ */
+void poll();
+
+/**
+ * @brief 記録を1件追加し，集計を更新する
+ */
+void record(Kind kind, uint16_t position_100ths);
+
+/**
+ * @brief 集計を取得する
+ */
+Aggregates aggregates();
+
+/**
+ * @brief 残っている記録を古い順にたどる
+ * @param visit 1件ごとに呼ぶ関数
+ * @param context visit に渡す引数
+ */
+void for_each(void (*visit)(const Event &event, void *context), void *context);
+
+/**
+ * @brief バッファの使用量 [byte]
+ */
+size_t used_bytes();
+
+} // namespace usage_history
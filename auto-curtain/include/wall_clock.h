@@ -0,0 +1,72 @@
+/**
+ * @file wall_clock.h
+ * @brief 時刻（UTC）と現地時刻への変換，時計のずれ（ドリフト）の補正
+ *
+ * @details
+ * 本体にはバッテリー付きのRTCがないので，起動のたびに時刻を設定してもらう．
+ * 設定された時刻とそのときの esp_timer の値の組を基準に，経過時間を足して現在時刻を求める．
+ * - 時刻同期（time_sync）から受け取った時刻では，前回の同期からの経過時間と
+ *   予測との差から水晶のずれ [ppb] を推定し，以後の経過時間に掛けて補正する．
+ * - コンソールから手で設定した時刻は精度が低いので，基準の取り直しだけに使う．
+ * ずれの推定値と現地時刻との差（UTCオフセット）はNVSに保存しておく．
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace wall_clock {
+
+// 1週間の秒数
+const uint32_t SECONDS_PER_WEEK = 7 * 24 * 60 * 60;
+
+/**
+ * @brief 保存しておいたUTCオフセットとずれの推定値を読み出す
+ */
+void begin();
+
+/**
+ * @brief 現在のUTCを設定する（手で設定した時刻．ずれの推定には使わない）
+ * @param unix_seconds 1970-01-01からの秒数
+ */
+void set_utc(uint64_t unix_seconds);
+
+/**
+ * @brief 時刻同期で得たUTCを反映し，ずれの推定値を更新する
+ * @param unix_us 1970-01-01からのマイクロ秒
+ * @param timer_us unix_us に対応する esp_timer_get_time() の値
+ * @return 反映前の時計の誤差 [us]（同期した時刻 - 予測した時刻）．初めての同期なら0
+ */
+int64_t synchronize(uint64_t unix_us, int64_t timer_us);
+
+/**
+ * @brief UTCオフセットを設定する（NVSに保存する）
+ * @param offset_minutes 現地時刻 - UTC [分]（日本なら540）
+ */
+void set_utc_offset_minutes(int16_t offset_minutes);
+
+/**
+ * @brief UTCオフセット [分]
+ */
+int16_t utc_offset_minutes();
+
+/**
+ * @brief 時刻が設定されているかどうか
+ */
+bool is_set();
+
+/**
+ * @brief 現在のUTC [s]（1970-01-01からの秒数）．設定されていなければ0
+ */
+uint64_t now_utc();
+
+/**
+ * @brief 現地時刻での週の中の秒数（月曜 0:00 が0）
+ */
+uint32_t local_second_of_week();
+
+/**
+ * @brief 推定した時計のずれ [ppb]（正なら esp_timer が遅れている）
+ */
+int32_t drift_ppb();
+
+} // namespace wall_clock
@@ -0,0 +1,56 @@
+/**
+ * @file wifi_fast_connect.h
+ * @brief 前回つながったAP（BSSID，チャネル）とIP設定を覚えておき，起動時にスキャンとDHCPを省いて再接続する
+ *
+ * @details
+ * - 接続してIPを得るたびに，BSSID・チャネル・IPv4設定をNVSに保存する（変わったときだけ）．
+ * - 次の起動では，Wi-Fiが始まった時点（接続前）にBSSIDとチャネルを固定し，
+ *   DHCPを止めて保存したIPを設定しておく．
+ * - DHCPを動かし直すとIPv4の設定がいったん消えて取り直しが始まるので，IPを得てもすぐには動かさない．
+ *   起動直後のコミッショニングとサブスクリプションの張り直しが終わってから resume_dhcp() で動かし直す．
+ *   それからはリースがふだんどおり更新され，ゲートウェイやDNSの変更も次の保存で取り込む
+ *   （それまでの間はリースを持たずに保存したIPを使う）．
+ * - 動作中にAPから切断されたときも，つなぎ直す前に保存したBSSIDとチャネルに固定してスキャンを省く．
+ *   DHCPは動いたままなので，前のアドレスを要求し直すだけですむ．
+ * - 一定時間内にIPを得られない，または固定した設定で切断されたら，保存内容を捨てて
+ *   通常のスキャンとDHCPに戻す．
+ * - 起動からオンラインになるまでの時間を記録する．
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace wifi_fast_connect {
+
+/**
+ * @brief 起動ごとの接続の記録
+ */
+struct BootStats {
+    bool fast_path;          ///< 保存した設定で接続を試みた
+    bool fell_back;          ///< 保存した設定で失敗して通常の接続に戻した
+    uint32_t online_ms;      ///< 起動からオンラインになるまでの時間 [ms]（0ならまだ）
+    uint32_t last_online_ms; ///< 前回の起動での online_ms
+};
+
+/**
+ * @brief Wi-Fiイベントのハンドラを登録する．esp_matter::start() より前に呼ぶこと
+ */
+void begin();
+
+/**
+ * @brief オンラインになった（IPアドレスが割り当てられた）ことを知らせる
+ */
+void notify_online();
+
+/**
+ * @brief 起動時に保存したIPのまま止めておいたDHCPを動かし直す．
+ * サブスクリプションがそろった（または待つ時間が過ぎた）あとに呼ぶ．止めていなければ何もしない
+ */
+void resume_dhcp();
+
+/**
+ * @brief この起動での接続の記録を取得する
+ */
+BootStats boot_stats();
+
+} // namespace wifi_fast_connect
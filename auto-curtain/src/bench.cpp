@@ -0,0 +1,321 @@
+/**
+ * @file bench.cpp
+ * @brief 部品ごとのマイクロベンチマーク
+ *
+ * @details
+ * ここにあるベンチマークはArduinoに依存しない部品だけを使うので，
+ * ホストでも同じ定義のままビルドできる．
+ * 実機だけのもの（キュー，タイマー，motion の本物の経路）は ARDUINO のときだけ入れる．
+ * 名前が synth_ で始まるものは，ファームウェアの処理の一部だけを取り出した合成のベンチマークで，
+ * 本物の経路の下限の目安にしかならない（本物の経路が測れるものは実機だけの方で測る）．
+ */
+#include "bench.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include "fixed_point.h"
+#include "motion.h"
+#include "seqlock.h"
+#include "tlog.h"
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "command_arbiter.h"
+#else
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace bench {
+
+struct Case {
+    const char *name;
+    Body body;
+};
+
+// 1回の計測の回数の上限
+const uint32_t MAX_ITERATIONS = 1u << 24;
+
+static Case extra_cases[MAX_EXTRA_CASES];
+static uint8_t extra_count = 0;
+
+#if defined(ARDUINO)
+
+static uint64_t now_us() {
+    return static_cast<uint64_t>(esp_timer_get_time());
+}
+
+static uint32_t now_cycles() {
+    return ESP.getCycleCount();
+}
+
+/**
+ * @brief ベンチマークの間に他のタスク（ウォッチドッグ）を走らせる
+ */
+static void pause() {
+    vTaskDelay(1);
+}
+
+#else
+
+static uint64_t now_us() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static uint32_t now_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return static_cast<uint32_t>(__rdtsc());
+#else
+    return 0;
+#endif
+}
+
+static void pause() {
+}
+
+#endif
+
+// ---- 共通のベンチマーク ----
+
+/**
+ * @brief 書き込み側のいないシーケンスロックからスナップショットを読む（合成）
+ *
+ * 書き込みと重ならないときの motion::snapshot() の下限．読み直しの分は入らない（実機の motion_snapshot と比べる）．
+ */
+static void bench_synth_snapshot(uint32_t iterations) {
+    static Seqlock<motion::Snapshot> snapshot;
+    for (uint32_t i = 0; i < iterations; i++) {
+        motion::Snapshot value = snapshot.read();
+        keep(value);
+    }
+}
+
+/**
+ * @brief スナップショットを組み立ててシーケンスロックに書く（制御周期ごとの publish() の中身）
+ */
+static void bench_seqlock_write(uint32_t iterations) {
+    static Seqlock<motion::Snapshot> snapshot;
+    motion::Snapshot value = {};
+    for (uint32_t i = 0; i < iterations; i++) {
+        value.position_counts = static_cast<int32_t>(i);
+        value.velocity_q16 = static_cast<int32_t>(i << 4);
+        value.move_count = i >> 10;
+        value.state = (i & 1) != 0 ? motion::State::MOVING : motion::State::IDLE;
+        snapshot.write(value);
+    }
+    keep(snapshot);
+}
+
+/**
+ * @brief 移動指令の受け渡しだけ（合成．書き込み側が置き，制御周期が取り出す）
+ *
+ * motion::move_to() の下限．本物は時刻の記録と制御周期タイマーの起動も行い，モーターが動き出すので測らない．
+ */
+static void bench_synth_mailbox(uint32_t iterations) {
+    static std::atomic<int32_t> mailbox(-1);
+    for (uint32_t i = 0; i < iterations; i++) {
+        mailbox.store(static_cast<int32_t>(i));
+        int32_t command = mailbox.exchange(-1);
+        keep(command);
+    }
+}
+
+/**
+ * @brief 台形プロファイルの計画（移動の開始と区間の境目で呼ぶ）
+ */
+static void bench_plan_move(uint32_t iterations) {
+    motion::Params params = motion::default_params();
+    for (uint32_t i = 0; i < iterations; i++) {
+        // 台形と三角形の両方になるように距離を変える
+        motion::Plan plan = motion::plan_move(0, 100 + static_cast<int32_t>(i & 1023) * 12, params, 0);
+        keep(plan);
+    }
+}
+
+static void bench_sin_cos(uint32_t iterations) {
+    for (uint32_t i = 0; i < iterations; i++) {
+        int32_t s;
+        int32_t c;
+        fixed_point::sin_cos(i * 2654435761u, &s, &c);
+        keep(s);
+        keep(c);
+    }
+}
+
+static void bench_isqrt(uint32_t iterations) {
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint32_t root = fixed_point::isqrt(static_cast<uint64_t>(i) * 2654435761u);
+        keep(root);
+    }
+}
+
+static void bench_mul_q30(uint32_t iterations) {
+    int32_t value = fixed_point::Q30_ONE / 3;
+    for (uint32_t i = 0; i < iterations; i++) {
+        value = fixed_point::mul_q30(value, fixed_point::Q30_ONE - static_cast<int32_t>(i & 0xFFFF));
+        keep(value);
+    }
+}
+
+/**
+ * @brief ログを文字列にする（CURTAIN_TOKENIZED_LOG を定義しないときの TLOG）
+ */
+static void bench_log_format(uint32_t iterations) {
+    char text[96];
+    for (uint32_t i = 0; i < iterations; i++) {
+        int length = snprintf(text, sizeof(text), "Stalled at %ld (peak %lu mA)\n", static_cast<long>(i),
+                              static_cast<unsigned long>(i >> 3));
+        keep(length);
+        keep(text);
+    }
+}
+
+/**
+ * @brief ログのフレームを組み立てる（CURTAIN_TOKENIZED_LOG のときの TLOG．送らない）
+ */
+static void bench_log_tokenized(uint32_t iterations) {
+    constexpr uint32_t token = tlog::hash("Stalled at %ld (peak %lu mA)");
+    for (uint32_t i = 0; i < iterations; i++) {
+        tlog::Encoder encoder(token);
+        encoder.put_integer(static_cast<int32_t>(i));
+        encoder.put_integer(i >> 3);
+        keep(encoder);
+    }
+}
+
+#if defined(ARDUINO)
+
+// ---- 実機だけのベンチマーク ----
+
+/**
+ * @brief 本物の motion::snapshot()（移動中なら制御周期の書き込みと重なった分の読み直しも入る）
+ */
+static void bench_motion_snapshot(uint32_t iterations) {
+    for (uint32_t i = 0; i < iterations; i++) {
+        motion::Snapshot value = motion::snapshot();
+        keep(value);
+    }
+}
+
+/**
+ * @brief FreeRTOSのキューに指令を入れて取り出す（タスク間の受け渡しの基本の操作）
+ */
+static void bench_queue_push_pop(uint32_t iterations) {
+    static QueueHandle_t queue = xQueueCreate(4, sizeof(command_arbiter::Command));
+    command_arbiter::Command command = {command_arbiter::Source::REMOTE, command_arbiter::Action::MOVE_TO, 0};
+    for (uint32_t i = 0; i < iterations; i++) {
+        command.position_100ths = static_cast<uint16_t>(i);
+        xQueueSend(queue, &command, 0);
+        xQueueReceive(queue, &command, 0);
+    }
+    keep(command);
+}
+
+static void on_bench_timer(void *arg) {
+}
+
+/**
+ * @brief esp_timer を張って止める（制御周期やスケジュールのタイマーの操作）
+ */
+static void bench_timer_insert(uint32_t iterations) {
+    static esp_timer_handle_t timer = nullptr;
+    if (timer == nullptr) {
+        esp_timer_create_args_t args = {};
+        args.callback = on_bench_timer;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "bench";
+        esp_timer_create(&args, &timer);
+    }
+    for (uint32_t i = 0; i < iterations; i++) {
+        // 満了しないように長くしておく
+        esp_timer_start_once(timer, 1000000 + (i & 1023));
+        esp_timer_stop(timer);
+    }
+}
+
+#endif
+
+static const Case cases[] = {
+    {"synth_snapshot", bench_synth_snapshot},
+    {"seqlock_write", bench_seqlock_write},
+    {"synth_mailbox", bench_synth_mailbox},
+    {"plan_move", bench_plan_move},
+    {"sin_cos", bench_sin_cos},
+    {"isqrt", bench_isqrt},
+    {"mul_q30", bench_mul_q30},
+    {"log_format", bench_log_format},
+    {"log_tokenized", bench_log_tokenized},
+#if defined(ARDUINO)
+    {"motion_snapshot", bench_motion_snapshot},
+    {"queue_push_pop", bench_queue_push_pop},
+    {"timer_insert", bench_timer_insert},
+#endif
+};
+
+/**
+ * @brief 1件を測る
+ */
+static Result measure(const Case &entry) {
+    Result result = {entry.name, 0, UINT32_MAX, UINT32_MAX};
+    for (uint8_t run = 0; run < RUNS; run++) {
+        uint32_t iterations = 1;
+        while (true) {
+            uint64_t start_us = now_us();
+            uint32_t start_cycles = now_cycles();
+            entry.body(iterations);
+            uint32_t cycles = now_cycles() - start_cycles;
+            uint64_t elapsed_us = now_us() - start_us;
+            if (elapsed_us >= MIN_DURATION_US || iterations >= MAX_ITERATIONS) {
+                uint32_t ns_x100 = static_cast<uint32_t>(elapsed_us * 100000 / iterations);
+                uint32_t cycles_x100 = static_cast<uint32_t>(static_cast<uint64_t>(cycles) * 100 / iterations);
+                if (ns_x100 < result.ns_per_op_x100) {
+                    result.iterations = iterations;
+                    result.ns_per_op_x100 = ns_x100;
+                    result.cycles_per_op_x100 = cycles_x100;
+                }
+                break;
+            }
+            iterations *= 2;
+        }
+        pause();
+    }
+    return result;
+}
+
+bool add(const char *name, Body body) {
+    if (extra_count >= MAX_EXTRA_CASES) {
+        return false;
+    }
+    extra_cases[extra_count++] = {name, body};
+    return true;
+}
+
+void run(const char *filter, void (*report)(const Result &result)) {
+    for (const Case &entry : cases) {
+        if (filter == nullptr || strstr(entry.name, filter) != nullptr) {
+            report(measure(entry));
+        }
+    }
+    for (uint8_t i = 0; i < extra_count; i++) {
+        if (filter == nullptr || strstr(extra_cases[i].name, filter) != nullptr) {
+            report(measure(extra_cases[i]));
+        }
+    }
+}
+
+void format(const Result &result, char *text, size_t size) {
+    snprintf(text, size, "%-16s %8lu.%02lu ns/op %8lu.%02lu cycles/op (%lu iterations)", result.name,
+             static_cast<unsigned long>(result.ns_per_op_x100 / 100), static_cast<unsigned long>(result.ns_per_op_x100 % 100),
+             static_cast<unsigned long>(result.cycles_per_op_x100 / 100),
+             static_cast<unsigned long>(result.cycles_per_op_x100 % 100), static_cast<unsigned long>(result.iterations));
+}
+
+} // namespace bench
@@ -0,0 +1,68 @@
+/**
+ * @file ble_release.cpp
+ * @brief コミッショニングが済んだらBLEのスタックとコントローラーのメモリを手放す
+ */
+#include "ble_release.h"
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <app/server/Server.h>
+#include <platform/CHIPDeviceLayer.h>
+#if CONFIG_BT_ENABLED
+#include <esp_bt.h>
+#if CONFIG_BT_NIMBLE_ENABLED
+#include <esp_nimble_hci.h>
+#include <nimble/nimble_port.h>
+#elif CONFIG_BT_BLUEDROID_ENABLED
+#include <esp_bt_main.h>
+#endif
+#endif
+#include "tlog.h"
+
+namespace ble_release {
+
+static Stats current = {};
+
+/**
+ * @brief BLEのホストとコントローラーを止める
+ * @return 止められたらtrue（止められなければメモリは返さない）
+ */
+static bool stop_stack() {
+#if CONFIG_BT_NIMBLE_ENABLED
+    if (nimble_port_stop() != 0) {
+        return false;
+    }
+    nimble_port_deinit();
+    return esp_nimble_hci_and_controller_deinit() == ESP_OK;
+#elif CONFIG_BT_BLUEDROID_ENABLED
+    esp_bluedroid_disable();
+    esp_bluedroid_deinit();
+    esp_bt_controller_disable();
+    return esp_bt_controller_deinit() == ESP_OK;
+#else
+    return false;
+#endif
+}
+
+void release_if_commissioned() {
+#if CONFIG_BT_ENABLED
+    if (current.released || chip::Server::GetInstance().GetFabricTable().FabricCount() == 0) {
+        return;
+    }
+    current.heap_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    chip::DeviceLayer::ConnectivityMgr().SetBLEAdvertisingEnabled(false);
+    if (!stop_stack()) {
+        TLOG("BLE stack did not stop, memory kept");
+        return;
+    }
+    current.released = esp_bt_mem_release(ESP_BT_MODE_BTDM) == ESP_OK;
+    current.heap_after = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    TLOG("BLE memory released: %u bytes", static_cast<unsigned>(current.heap_after - current.heap_before));
+#endif
+}
+
+Stats stats() {
+    return current;
+}
+
+} // namespace ble_release
@@ -0,0 +1,71 @@
+/**
+ * @file bridge.cpp
+ * @brief ブリッジモード: RS-485のバスにつないだ多数のモーターを1台のMatterノードから動かす
+ */
+#include "bridge.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "rs485_port.h"
+#include "task_layout.h"
+#include "tlog.h"
+
+namespace bridge {
+
+const char *PREFERENCES_NAMESPACE = "bridge";
+const char *KEY_MOTOR_COUNT = "count";
+const char *KEY_FIRST_ADDRESS = "first";
+const char *KEY_BAUD = "baud";
+// Modbusのスレーブアドレスは1から247
+const uint8_t MAX_ADDRESS = 247;
+
+static Preferences preferences;
+static TaskHandle_t bus_task = nullptr;
+
+/**
+ * @brief バスのタスク．step() は送受信の待ちの間寝ているので，休みなく回してよい
+ */
+static void bus_task_main(void *arg) {
+    while (true) {
+        motor_bus::step();
+    }
+}
+
+uint8_t begin() {
+    preferences.begin(PREFERENCES_NAMESPACE, false);
+    motor_bus::Config bus_config = config();
+    if (bus_config.motor_count == 0) {
+        TLOG("Bridge: no motors configured");
+        return 0;
+    }
+    rs485_port::begin(bus_config.baud);
+    motor_bus::begin(bus_config, rs485_port::transport());
+    task_layout::create_task(task_layout::BUS, bus_task_main, &bus_task);
+    TLOG("Bridge: %u motors from address %u at %lu bps", bus_config.motor_count, bus_config.first_address,
+         static_cast<unsigned long>(bus_config.baud));
+    return bus_config.motor_count;
+}
+
+motor_bus::Config config() {
+    motor_bus::Config bus_config;
+    bus_config.motor_count = preferences.getUChar(KEY_MOTOR_COUNT, DEFAULT_MOTOR_COUNT);
+    bus_config.first_address = preferences.getUChar(KEY_FIRST_ADDRESS, DEFAULT_FIRST_ADDRESS);
+    bus_config.baud = preferences.getULong(KEY_BAUD, DEFAULT_BAUD);
+    bus_config.response_timeout_us = RESPONSE_TIMEOUT_US;
+    return bus_config;
+}
+
+bool set_config(uint8_t motor_count, uint8_t first_address, uint32_t baud) {
+    if (motor_count > motor_bus::MAX_MOTORS || first_address == 0 ||
+        first_address + motor_count - 1 > MAX_ADDRESS || baud < 1200) {
+        return false;
+    }
+    preferences.putUChar(KEY_MOTOR_COUNT, motor_count);
+    preferences.putUChar(KEY_FIRST_ADDRESS, first_address);
+    preferences.putULong(KEY_BAUD, baud);
+    return true;
+}
+
+} // namespace bridge
@@ -0,0 +1,110 @@
+/**
+ * @file command_arbiter.cpp
+ * @brief 移動指令の発行元と優先度による調停
+ */
+#include "command_arbiter.h"
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "motion.h"
+
+namespace command_arbiter {
+
+// 同じ目標とみなす位置のずれ（1%）
+const uint16_t SAME_POSITION_TOLERANCE = 100;
+
+static portMUX_TYPE arbiter_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t hold_off_ms = DEFAULT_HOLD_OFF_MS;
+
+// 直前に受け付けた指令とホールドオフの期限
+static bool has_active = false;
+static Command active = {};
+static uint32_t hold_until = 0;
+// release() まで低い優先度の指令を受け付けない（原点出し）
+static bool held = false;
+
+/**
+ * @brief 調停に使う移動制御の状態（クリティカルセクションに入る前に取っておく）
+ */
+struct MotionView {
+    bool moving;
+    uint16_t position_100ths;
+};
+
+/**
+ * @brief 直前に受け付けた指令と同じ指令かどうか
+ */
+static bool is_redundant(const Command &command, const MotionView &view) {
+    if (!has_active || command.action != active.action) {
+        return false;
+    }
+    bool moving = view.moving;
+    if (command.action == Action::STOP) {
+        return !moving;
+    }
+    if (command.position_100ths != active.position_100ths) {
+        return false;
+    }
+    // 同じ目標でも，着いた後に手で動かされていれば動かし直す
+    int32_t offset = static_cast<int32_t>(view.position_100ths) - command.position_100ths;
+    return moving || (offset <= SAME_POSITION_TOLERANCE && offset >= -SAME_POSITION_TOLERANCE);
+}
+
+/**
+ * @brief 優先度の高い指令が有効なので，この指令を捨てるべきかどうか
+ */
+static bool is_suppressed(const Command &command, const MotionView &view, uint32_t now) {
+    if (!has_active || command.source <= active.source) {
+        return false;
+    }
+    bool holding = static_cast<int32_t>(hold_until - now) > 0;
+    return holding || held || view.moving;
+}
+
+Result submit(const Command &command) {
+    uint32_t now = millis();
+    // 移動制御の状態はシーケンスロックで読むので，割り込みを止める前に読んでおく
+    MotionView view = {motion::state() == motion::State::MOVING, motion::position_100ths()};
+
+    portENTER_CRITICAL(&arbiter_mux);
+    Result result;
+    if (is_redundant(command, view)) {
+        result = Result::COLLAPSED;
+    } else if (is_suppressed(command, view, now)) {
+        result = Result::SUPPRESSED;
+    } else {
+        result = Result::ACCEPTED;
+        has_active = true;
+        active = command;
+        hold_until = now + (command.source == Source::REMOTE ? 0 : hold_off_ms);
+        held = command.source == Source::HOMING;
+    }
+    portEXIT_CRITICAL(&arbiter_mux);
+
+    if (result == Result::ACCEPTED) {
+        if (command.action == Action::STOP) {
+            motion::stop();
+        } else {
+            motion::move_to(command.position_100ths);
+        }
+    }
+    return result;
+}
+
+void release(Source source) {
+    uint32_t now = millis();
+    portENTER_CRITICAL(&arbiter_mux);
+    if (has_active && active.source == source) {
+        held = false;
+        hold_until = now;
+    }
+    portEXIT_CRITICAL(&arbiter_mux);
+}
+
+void set_hold_off_ms(uint32_t value) {
+    portENTER_CRITICAL(&arbiter_mux);
+    hold_off_ms = value;
+    portEXIT_CRITICAL(&arbiter_mux);
+}
+
+} // namespace command_arbiter
@@ -0,0 +1,400 @@
+/**
+ * @file console.cpp
+ * @brief シリアルコンソール（調整・デバッグ用のコマンド）
+ */
+#include "console.h"
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "ble_release.h"
+#include "bridge.h"
+#include "command_arbiter.h"
+#include "device_flows.h"
+#include "diag_transport.h"
+#include "glare_control.h"
+#include "maintenance.h"
+#include "motion.h"
+#include "motor_bus.h"
+#include "remote_input.h"
+#include "schedule.h"
+#include "subscription_monitor.h"
+#include "time_sync.h"
+#include "usage_history.h"
+#include "wall_clock.h"
+#include "wifi_fast_connect.h"
+
+namespace console {
+
+const size_t LINE_LENGTH = 64;
+
+// 応答の出力先（ESP32-C3 ではログのフレームと混ざらないように診断出力のバッファを通る）
+static Print &output = diag_transport::console_output();
+
+static char line[LINE_LENGTH];
+static size_t line_length = 0;
+
+/**
+ * @brief 移動パラメータを表示する
+ */
+static void print_params(const motion::Params &p) {
+    output.print("speed: ");
+    output.println(p.max_speed_cps);
+    output.print("accel: ");
+    output.println(p.accel_cps2);
+    output.print("duty: ");
+    output.println(p.max_duty);
+    output.print("current: ");
+    output.println(p.current_limit_ma);
+    output.print("kp: ");
+    output.println(p.kp);
+    output.print("kff: ");
+    output.println(p.kff);
+}
+
+/**
+ * @brief set コマンド．移動パラメータを1つ書き換える（移動中でも区間の境目から反映される）
+ * @return 名前が正しければtrue
+ */
+static bool set_param(const char *name, long value) {
+    motion::Params p = motion::params();
+    if (strcmp(name, "speed") == 0) {
+        p.max_speed_cps = value;
+    } else if (strcmp(name, "accel") == 0) {
+        p.accel_cps2 = value;
+    } else if (strcmp(name, "duty") == 0) {
+        p.max_duty = value;
+    } else if (strcmp(name, "current") == 0) {
+        p.current_limit_ma = value;
+    } else if (strcmp(name, "kp") == 0) {
+        p.kp = value;
+    } else if (strcmp(name, "kff") == 0) {
+        p.kff = value;
+    } else {
+        return false;
+    }
+    motion::set_params(p);
+    return true;
+}
+
+/**
+ * @brief 1行分のコマンドを実行する
+ */
+static void execute(char *command_line) {
+    char *command = strtok(command_line, " ");
+    if (command == nullptr) {
+        return;
+    }
+    char *arg1 = strtok(nullptr, " ");
+    char *arg2 = strtok(nullptr, " ");
+    char *arg3 = strtok(nullptr, " ");
+
+    if (strcmp(command, "params") == 0) {
+        print_params(motion::params());
+    } else if (strcmp(command, "set") == 0 && arg1 != nullptr && arg2 != nullptr) {
+        if (set_param(arg1, strtol(arg2, nullptr, 10))) {
+            output.println("ok");
+        } else {
+            output.println("unknown parameter");
+        }
+    } else if (strcmp(command, "move") == 0 && arg1 != nullptr) {
+        uint16_t target = static_cast<uint16_t>(strtol(arg1, nullptr, 10));
+        command_arbiter::submit({command_arbiter::Source::LOCAL, command_arbiter::Action::MOVE_TO, target});
+    } else if (strcmp(command, "stop") == 0) {
+        command_arbiter::submit({command_arbiter::Source::LOCAL, command_arbiter::Action::STOP, 0});
+    } else if (strcmp(command, "timing") == 0) {
+        // タスク配置の違いによる制御周期のゆらぎと応答時間を比べる
+        motion::TimingStats stats = motion::timing_stats();
+        output.print("max jitter [us]: ");
+        output.println(stats.max_jitter_us);
+        output.print("command latency [us]: ");
+        output.print(stats.last_command_latency_us);
+        output.print(" (max ");
+        output.print(stats.max_command_latency_us);
+        output.println(")");
+        motion::reset_timing_stats();
+    } else if (strcmp(command, "wifi") == 0) {
+        wifi_fast_connect::BootStats stats = wifi_fast_connect::boot_stats();
+        output.print("cached AP/IP used: ");
+        output.print(stats.fast_path ? "yes" : "no");
+        output.println(stats.fell_back ? " (fell back)" : "");
+        output.print("online after [ms]: ");
+        output.print(stats.online_ms);
+        output.print(" (previous boot ");
+        output.print(stats.last_online_ms);
+        output.println(")");
+    } else if (strcmp(command, "subs") == 0) {
+        subscription_monitor::Stats stats = subscription_monitor::stats();
+        output.print("subscriptions: ");
+        output.print(stats.active);
+        output.print(" / expected ");
+        output.println(stats.expected);
+        output.print("first after [ms]: ");
+        output.println(stats.first_ms);
+        output.print("all restored after [ms]: ");
+        output.print(stats.all_restored_ms);
+        output.println(stats.window_closed && stats.all_restored_ms == 0 ? " (window closed)" : "");
+    } else if (strcmp(command, "bench") == 0) {
+        // 部品ごとのマイクロベンチマーク（数秒かかる．移動中は値がぶれる）．"bench plan" のように名前で絞れる
+        bench::run(arg1, [](const bench::Result &result) {
+            char text[96];
+            bench::format(result, text, sizeof(text));
+            output.println(text);
+        });
+    } else if (strcmp(command, "mem") == 0) {
+        // 同時接続数を調べるときに，サブスクリプションを増やしながらヒープの残りを見る
+        output.print("free heap: ");
+        output.println(heap_caps_get_free_size(MALLOC_CAP_8BIT));
+        output.print("minimum free heap: ");
+        output.println(heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+        output.print("largest free block: ");
+        output.println(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+        ble_release::Stats ble = ble_release::stats();
+        output.print("BLE released: ");
+        if (ble.released) {
+            output.print(ble.heap_before);
+            output.print(" -> ");
+            output.println(ble.heap_after);
+        } else {
+            output.println("no");
+        }
+    } else if (strcmp(command, "time") == 0 && arg1 != nullptr) {
+        // time <UNIX時刻> [UTCオフセット[分]]
+        wall_clock::set_utc(strtoull(arg1, nullptr, 10));
+        if (arg2 != nullptr) {
+            wall_clock::set_utc_offset_minutes(static_cast<int16_t>(strtol(arg2, nullptr, 10)));
+        }
+        schedule::reschedule();
+        output.println("ok");
+    } else if (strcmp(command, "clock") == 0) {
+        // 時刻同期の状態．"clock sync" ですぐに同期し直す
+        if (arg1 != nullptr && strcmp(arg1, "sync") == 0) {
+            time_sync::request_sync();
+        }
+        time_sync::Stats stats = time_sync::stats();
+        output.print("utc: ");
+        output.println(static_cast<unsigned long>(wall_clock::now_utc()));
+        output.print("syncs: ");
+        output.print(stats.sync_count);
+        output.print(" (failed ");
+        output.print(stats.failure_count);
+        output.println(")");
+        output.print("last error [ms]: ");
+        output.print(stats.last_error_ms);
+        output.print(" (round trip ");
+        output.print(stats.round_trip_ms);
+        output.println(")");
+        output.print("drift [ppb]: ");
+        output.println(wall_clock::drift_ppb());
+        output.print("sync interval [s]: ");
+        output.println(stats.interval_s);
+    } else if (strcmp(command, "glare") == 0) {
+        // glare [on|off | loc <緯度1e-4> <経度1e-4> | window <方位> <ひさし%>]
+        glare_control::Config config = glare_control::config();
+        if (arg1 != nullptr && strcmp(arg1, "on") == 0) {
+            config.enabled = true;
+        } else if (arg1 != nullptr && strcmp(arg1, "off") == 0) {
+            config.enabled = false;
+        } else if (arg1 != nullptr && strcmp(arg1, "loc") == 0 && arg3 != nullptr) {
+            config.latitude_1e4 = strtol(arg2, nullptr, 10);
+            config.longitude_1e4 = strtol(arg3, nullptr, 10);
+        } else if (arg1 != nullptr && strcmp(arg1, "window") == 0 && arg3 != nullptr) {
+            config.window_azimuth_deg = static_cast<int16_t>(strtol(arg2, nullptr, 10));
+            config.overhang_percent = static_cast<uint16_t>(strtol(arg3, nullptr, 10));
+        }
+        if (arg1 != nullptr) {
+            glare_control::set_config(config);
+        }
+        glare_control::Stats stats = glare_control::stats();
+        output.print("enabled: ");
+        output.println(config.enabled ? "yes" : "no");
+        output.print("sun (east, north, up) [Q30]: ");
+        output.print(stats.sun_east_q30);
+        output.print(", ");
+        output.print(stats.sun_north_q30);
+        output.print(", ");
+        output.println(stats.sun_up_q30);
+        output.print("sunlit: ");
+        output.print(stats.sunlit_100ths);
+        output.print(" target: ");
+        output.print(stats.target_100ths);
+        output.println(stats.overridden ? " (overridden)" : "");
+        output.print("update cycles: ");
+        output.print(stats.last_cycles);
+        output.print(" (max ");
+        output.print(stats.max_cycles);
+        output.println(")");
+    } else if (strcmp(command, "usage") == 0) {
+        // 使われ方の集計．"usage dump" で記録を古い順に表示する
+        if (arg1 != nullptr && strcmp(arg1, "dump") == 0) {
+            usage_history::for_each([](const usage_history::Event &event, void *context) {
+                output.printf("%lu %s %u\n", static_cast<unsigned long>(event.time),
+                              event.kind == usage_history::Kind::MOVE ? "move" : "manual",
+                              static_cast<unsigned>(event.position_100ths));
+            }, nullptr);
+        }
+        usage_history::Aggregates aggregates = usage_history::aggregates();
+        output.print("events: ");
+        output.print(aggregates.event_count);
+        output.print(" (");
+        output.print(usage_history::used_bytes());
+        output.print(" bytes, dropped ");
+        output.print(aggregates.dropped_count);
+        output.println(")");
+        output.print("moves per day (today first):");
+        for (uint8_t i = 0; i < usage_history::DAYS; i++) {
+            output.print(" ");
+            output.print(aggregates.moves_per_day[i]);
+        }
+        output.println();
+        output.print("seconds per 10% bucket (open first):");
+        for (uint8_t i = 0; i < usage_history::POSITION_BUCKETS; i++) {
+            output.print(" ");
+            output.print(aggregates.seconds_in_bucket[i]);
+        }
+        output.println();
+    } else if (strcmp(command, "maint") == 0) {
+        // 予知保全の統計．部品を交換したら "maint reset" で基準を取り直す
+        if (arg1 != nullptr && strcmp(arg1, "reset") == 0) {
+            maintenance::reset();
+        }
+        maintenance::Stats stats = maintenance::stats();
+        output.print("moves: ");
+        output.print(stats.move_count);
+        output.print(" flags: ");
+        output.println(stats.flags);
+        output.print("travel time [ms]: baseline ");
+        output.print(static_cast<long>(stats.travel_time.mean_q8 >> 8));
+        output.print(" sd ");
+        output.print(maintenance::stddev(stats.travel_time));
+        output.print(" (n=");
+        output.print(stats.travel_time.count);
+        output.print(") trend ");
+        output.println(static_cast<long>(stats.travel_time_ewma_q8 >> 8));
+        output.print("peak current [mA]: baseline ");
+        output.print(static_cast<long>(stats.peak_current.mean_q8 >> 8));
+        output.print(" sd ");
+        output.print(maintenance::stddev(stats.peak_current));
+        output.print(" trend ");
+        output.println(static_cast<long>(stats.peak_current_ewma_q8 >> 8));
+        output.print("stall rate [%]: ");
+        output.println(stats.stall_rate_q16 * 100 >> 16);
+    } else if (strcmp(command, "trace") == 0) {
+        // 制御周期のトレース．"trace on" で診断出力に流す（tools/tlog_decode.py でCSVにする）
+        if (arg1 != nullptr) {
+            diag_transport::set_trace_enabled(strcmp(arg1, "on") == 0);
+        }
+        diag_transport::Stats stats = diag_transport::stats();
+        output.print("trace: ");
+        output.println(diag_transport::trace_enabled() ? "on" : "off");
+        output.print("sent [byte]: ");
+        output.print(stats.sent_bytes);
+        output.print(" dropped: ");
+        output.print(stats.dropped_bytes);
+        output.print(" max used: ");
+        output.println(stats.max_used_bytes);
+    } else if (strcmp(command, "remote") == 0) {
+        // RF/IRリモコン．"remote learn open" のあとにリモコンのボタンを押すと覚える
+        // "remote dump on" で受信したパルス列を表示する（tools/remote_replay.sh で再生できる）
+        if (arg1 != nullptr && strcmp(arg1, "learn") == 0 && arg2 != nullptr) {
+            remote_input::Button button = remote_input::from_name(arg2);
+            if (button == remote_input::Button::NONE) {
+                output.println("buttons: open close stop toggle");
+                return;
+            }
+            remote_input::learn(button);
+            output.println("press the remote button");
+        } else if (arg1 != nullptr && strcmp(arg1, "clear") == 0) {
+            remote_input::clear();
+        } else if (arg1 != nullptr && strcmp(arg1, "dump") == 0) {
+            remote_input::set_dump(arg2 != nullptr && strcmp(arg2, "on") == 0);
+        }
+        for (uint8_t i = 0; i < remote_input::binding_count(); i++) {
+            const remote_input::Binding &binding = remote_input::bindings()[i];
+            output.printf("  %s %lx/%lx -> %s\n", remote_decoder::protocol_name(binding.protocol),
+                          static_cast<unsigned long>(binding.address), static_cast<unsigned long>(binding.command),
+                          remote_input::button_name(binding.button));
+        }
+        remote_decoder::Code code;
+        if (remote_input::last_code(&code)) {
+            output.printf("last: %s %lx/%lx\n", remote_decoder::protocol_name(code.protocol),
+                          static_cast<unsigned long>(code.address), static_cast<unsigned long>(code.command));
+        }
+#if defined(CURTAIN_BRIDGE_MODE)
+    } else if (strcmp(command, "bus") == 0) {
+        // ブリッジモードのRS-485のバス．"bus set <count> <first_address> <baud>" は再起動で反映
+        // "bus move <n> <0-10000>" と "bus stop <n>" はバスのn台目（0から）を直接動かす
+        if (arg1 != nullptr && strcmp(arg1, "set") == 0 && arg2 != nullptr && arg3 != nullptr) {
+            char *arg4 = strtok(nullptr, " ");
+            uint32_t baud = arg4 != nullptr ? strtoul(arg4, nullptr, 10) : bridge::DEFAULT_BAUD;
+            bool saved = bridge::set_config(static_cast<uint8_t>(strtoul(arg2, nullptr, 10)),
+                                            static_cast<uint8_t>(strtoul(arg3, nullptr, 10)), baud);
+            output.println(saved ? "saved (reboot to apply)" : "out of range");
+            return;
+        } else if (arg1 != nullptr && strcmp(arg1, "move") == 0 && arg3 != nullptr) {
+            motor_bus::set_target(static_cast<uint8_t>(strtoul(arg2, nullptr, 10)), static_cast<uint16_t>(strtoul(arg3, nullptr, 10)));
+        } else if (arg1 != nullptr && strcmp(arg1, "stop") == 0 && arg2 != nullptr) {
+            motor_bus::stop(static_cast<uint8_t>(strtoul(arg2, nullptr, 10)));
+        }
+        motor_bus::Config config = bridge::config();
+        motor_bus::Stats stats = motor_bus::stats();
+        output.printf("config: %u motors from address %u at %lu bps\n", config.motor_count, config.first_address,
+                      static_cast<unsigned long>(config.baud));
+        output.printf("transactions: %lu timeouts: %lu errors: %lu\n", static_cast<unsigned long>(stats.transactions),
+                      static_cast<unsigned long>(stats.timeouts), static_cast<unsigned long>(stats.errors));
+        output.printf("cycle [us]: %lu max age: %lu utilisation [%%]: %u\n", static_cast<unsigned long>(stats.cycle_us),
+                      static_cast<unsigned long>(stats.max_age_us), stats.utilisation_percent);
+        output.printf("command latency [us]: last %lu max %lu\n", static_cast<unsigned long>(stats.last_command_latency_us),
+                      static_cast<unsigned long>(stats.max_command_latency_us));
+        for (uint8_t i = 0; i < motor_bus::motor_count(); i++) {
+            motor_bus::MotorState state = motor_bus::state(i);
+            output.printf("  %u: %s position %u status %x\n", i, state.reachable ? "up  " : "down",
+                          state.position_100ths, state.status);
+        }
+#endif
+    } else if (strcmp(command, "sched") == 0) {
+        output.print("entries: ");
+        output.println(schedule::entry_count());
+        for (uint16_t i = 0; i < schedule::entry_count(); i++) {
+            const schedule::Entry &entry = schedule::entries()[i];
+            output.printf("  day %u %02u:%02u -> %u\n", static_cast<unsigned>(entry.minute_of_week / 1440),
+                          static_cast<unsigned>(entry.minute_of_week / 60 % 24), static_cast<unsigned>(entry.minute_of_week % 60),
+                          static_cast<unsigned>(entry.position_100ths));
+        }
+        output.print("now (minute of week): ");
+        output.println(wall_clock::is_set() ? static_cast<long>(wall_clock::local_second_of_week() / 60) : -1L);
+        output.print("next event: ");
+        output.println(schedule::next_event_minute());
+    } else if (strcmp(command, "home") == 0) {
+        device_flows::request_homing();
+    } else if (strcmp(command, "status") == 0) {
+        output.print("position: ");
+        output.println(motion::position_100ths());
+        output.print("state: ");
+        output.println(static_cast<int>(motion::state()));
+        output.print("last move [ms]: ");
+        output.println(motion::last_move_ms());
+    } else {
+        output.println("commands: params | set <speed|accel|duty|current|kp|kff> <value> | move <0-10000> | stop | home | status | timing | wifi | subs | mem | time <unix> [offset_min] | clock [sync] | sched | usage [dump] | maint [reset] | glare [on|off|loc <lat> <lon>|window <az> <overhang%>]");
+    }
+}
+
+void poll() {
+    while (Serial.available() > 0) {
+        char c = static_cast<char>(Serial.read());
+        if (c == '\r') {
+            continue;
+        }
+        if (c == '\n') {
+            line[line_length] = '\0';
+            execute(line);
+            line_length = 0;
+        } else if (line_length < LINE_LENGTH - 1) {
+            line[line_length++] = c;
+        }
+    }
+}
+
+} // namespace console
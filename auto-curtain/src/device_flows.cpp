@@ -0,0 +1,178 @@
+/**
+ * @file device_flows.cpp
+ * @brief シーケンサで動かすカーテン本体のフロー（原点出し，LED，コミッショニング窓）
+ */
+#include "device_flows.h"
+
+#include <Arduino.h>
+#include "board_config.h"
+#include "command_arbiter.h"
+#include "motion.h"
+#include "sequencer.h"
+#include "tlog.h"
+
+namespace device_flows {
+
+// 原点出しでは全行程より少し長く開方向に動かして，端で止まった位置を0とする
+const int32_t HOMING_MARGIN_COUNTS = CURTAIN_TRAVEL_COUNTS / 10;
+// 優先度の高い指令（安全）のホールドオフ中に原点出しを断られたら，この間隔で出し直す [ms]
+const uint32_t HOMING_RETRY_MS = 500;
+// 原点出しの移動が終わらないときに諦めるまでの時間の余裕 [ms]（最高速度で動き切る時間の2倍に足す）
+const uint32_t HOMING_TIMEOUT_SLACK_MS = 5000;
+// コミッショニング窓を開いたままにしたときにLED表示をやめるまでの時間 [ms]
+const uint32_t COMMISSIONING_DISPLAY_TIMEOUT = 15 * 60 * 1000;
+
+// フローに送るイベント
+const uint32_t EVENT_HOME = 1 << 0;
+const uint32_t EVENT_WINDOW_OPENED = 1 << 1;
+const uint32_t EVENT_WINDOW_CLOSED = 1 << 2;
+
+static sequencer::Flow homing_flow;
+static sequencer::Flow commissioning_flow;
+static sequencer::Flow led_flow;
+
+// フローの間で共有する状態（すべてloopタスクから触る）
+static bool homing = false;
+// 原点出しの移動を出す前の，完了した移動の数（ストールも数える）
+static uint32_t homing_move_count = 0;
+static bool commissioning_window_open = false;
+
+/**
+ * @brief 原点出しの移動を調停に出す．断られたら位置を元に戻す
+ * @return 受け付けられたらtrue
+ */
+static bool start_homing_move() {
+    int32_t previous_counts = motion::position_counts();
+    motion::set_position_counts(CURTAIN_TRAVEL_COUNTS + HOMING_MARGIN_COUNTS);
+    command_arbiter::Command command = {command_arbiter::Source::HOMING, command_arbiter::Action::MOVE_TO, 0};
+    if (command_arbiter::submit(command) == command_arbiter::Result::ACCEPTED) {
+        return true;
+    }
+    motion::set_position_counts(previous_counts);
+    return false;
+}
+
+/**
+ * @brief 原点出しの移動が終わるのを待つ時間の上限 [ms]
+ */
+static uint32_t homing_timeout_ms() {
+    uint32_t speed_cps = max(motion::params().max_speed_cps, static_cast<uint32_t>(1));
+    uint64_t travel_ms = static_cast<uint64_t>(CURTAIN_TRAVEL_COUNTS + HOMING_MARGIN_COUNTS) * 1000 / speed_cps;
+    return static_cast<uint32_t>(travel_ms * 2) + HOMING_TIMEOUT_SLACK_MS;
+}
+
+/**
+ * @brief 原点出し．EVENT_HOME が届くたびに開方向の端に当てて位置を0にする
+ *
+ * 移動は原点出しの指令として調停に出すので，終わって位置を0にするまで
+ * リモートやスケジュールの指令で目標を差し替えられることはない．
+ * 終わりは移動の数で見る（端にいるとすぐにストールして，MOVING の間に loop が回らないことがあるため）．
+ * 時間内に終わらなければ止めて，位置は0にせずに調停を返す（原点出しの指令を出しっぱなしにしない）．
+ */
+static sequencer::Status run_homing(sequencer::Flow &flow) {
+    SEQ_BEGIN(flow);
+    while (true) {
+        SEQ_WAIT_UNTIL(flow, sequencer::take_events(flow, EVENT_HOME) != 0);
+        SEQ_WAIT_UNTIL(flow, motion::state() != motion::State::MOVING);
+
+        homing = true;
+        homing_move_count = motion::snapshot().move_count;
+        while (!start_homing_move()) {
+            SEQ_SLEEP(flow, HOMING_RETRY_MS);
+            homing_move_count = motion::snapshot().move_count;
+        }
+        flow.wake_at = millis() + homing_timeout_ms();
+        SEQ_WAIT_UNTIL(flow, motion::snapshot().move_count != homing_move_count || sequencer::sleep_elapsed(flow));
+
+        if (motion::snapshot().move_count != homing_move_count) {
+            // 端に当たって止まっても，余裕分を動き切っても，そこを全開とする
+            motion::set_position_counts(0);
+            TLOG("Homing complete");
+        } else {
+            command_arbiter::Command command = {command_arbiter::Source::HOMING, command_arbiter::Action::STOP, 0};
+            command_arbiter::submit(command);
+            TLOG("Homing timed out");
+        }
+        command_arbiter::release(command_arbiter::Source::HOMING);
+        homing = false;
+    }
+    SEQ_END(flow);
+}
+
+/**
+ * @brief コミッショニング窓の監視．開いている間はLEDで知らせる
+ */
+static sequencer::Status run_commissioning(sequencer::Flow &flow) {
+    SEQ_BEGIN(flow);
+    while (true) {
+        SEQ_WAIT_UNTIL(flow, sequencer::take_events(flow, EVENT_WINDOW_OPENED) != 0);
+        commissioning_window_open = true;
+        TLOG("Commissioning window opened");
+
+        flow.wake_at = millis() + COMMISSIONING_DISPLAY_TIMEOUT;
+        SEQ_WAIT_UNTIL(flow, sequencer::take_events(flow, EVENT_WINDOW_CLOSED) != 0 || sequencer::sleep_elapsed(flow));
+        commissioning_window_open = false;
+        TLOG("Commissioning window closed");
+    }
+    SEQ_END(flow);
+}
+
+/**
+ * @brief LEDの点滅パターン
+ * - コミッショニング窓が開いている: ゆっくり点滅
+ * - 移動中，原点出し中: 速く点滅
+ * - ストールした: 2回ずつ点滅
+ * - それ以外: 消灯
+ */
+static sequencer::Status run_led(sequencer::Flow &flow) {
+    SEQ_BEGIN(flow);
+    while (true) {
+        if (commissioning_window_open) {
+            digitalWrite(LED_PIN, HIGH);
+            SEQ_SLEEP(flow, 500);
+            digitalWrite(LED_PIN, LOW);
+            SEQ_SLEEP(flow, 500);
+        } else if (homing || motion::state() == motion::State::MOVING) {
+            digitalWrite(LED_PIN, HIGH);
+            SEQ_SLEEP(flow, 100);
+            digitalWrite(LED_PIN, LOW);
+            SEQ_SLEEP(flow, 100);
+        } else if (motion::state() == motion::State::STALLED) {
+            digitalWrite(LED_PIN, HIGH);
+            SEQ_SLEEP(flow, 100);
+            digitalWrite(LED_PIN, LOW);
+            SEQ_SLEEP(flow, 100);
+            digitalWrite(LED_PIN, HIGH);
+            SEQ_SLEEP(flow, 100);
+            digitalWrite(LED_PIN, LOW);
+            SEQ_SLEEP(flow, 700);
+        } else {
+            digitalWrite(LED_PIN, LOW);
+            SEQ_SLEEP(flow, 100);
+        }
+    }
+    SEQ_END(flow);
+}
+
+void begin(bool position_known) {
+    sequencer::add(homing_flow, "homing", run_homing);
+    sequencer::add(commissioning_flow, "commissioning", run_commissioning);
+    sequencer::add(led_flow, "led", run_led);
+    if (!position_known) {
+        request_homing();
+    }
+}
+
+void request_homing() {
+    sequencer::post(homing_flow, EVENT_HOME);
+}
+
+bool is_homing() {
+    return homing;
+}
+
+void notify_commissioning_window(bool open) {
+    sequencer::post(commissioning_flow, open ? EVENT_WINDOW_OPENED : EVENT_WINDOW_CLOSED);
+}
+
+} // namespace device_flows
@@ -0,0 +1,214 @@
+/**
+ * @file diag_transport.cpp
+ * @brief ログとトレースを非同期にまとめて送る診断出力
+ */
+#include "diag_transport.h"
+
+#include <Arduino.h>
+#include <atomic>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "board_config.h"
+#include "task_layout.h"
+
+#if CONFIG_IDF_TARGET_ESP32C3 && ARDUINO_USB_CDC_ON_BOOT
+#define DIAG_USE_USB_SERIAL_JTAG 1
+#else
+#include <driver/uart.h>
+#define DIAG_USE_USB_SERIAL_JTAG 0
+#endif
+
+namespace diag_transport {
+
+// 1回に出力先へ渡す最大の量
+const size_t CHUNK_SIZE = 1024;
+// 空のバッファに書かれてから吐き出し始めるまで待つ時間（その間の書き込みをまとめて送る）
+const TickType_t BATCH_WAIT = pdMS_TO_TICKS(10);
+// この量を超えたら待たずに吐き出し始める
+const size_t WAKE_THRESHOLD = BUFFER_SIZE / 4;
+// 出力先が受け取らない（ホストがつながっていない，送信バッファがいっぱい）ときに待つ時間
+const TickType_t OUTPUT_RETRY_WAIT = pdMS_TO_TICKS(20);
+// コンソールの出力がバッファに入りきらないとき，空くのを待つ最大の時間
+const TickType_t CONSOLE_WAIT = pdMS_TO_TICKS(100);
+#if !DIAG_USE_USB_SERIAL_JTAG
+const uart_port_t DIAG_UART = UART_NUM_1;
+#endif
+
+static uint8_t buffer[BUFFER_SIZE];
+static portMUX_TYPE buffer_mux = portMUX_INITIALIZER_UNLOCKED;
+// head: 次に書く位置，tail: 次に送る位置（どちらも buffer_mux で守る）
+static size_t head = 0;
+static size_t tail = 0;
+static size_t used = 0;
+static Stats current = {};
+static std::atomic<bool> tracing(false);
+static TaskHandle_t drain_task = nullptr;
+
+/**
+ * @brief 出力先に渡す
+ * @return 受け取られた量
+ */
+static size_t output(const uint8_t *data, size_t length) {
+#if DIAG_USE_USB_SERIAL_JTAG
+    // USBの送信バッファに入る分だけ受け取られる（ホストがつながっていなくても待たない）
+    return Serial.write(data, length);
+#else
+    int written = uart_write_bytes(DIAG_UART, data, length);
+    return written < 0 ? 0 : written;
+#endif
+}
+
+/**
+ * @brief たまった分を，リングの端までの連続した領域ごとに吐き出す
+ *
+ * 空の間は write() からの通知までずっと寝ている（周期的には起きない）．
+ */
+static void drain_task_main(void *arg) {
+    while (true) {
+        portENTER_CRITICAL(&buffer_mux);
+        size_t start = tail;
+        size_t length = min(used, BUFFER_SIZE - tail);
+        portEXIT_CRITICAL(&buffer_mux);
+
+        if (length == 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            // 続けて書かれる分を少し待つ．WAKE_THRESHOLD を超えたら通知ですぐに起きる
+            ulTaskNotifyTake(pdTRUE, BATCH_WAIT);
+            continue;
+        }
+        size_t sent = output(buffer + start, min(length, CHUNK_SIZE));
+
+        portENTER_CRITICAL(&buffer_mux);
+        tail = (tail + sent) % BUFFER_SIZE;
+        used -= sent;
+        current.sent_bytes += sent;
+        portEXIT_CRITICAL(&buffer_mux);
+        if (sent == 0) {
+            vTaskDelay(OUTPUT_RETRY_WAIT);
+        }
+    }
+}
+
+void begin() {
+#if DIAG_USE_USB_SERIAL_JTAG
+    Serial.setTxTimeoutMs(0);
+#else
+    uart_config_t config = {};
+    config.baud_rate = DIAG_UART_BAUD;
+    config.data_bits = UART_DATA_8_BITS;
+    config.parity = UART_PARITY_DISABLE;
+    config.stop_bits = UART_STOP_BITS_1;
+    config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    config.source_clk = UART_SCLK_APB;
+    uart_driver_install(DIAG_UART, 256, 2 * CHUNK_SIZE, 0, nullptr, 0);
+    uart_param_config(DIAG_UART, &config);
+    uart_set_pin(DIAG_UART, DIAG_UART_TX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+#endif
+    task_layout::create_task(task_layout::DIAG, drain_task_main, &drain_task);
+}
+
+/**
+ * @brief バッファに書き込む
+ * @param count_drop 入りきらなかったときに捨てた量に数える
+ * @return 全部書けたらtrue（入りきらなければ何も書かない）
+ */
+static bool push(const void *data, size_t length, bool count_drop) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    bool wake = false;
+    portENTER_CRITICAL_SAFE(&buffer_mux);
+    bool fits = used + length <= BUFFER_SIZE;
+    if (fits) {
+        // 空から書かれたときと，WAKE_THRESHOLD を超えたときだけ吐き出すタスクを起こす
+        wake = used == 0 || (used < WAKE_THRESHOLD && used + length >= WAKE_THRESHOLD);
+        size_t first = min(length, BUFFER_SIZE - head);
+        memcpy(buffer + head, bytes, first);
+        memcpy(buffer, bytes + first, length - first);
+        head = (head + length) % BUFFER_SIZE;
+        used += length;
+        if (used > current.max_used_bytes) {
+            current.max_used_bytes = used;
+        }
+    } else if (count_drop) {
+        current.dropped_bytes += length;
+    }
+    portEXIT_CRITICAL_SAFE(&buffer_mux);
+    if (wake && drain_task != nullptr) {
+        xTaskNotifyGive(drain_task);
+    }
+    return fits;
+}
+
+bool write(const void *data, size_t length) {
+    return push(data, length, true);
+}
+
+#if DIAG_USE_USB_SERIAL_JTAG
+/**
+ * @brief コンソールの文字列をバッファに通す（loop()から書くので，入りきらなければ少し待ってよい）
+ */
+class ConsoleOutput : public Print {
+public:
+    using Print::write;
+
+    size_t write(uint8_t value) override {
+        return write(&value, 1);
+    }
+
+    size_t write(const uint8_t *data, size_t length) override {
+        size_t written = 0;
+        while (written < length) {
+            // BUFFER_SIZE までは1回で入れるので，間にフレームが割り込まない
+            size_t piece = min(length - written, BUFFER_SIZE);
+            TickType_t start = xTaskGetTickCount();
+            while (!push(data + written, piece, false)) {
+                if (xTaskGetTickCount() - start >= CONSOLE_WAIT) {
+                    // 待っても空かなければ最後にもう一度だけ試し，入らなければ捨てた量に数える
+                    return push(data + written, piece, true) ? written + piece : written;
+                }
+                vTaskDelay(1);
+            }
+            written += piece;
+        }
+        return written;
+    }
+};
+
+static ConsoleOutput console_print;
+#endif
+
+Print &console_output() {
+#if DIAG_USE_USB_SERIAL_JTAG
+    return console_print;
+#else
+    return Serial;
+#endif
+}
+
+void set_trace_enabled(bool enabled) {
+    tracing.store(enabled);
+}
+
+bool trace_enabled() {
+    return tracing.load();
+}
+
+void trace_motion(const MotionTrace &trace) {
+    if (!tracing.load()) {
+        return;
+    }
+    uint8_t frame[2 + sizeof(MotionTrace)];
+    frame[0] = TRACE_FRAME_START;
+    frame[1] = sizeof(MotionTrace);
+    memcpy(frame + 2, &trace, sizeof(MotionTrace));
+    write(frame, sizeof(frame));
+}
+
+Stats stats() {
+    portENTER_CRITICAL(&buffer_mux);
+    Stats result = current;
+    portEXIT_CRITICAL(&buffer_mux);
+    return result;
+}
+
+} // namespace diag_transport
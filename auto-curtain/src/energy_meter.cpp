@@ -0,0 +1,53 @@
+/**
+ * @file energy_meter.cpp
+ * @brief モーターの電力量を移動ごとと累積で積算する
+ */
+#include "energy_meter.h"
+
+#include <atomic>
+#include "seqlock.h"
+
+namespace energy_meter {
+
+// 制御周期（書き込み側）とloop（読み出し側）で共有する
+static Seqlock<Totals> published_totals;
+// 制御周期からしか触らない
+static Totals current_totals = {};
+
+// 移動中の積算値．制御周期からしか触らないのでロック不要
+static uint64_t move_nj = 0;
+static std::atomic<bool> report_pending(false);
+
+void begin_move() {
+    move_nj = 0;
+}
+
+void sample(uint32_t voltage_mv, uint32_t current_ma, uint32_t dt_us) {
+    // mV * mA = uW，uW * us = pJ なので 1000 で割って nJ にする
+    uint64_t power_uw = static_cast<uint64_t>(voltage_mv) * current_ma;
+    move_nj += power_uw * dt_us / 1000;
+}
+
+void end_move() {
+    current_totals.cumulative_nj += move_nj;
+    current_totals.last_move_nj = move_nj;
+    current_totals.move_count++;
+    published_totals.write(current_totals);
+    report_pending.store(true);
+}
+
+void restore(const Totals &saved) {
+    current_totals = saved;
+    current_totals.last_move_nj = 0;
+    published_totals.write(current_totals);
+}
+
+Totals totals() {
+    return published_totals.read();
+}
+
+bool take_pending_report() {
+    return report_pending.exchange(false);
+}
+
+} // namespace energy_meter
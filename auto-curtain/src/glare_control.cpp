@@ -0,0 +1,238 @@
+/**
+ * @file glare_control.cpp
+ * @brief 直射日光をさえぎる分だけカーテンを閉める（グレア制御モード）
+ *
+ * @details
+ * 角度は1周を 2^32 とする整数（BAM），三角関数の値と単位ベクトルは Q30 で持つ．
+ * 太陽の方向（東，北，上）は，緯度 φ，赤緯 δ，時角 H から
+ *   east  = -cosδ sinH
+ *   north =  cosφ sinδ - sinφ cosδ cosH
+ *   up    =  sinφ sinδ + cosφ cosδ cosH
+ */
+#include "glare_control.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "command_arbiter.h"
+#include "fixed_point.h"
+#include "motion.h"
+#include "sequencer.h"
+#include "wall_clock.h"
+
+namespace glare_control {
+
+const char *PREFERENCES_NAMESPACE = "glare";
+const char *KEY_CONFIG = "config";
+
+// 更新の間隔 [s]．この間隔ぶんの時角の回転をあらかじめ求めておく
+const uint32_t UPDATE_INTERVAL_S = 5 * 60;
+// 予定の時刻からこれ以上遅れたら（時刻の再設定など）1日分の計算からやり直す [s]
+const uint32_t MAX_LATENESS_S = 60;
+// 位置を変える最小の幅と，1回で変える最大の幅
+const uint16_t MIN_STEP_100THS = 200;
+const uint16_t MAX_STEP_100THS = 1000;
+
+using fixed_point::Q30_ONE;
+using fixed_point::mul_q30;
+using fixed_point::sin_cos;
+const uint32_t SECONDS_PER_DAY = 24 * 60 * 60;
+// 赤緯の振幅 23.44度 [BAM]
+const int64_t DECLINATION_AMPLITUDE_BAM = 279650093;
+// 2000-03-20（春分のころ）の1970-01-01からの日数と，1年を 2^32 とする1日あたりの角度
+const int32_t EQUINOX_DAY = 11036;
+const int64_t YEAR_ANGLE_PER_DAY = 11759256; // 2^32 / 365.2422
+
+static Config current_config = {false, 356812, 1397671, 180, 50, motion::POSITION_100THS_MAX};
+static Stats current_stats = {};
+static sequencer::Flow glare_flow;
+
+// ここから下はloopタスク（フロー）からしか触らない
+static bool day_valid = false;
+static uint32_t computed_day = 0;
+static uint64_t next_update_utc = 0;
+static int32_t sin_lat = 0, cos_lat = 0;
+static int32_t sin_decl = 0, cos_decl = 0;
+static int32_t sin_window = 0, cos_window = 0;
+static int32_t sin_hour = 0, cos_hour = 0;   // 時角（更新のたびに回転させる）
+static int32_t sin_step = 0, cos_step = 0;   // 1回の更新での時角の回転
+static uint16_t last_commanded = 0;
+
+/**
+ * @brief 1e-4度を BAM に変換する
+ */
+static uint32_t degrees_1e4_to_bam(int32_t degrees_1e4) {
+    return static_cast<uint32_t>((static_cast<int64_t>(degrees_1e4) << 32) / 3600000);
+}
+
+/**
+ * @brief 秒を時角の BAM に変換する（1日で1周）
+ */
+static uint32_t seconds_to_hour_bam(int64_t seconds) {
+    return static_cast<uint32_t>((seconds << 32) / SECONDS_PER_DAY);
+}
+
+/**
+ * @brief 1日分の値（赤緯，均時差）と現在の時角を計算し直す
+ */
+static void compute_day(uint64_t utc) {
+    computed_day = utc / SECONDS_PER_DAY;
+
+    sin_cos(degrees_1e4_to_bam(current_config.latitude_1e4), &sin_lat, &cos_lat);
+    sin_cos(degrees_1e4_to_bam(current_config.window_azimuth_deg * 10000), &sin_window, &cos_window);
+
+    // 春分からの1年を1周とする角度 B
+    int32_t sin_b, cos_b, sin_2b, cos_2b;
+    uint32_t year_angle = static_cast<uint32_t>((static_cast<int64_t>(computed_day) - EQUINOX_DAY) * YEAR_ANGLE_PER_DAY);
+    sin_cos(year_angle, &sin_b, &cos_b);
+    sin_cos(year_angle * 2, &sin_2b, &cos_2b);
+
+    // 赤緯 δ = 23.44度 * sin B
+    sin_cos(static_cast<uint32_t>((DECLINATION_AMPLITUDE_BAM * sin_b) >> 30), &sin_decl, &cos_decl);
+    // 均時差 [s] = 592.2 sin 2B - 451.8 cos B - 90 sin B
+    int64_t equation_of_time = (5922LL * sin_2b - 4518LL * cos_b - 900LL * sin_b) / 10 >> 30;
+
+    // 時角 H = 地方太陽時 - 12時（経度1度あたり240秒）
+    int64_t solar_seconds = static_cast<int64_t>(utc % SECONDS_PER_DAY) + current_config.longitude_1e4 * 3 / 125 + equation_of_time;
+    sin_cos(seconds_to_hour_bam(solar_seconds - SECONDS_PER_DAY / 2), &sin_hour, &cos_hour);
+    sin_cos(seconds_to_hour_bam(UPDATE_INTERVAL_S), &sin_step, &cos_step);
+    day_valid = true;
+}
+
+/**
+ * @brief 時角を1回分進め，窓に日が差し込む割合を求める
+ * @return 差し込む割合 [Q30]
+ */
+static int32_t advance_and_evaluate() {
+    // 時角の回転（複素数の掛け算）と，長さを1に戻す補正（1回のニュートン法）
+    int32_t s = mul_q30(sin_hour, cos_step) + mul_q30(cos_hour, sin_step);
+    int32_t c = mul_q30(cos_hour, cos_step) - mul_q30(sin_hour, sin_step);
+    int32_t norm = (3 * static_cast<int64_t>(Q30_ONE) - mul_q30(s, s) - mul_q30(c, c)) / 2;
+    sin_hour = mul_q30(s, norm);
+    cos_hour = mul_q30(c, norm);
+
+    int32_t cos_decl_cos_hour = mul_q30(cos_decl, cos_hour);
+    int32_t up = mul_q30(sin_lat, sin_decl) + mul_q30(cos_lat, cos_decl_cos_hour);
+    int32_t east = -mul_q30(cos_decl, sin_hour);
+    int32_t north = mul_q30(cos_lat, sin_decl) - mul_q30(sin_lat, cos_decl_cos_hour);
+    current_stats.sun_up_q30 = up;
+    current_stats.sun_east_q30 = east;
+    current_stats.sun_north_q30 = north;
+
+    // 窓の正面方向の水平成分．0以下なら日は窓の裏側
+    int32_t facing = mul_q30(east, sin_window) + mul_q30(north, cos_window);
+    if (up <= 0 || facing <= 0) {
+        return 0;
+    }
+    // ひさしの影の長さの比 = ひさしの比 * up / facing
+    int64_t shadow = static_cast<int64_t>(up) * current_config.overhang_percent / 100;
+    if (shadow >= facing) {
+        return 0;
+    }
+    return static_cast<int32_t>(((facing - shadow) << 30) / facing);
+}
+
+/**
+ * @brief 目標位置に向けて，幅を制限して位置を変える
+ */
+static void adjust(uint16_t target) {
+    if (motion::state() == motion::State::MOVING) {
+        return;
+    }
+    int32_t position = motion::position_100ths();
+    if (current_stats.overridden) {
+        return;
+    }
+    if (abs(position - static_cast<int32_t>(last_commanded)) > MIN_STEP_100THS) {
+        // 前回の指令から動かされている．日が外れるまでは手を出さない
+        current_stats.overridden = true;
+        return;
+    }
+    int32_t difference = static_cast<int32_t>(target) - position;
+    if (abs(difference) < MIN_STEP_100THS) {
+        return;
+    }
+    difference = constrain(difference, -static_cast<int32_t>(MAX_STEP_100THS), static_cast<int32_t>(MAX_STEP_100THS));
+    uint16_t next = static_cast<uint16_t>(position + difference);
+    command_arbiter::Command command = {command_arbiter::Source::SCHEDULE, command_arbiter::Action::MOVE_TO, next};
+    if (command_arbiter::submit(command) != command_arbiter::Result::SUPPRESSED) {
+        last_commanded = next;
+    }
+}
+
+/**
+ * @brief 1回分の更新
+ */
+static void update(uint64_t utc) {
+    uint32_t start = ESP.getCycleCount();
+    if (!day_valid || utc / SECONDS_PER_DAY != computed_day ||
+        utc > next_update_utc + MAX_LATENESS_S || utc + MAX_LATENESS_S < next_update_utc) {
+        // 日が変わった，または時刻が飛んだ．ここから1日分を計算し直し，次の回転で今の時角になるように戻しておく
+        compute_day(utc - UPDATE_INTERVAL_S);
+        next_update_utc = utc;
+    }
+    int32_t sunlit = advance_and_evaluate();
+    next_update_utc += UPDATE_INTERVAL_S;
+    uint32_t cycles = ESP.getCycleCount() - start;
+
+    current_stats.last_cycles = cycles;
+    if (cycles > current_stats.max_cycles) {
+        current_stats.max_cycles = cycles;
+    }
+    current_stats.sunlit_100ths = static_cast<uint16_t>((static_cast<int64_t>(sunlit) * motion::POSITION_100THS_MAX) >> 30);
+    current_stats.target_100ths = static_cast<uint16_t>((static_cast<int64_t>(sunlit) * current_config.max_close_100ths) >> 30);
+    if (sunlit == 0 && motion::state() != motion::State::MOVING) {
+        // 日が外れている間は手で動かしてよいので，今の位置を指令した位置とみなして次に日が差したときの比較に使う
+        current_stats.overridden = false;
+        last_commanded = static_cast<uint16_t>(motion::position_100ths());
+    }
+    adjust(current_stats.target_100ths);
+}
+
+/**
+ * @brief グレア制御のフロー．有効で時刻が分かっていれば一定間隔で更新する
+ */
+static sequencer::Status run_glare(sequencer::Flow &flow) {
+    SEQ_BEGIN(flow);
+    while (true) {
+        SEQ_WAIT_UNTIL(flow, current_config.enabled && wall_clock::is_set());
+        last_commanded = motion::position_100ths();
+        current_stats.overridden = false;
+        day_valid = false;
+        while (current_config.enabled) {
+            update(wall_clock::now_utc());
+            // 時刻が戻されたときも待ち続けないようにする
+            SEQ_WAIT_UNTIL(flow, !current_config.enabled || wall_clock::now_utc() >= next_update_utc ||
+                                 wall_clock::now_utc() + UPDATE_INTERVAL_S < next_update_utc);
+        }
+    }
+    SEQ_END(flow);
+}
+
+void begin() {
+    Preferences preferences;
+    preferences.begin(PREFERENCES_NAMESPACE, true);
+    if (preferences.getBytesLength(KEY_CONFIG) == sizeof(Config)) {
+        preferences.getBytes(KEY_CONFIG, &current_config, sizeof(Config));
+    }
+    preferences.end();
+    sequencer::add(glare_flow, "glare", run_glare);
+}
+
+Config config() {
+    return current_config;
+}
+
+void set_config(const Config &config) {
+    current_config = config;
+    day_valid = false;
+    Preferences preferences;
+    preferences.begin(PREFERENCES_NAMESPACE, false);
+    preferences.putBytes(KEY_CONFIG, &current_config, sizeof(Config));
+    preferences.end();
+}
+
+Stats stats() {
+    return current_stats;
+}
+
+} // namespace glare_control
@@ -0,0 +1,295 @@
+/**
+ * @file log_store.cpp
+ * @brief 頻繁に変わる値（位置，積算値など）を専用パーティションに追記していくストア
+ *
+ * @details
+ * パーティションは4KBのセクタに分けてリングとして使う．
+ * 各セクタの先頭にはマジックと通し番号（sequence）を書き，その後ろにレコードを並べる．
+ * レコードは {キー, 長さ, CRC8, 0} の4バイトのヘッダと，4バイト境界にそろえた値．
+ * キーが 0xFF なら未使用領域（そのセクタのレコードはそこまで）．
+ * 起動時はセクタを通し番号で並べ替えて古い順に読み，ほかから飛び離れた番号のセクタは壊れたものとして消す．
+ */
+#include "log_store.h"
+
+#include <esp_partition.h>
+#include <string.h>
+#include "sequencer.h"
+
+namespace log_store {
+
+const char *PARTITION_LABEL = "curtainlog";
+const esp_partition_subtype_t PARTITION_SUBTYPE = static_cast<esp_partition_subtype_t>(0x40);
+
+const uint32_t SECTOR_SIZE = 4096;
+const uint32_t MAX_SECTORS = 64;
+const uint32_t SECTOR_MAGIC = 0x43524C47; // "CRLG"
+const uint32_t ERASED = 0xFFFFFFFF;
+const uint32_t SECTOR_HEADER_SIZE = 8;
+const uint32_t RECORD_HEADER_SIZE = 4;
+const uint8_t KEY_FREE = 0xFF;
+const uint32_t NO_RECORD = 0xFFFFFFFF;
+// 詰め直しのフローはこの数の消去済みセクタを保つ
+const uint16_t RESERVED_SECTORS = 2;
+
+/**
+ * @brief レコードのヘッダ
+ */
+struct RecordHeader {
+    uint8_t key;
+    uint8_t length;
+    uint8_t crc;
+    uint8_t committed; ///< 0で書き込み済み
+};
+
+static const esp_partition_t *partition = nullptr;
+static uint32_t sector_count = 0;
+static uint32_t sector_sequence[MAX_SECTORS]; // ERASED なら消去済み
+static uint32_t head_sector = 0;
+static uint32_t head_offset = SECTOR_SIZE;    // 先頭セクタ内の次の書き込み位置
+static uint32_t next_sequence = 0;
+static uint32_t index[MAX_KEYS];              // キーごとの最新レコードの位置（パーティション先頭から）
+static sequencer::Flow compaction_flow;
+
+static uint32_t align4(uint32_t value) {
+    return (value + 3) & ~3u;
+}
+
+/**
+ * @brief CRC8（多項式 0x07）
+ */
+static uint8_t crc8(uint8_t key, const uint8_t *data, size_t length) {
+    uint8_t crc = 0;
+    auto feed = [&crc](uint8_t byte) {
+        crc ^= byte;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07) : static_cast<uint8_t>(crc << 1);
+        }
+    };
+    feed(key);
+    feed(static_cast<uint8_t>(length));
+    for (size_t i = 0; i < length; i++) {
+        feed(data[i]);
+    }
+    return crc;
+}
+
+static uint16_t count_free_sectors() {
+    uint16_t count = 0;
+    for (uint32_t i = 0; i < sector_count; i++) {
+        if (sector_sequence[i] == ERASED) count++;
+    }
+    return count;
+}
+
+/**
+ * @brief 1セクタ分のレコードを読み，索引を更新する
+ * @return 次の書き込み位置（セクタ内）．壊れたレコードがあれば SECTOR_SIZE（以後そのセクタには書かない）
+ */
+static uint32_t scan_sector(uint32_t sector) {
+    uint32_t base = sector * SECTOR_SIZE;
+    uint32_t offset = SECTOR_HEADER_SIZE;
+    uint8_t value[MAX_VALUE_LENGTH];
+    while (offset + RECORD_HEADER_SIZE <= SECTOR_SIZE) {
+        RecordHeader header;
+        esp_partition_read(partition, base + offset, &header, sizeof(header));
+        if (header.key == KEY_FREE) {
+            return offset;
+        }
+        if (header.key >= MAX_KEYS || header.length > MAX_VALUE_LENGTH || header.committed != 0 ||
+            offset + RECORD_HEADER_SIZE + header.length > SECTOR_SIZE) {
+            return SECTOR_SIZE;
+        }
+        esp_partition_read(partition, base + offset + RECORD_HEADER_SIZE, value, header.length);
+        if (crc8(header.key, value, header.length) != header.crc) {
+            return SECTOR_SIZE;
+        }
+        index[header.key] = base + offset;
+        offset += RECORD_HEADER_SIZE + align4(header.length);
+    }
+    return SECTOR_SIZE;
+}
+
+/**
+ * @brief 消去済みのセクタを次の先頭セクタにする
+ * @return 消去済みのセクタがなければfalse
+ */
+static bool open_next_sector() {
+    uint32_t next = (head_sector + 1) % sector_count;
+    if (sector_sequence[next] != ERASED) {
+        return false;
+    }
+    uint32_t header[2] = {SECTOR_MAGIC, next_sequence};
+    esp_partition_write(partition, next * SECTOR_SIZE, header, sizeof(header));
+    sector_sequence[next] = next_sequence++;
+    head_sector = next;
+    head_offset = SECTOR_HEADER_SIZE;
+    return true;
+}
+
+/**
+ * @brief 先頭セクタの末尾にレコードを追記する
+ */
+static bool append(uint8_t key, const uint8_t *value, uint8_t length) {
+    uint32_t size = RECORD_HEADER_SIZE + align4(length);
+    if (head_offset + size > SECTOR_SIZE && !open_next_sector()) {
+        return false;
+    }
+
+    uint8_t record[RECORD_HEADER_SIZE + MAX_VALUE_LENGTH];
+    memset(record, 0xFF, sizeof(record));
+    RecordHeader header = {key, length, crc8(key, value, length), 0};
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + RECORD_HEADER_SIZE, value, length);
+
+    uint32_t address = head_sector * SECTOR_SIZE + head_offset;
+    if (esp_partition_write(partition, address, record, size) != ESP_OK) {
+        // 途中まで書けているかもしれないので，このセクタにはもう書かない
+        head_offset = SECTOR_SIZE;
+        return false;
+    }
+    index[key] = address;
+    head_offset += size;
+    return true;
+}
+
+/**
+ * @brief 一番古いセクタを詰め直す．生きているレコードを先頭セクタに写してから消去する
+ * @return 詰め直したらtrue
+ */
+static bool compact_oldest() {
+    // リングの順で，先頭の後ろに続く消去済みセクタの次が一番古い
+    uint32_t oldest = (head_sector + 1) % sector_count;
+    for (uint32_t i = 0; i < sector_count && sector_sequence[oldest] == ERASED; i++) {
+        oldest = (oldest + 1) % sector_count;
+    }
+    if (oldest == head_sector || sector_sequence[oldest] == ERASED) {
+        return false;
+    }
+
+    uint32_t base = oldest * SECTOR_SIZE;
+    uint8_t value[MAX_VALUE_LENGTH];
+    for (uint8_t key = 0; key < MAX_KEYS; key++) {
+        if (index[key] == NO_RECORD || index[key] / SECTOR_SIZE != oldest) {
+            continue;
+        }
+        RecordHeader header;
+        esp_partition_read(partition, index[key], &header, sizeof(header));
+        esp_partition_read(partition, index[key] + RECORD_HEADER_SIZE, value, header.length);
+        if (!append(key, value, header.length)) {
+            return false;
+        }
+    }
+    esp_partition_erase_range(partition, base, SECTOR_SIZE);
+    sector_sequence[oldest] = ERASED;
+    return true;
+}
+
+/**
+ * @brief 詰め直しのフロー．消去済みセクタが減ったら1周期に1セクタずつ詰め直す
+ */
+static sequencer::Status run_compaction(sequencer::Flow &flow) {
+    SEQ_BEGIN(flow);
+    while (true) {
+        SEQ_SLEEP(flow, 1000);
+        while (count_free_sectors() < RESERVED_SECTORS && compact_oldest()) {
+            SEQ_YIELD(flow);
+        }
+    }
+    SEQ_END(flow);
+}
+
+bool begin() {
+    for (uint8_t key = 0; key < MAX_KEYS; key++) {
+        index[key] = NO_RECORD;
+    }
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, PARTITION_SUBTYPE, PARTITION_LABEL);
+    if (partition == nullptr) {
+        return false;
+    }
+    sector_count = partition->size / SECTOR_SIZE;
+    if (sector_count > MAX_SECTORS) sector_count = MAX_SECTORS;
+    next_sequence = 0;
+
+    // 使っているセクタを通し番号の順に並べる（挿入ソート．セクタは多くても MAX_SECTORS 個）
+    uint32_t order[MAX_SECTORS];
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < sector_count; i++) {
+        uint32_t header[2];
+        esp_partition_read(partition, i * SECTOR_SIZE, header, sizeof(header));
+        sector_sequence[i] = ERASED;
+        if (header[0] == SECTOR_MAGIC && header[1] != ERASED) {
+            sector_sequence[i] = header[1];
+            uint32_t n = used++;
+            while (n > 0 && sector_sequence[order[n - 1]] > header[1]) {
+                order[n] = order[n - 1];
+                n--;
+            }
+            order[n] = i;
+        } else if (header[0] != ERASED || header[1] != ERASED) {
+            // 書きかけのセクタヘッダ．消しておく
+            esp_partition_erase_range(partition, i * SECTOR_SIZE, SECTOR_SIZE);
+        }
+    }
+
+    // セクタは1つずつ順に開くので，生きているセクタの通し番号は連続した sector_count 個の中に収まる．
+    // 一番多くのセクタが収まる範囲を選び，外れたセクタ（ヘッダが壊れて番号が飛んだもの）は消す．
+    // 同じ数なら古い範囲を選ぶ（書きかけのフラッシュはビットが1のまま残るので，壊れた番号は大きくなる）
+    uint32_t kept_first = 0;
+    uint32_t kept_count = 0;
+    for (uint32_t first = 0, last = 0; first < used; first++) {
+        while (last + 1 < used && sector_sequence[order[last + 1]] - sector_sequence[order[first]] < sector_count) {
+            last++;
+        }
+        if (last - first + 1 > kept_count) {
+            kept_first = first;
+            kept_count = last - first + 1;
+        }
+    }
+
+    // 空のパーティションなら，最後のセクタを先頭扱いにすると最初の書き込みでセクタ0が開く
+    head_sector = sector_count - 1;
+    head_offset = SECTOR_SIZE;
+    // 通し番号の順に1回ずつ読む．後から読んだレコードが新しく，最後のセクタが先頭になる
+    for (uint32_t n = 0; n < used; n++) {
+        uint32_t i = order[n];
+        if (n < kept_first || n >= kept_first + kept_count) {
+            esp_partition_erase_range(partition, i * SECTOR_SIZE, SECTOR_SIZE);
+            sector_sequence[i] = ERASED;
+            continue;
+        }
+        head_sector = i;
+        head_offset = scan_sector(i);
+        next_sequence = sector_sequence[i] + 1;
+    }
+
+    sequencer::add(compaction_flow, "log_compaction", run_compaction);
+    return true;
+}
+
+bool write(uint8_t key, const void *value, size_t length) {
+    if (partition == nullptr || key >= MAX_KEYS || length > MAX_VALUE_LENGTH) {
+        return false;
+    }
+    // 詰め直しが追いついていなければここで詰め直す（最後の消去済みセクタは空けておく）
+    while (count_free_sectors() < RESERVED_SECTORS && compact_oldest()) {
+    }
+    return append(key, static_cast<const uint8_t *>(value), static_cast<uint8_t>(length));
+}
+
+bool read(uint8_t key, void *value, size_t length) {
+    if (partition == nullptr || key >= MAX_KEYS || index[key] == NO_RECORD) {
+        return false;
+    }
+    RecordHeader header;
+    esp_partition_read(partition, index[key], &header, sizeof(header));
+    if (header.length != length) {
+        return false;
+    }
+    return esp_partition_read(partition, index[key] + RECORD_HEADER_SIZE, value, length) == ESP_OK;
+}
+
+uint16_t free_sectors() {
+    return count_free_sectors();
+}
+
+} // namespace log_store
@@ -11,42 +11,129 @@
  *   - トグルボタン（デフォルトではGPIO0 - リセットボタンに接
  */
 #include <Arduino.h>
+#include <atomic>
 #include "Matter.h"
 #include <app/server/OnboardingCodesUtil.h>
 #include <credentials/examples/DeviceAttestationCredsExample.h>
+#include "bench.h"
+#include "ble_release.h"
+#include "board_config.h"
+#include "bridge.h"
+#include "command_arbiter.h"
+#include "console.h"
+#include "device_flows.h"
+#include "diag_transport.h"
+#include "energy_meter.h"
+#include "glare_control.h"
+#include "log_store.h"
+#include "maintenance.h"
+#include "motion.h"
+#include "motor_bus.h"
+#include "remote_input.h"
+#include "schedule.h"
+#include "sequencer.h"
+#include "subscription_monitor.h"
+#include "time_sync.h"
+#include "tlog.h"
+#include "touch_monitor.h"
+#include "usage_history.h"
+#include "wall_clock.h"
+#include "wifi_fast_connect.h"
 namespace clusters = chip::app::Clusters;
 namespace em = esp_matter;
 
-// PINを設定してください
-const int LED_PIN = D0;
-const int TOGGLE_BUTTON_PIN = D9;
-
 // トグルボタンのチャッタリング防止時間と状態を覚えておくための変数
 const int DEBOUNCE_DELAY = 500;
 int last_toggle;
 
 // Matterライトデバイスで使用されるクラスターと属性ID
+// クラスターを足したときは device_model.json にも書くこと（custom_device_model を有効にすると，書かないクラスターの実装はビルドから外れる）
 // const uint32_t CLUSTER_ID = clusters::OnOff::Id;
 // const uint32_t ATTRIBUTE_ID = clusters::OnOff::Attributes::OnOff::Id;
 const uint32_t CLUSTER_ID_CURTAIN = clusters::WindowCovering::Id;
 const uint32_t ATTRIBUTE_ID_CURTAIN = clusters::WindowCovering::Attributes::OperationalStatus::Id;
+const uint32_t ATTRIBUTE_ID_TARGET_POSITION = clusters::WindowCovering::Attributes::TargetPositionLiftPercent100ths::Id;
+const uint32_t ATTRIBUTE_ID_CURRENT_POSITION = clusters::WindowCovering::Attributes::CurrentPositionLiftPercent100ths::Id;
+
+// Electrical Energy Measurement クラスター（esp32-arduino-matterのZAP生成物に含まれないのでIDを直接書く）
+const uint32_t CLUSTER_ID_ENERGY = 0x0091;
+const uint32_t ATTRIBUTE_ID_CUMULATIVE_ENERGY_IMPORTED = 0x0001;
+const uint32_t ATTRIBUTE_ID_PERIODIC_ENERGY_IMPORTED = 0x0003;
+const uint32_t ENERGY_FEATURE_MAP = 0x01 | 0x04 | 0x08; // ImportedEnergy | CumulativeEnergy | PeriodicEnergy
+const uint32_t DEVICE_TYPE_ID_ELECTRICAL_SENSOR = 0x0510;
+const uint32_t CLUSTER_ID_POWER_TOPOLOGY = 0x009C;
+const uint32_t POWER_TOPOLOGY_FEATURE_MAP = 0x01; // NodeTopology（ノード全体の分を測る．モーターがほぼすべて）
+
+// スケジュールを編集するためのベンダー独自クラスター（テスト用ベンダーID 0xFFF1）
+const uint32_t CLUSTER_ID_SCHEDULE = 0xFFF1FC01;
+const uint32_t ATTRIBUTE_ID_SCHEDULE_ENTRIES = 0x0000;    // schedule::Entry を並べたバイト列（書き込み可）
+const uint32_t ATTRIBUTE_ID_SCHEDULE_NEXT_EVENT = 0x0001; // 次のイベントの時刻（月曜 0:00 からの分）
+
+// 予知保全の診断情報を公開するベンダー独自クラスター
+const uint32_t CLUSTER_ID_MAINTENANCE = 0xFFF1FC02;
+const uint32_t ATTRIBUTE_ID_MAINTENANCE_FLAGS = 0x0000;      // 保守フラグ（maintenance::FLAG_*）
+const uint32_t ATTRIBUTE_ID_TRAVEL_TIME = 0x0001;            // 全行程あたりの移動時間の傾向 [ms]
+const uint32_t ATTRIBUTE_ID_PEAK_CURRENT = 0x0002;           // 電流の最大値の傾向 [mA]
+const uint32_t ATTRIBUTE_ID_STALL_RATE = 0x0003;             // ストールの率 [%]
+
+// ブリッジモードのアグリゲーターとブリッジ先のエンドポイント（device_model_bridge.json）
+const uint32_t DEVICE_TYPE_ID_AGGREGATOR = 0x000E;
+const uint32_t DEVICE_TYPE_ID_BRIDGED_NODE = 0x0013;
+const uint32_t CLUSTER_ID_BRIDGED_DEVICE_BASIC_INFORMATION = 0x0039;
+const uint32_t ATTRIBUTE_ID_NODE_LABEL = 0x0005;
+const uint32_t ATTRIBUTE_ID_REACHABLE = 0x0011;
+
+// 位置と動作状態をMatterへ報告する間隔
+const uint32_t REPORT_INTERVAL = 200;
+uint32_t last_report;
 
 // Matterデバイスに割り当てられるエンドポイントと属性参照
 // uint16_t light_endpoint_id = 0;
 uint16_t curtain_endpoint_id = 0;
+uint16_t energy_endpoint_id = 0;
+// バスのモーターごとのエンドポイント（ブリッジモードのときだけ）
+uint16_t bridged_endpoint_ids[motor_bus::MAX_MOTORS];
+uint8_t bridged_count = 0;
 em::attribute_t *attribute_ref;
+// 本体の指令に合わせて目標位置の属性を書き換えている間はその値（なければ -1）．
+// その書き換えは調停で受け付け済みなので，on_attribute_update でリモートの指令として渡し直さない
+static std::atomic<int32_t> own_target_update(-1);
 
 
-// いろいろなデバイスのイベントを聴取する可能性があるけど、ここでは使わないので空欄にしておく
-// セットアッププロセスに関連するさまざまなデバイスイベントをリッスンする可能性があります
-// 簡潔にするために空のままにしています
 /**
   * @brief デバイスイベントのリスナー。
-  * この例では、デバイスイベントをリッスンしていません。
+  * コミッショニング窓の開閉をシーケンサのフローに知らせる．
+  * IPアドレスが割り当てられたら，起動からオンラインまでの時間を記録する．
+  * サーバーの準備ができたら，サブスクリプションが戻るまでの時間の計測とコントローラーとの時刻同期を始める．
   * @param event デバイスイベント
   * @param arg ユーザー定義の引数
   */
-static void on_device_event(const ChipDeviceEvent *event, intptr_t arg) {}
+static void on_device_event(const ChipDeviceEvent *event, intptr_t arg) {
+    switch (event->Type) {
+    case chip::DeviceLayer::DeviceEventType::kCommissioningWindowOpened:
+        device_flows::notify_commissioning_window(true);
+        break;
+    case chip::DeviceLayer::DeviceEventType::kCommissioningWindowClosed:
+        device_flows::notify_commissioning_window(false);
+        break;
+    case chip::DeviceLayer::DeviceEventType::kServerReady:
+        subscription_monitor::begin();
+        time_sync::notify_server_ready();
+        ble_release::release_if_commissioned();
+        break;
+    case chip::DeviceLayer::DeviceEventType::kCommissioningComplete:
+        ble_release::release_if_commissioned();
+        break;
+    case chip::DeviceLayer::DeviceEventType::kInterfaceIpAddressChanged:
+        if (event->InterfaceIpAddressChanged.Type == chip::DeviceLayer::InterfaceIpChangeType::kIpV4_Assigned ||
+            event->InterfaceIpAddressChanged.Type == chip::DeviceLayer::InterfaceIpChangeType::kIpV6_Assigned) {
+            wifi_fast_connect::notify_online();
+        }
+        break;
+    default:
+        break;
+    }
+}
 static esp_err_t on_identification(em::identification::callback_type_t type, uint16_t endpoint_id,
                    uint8_t effect_id, uint8_t effect_variant, void *priv_data) {
     return ESP_OK;
@@ -79,30 +166,187 @@ static esp_err_t on_identification(em::identification::callback_type_t type, uin
 //     return ESP_OK;
 // }
 
+#if defined(CURTAIN_BRIDGE_MODE)
+/**
+ * @brief エンドポイントがバスの何台目のモーターか
+ * @return ブリッジ先のエンドポイントでなければ -1
+ */
+static int bridged_motor_index(uint16_t endpoint_id) {
+    for (uint8_t i = 0; i < bridged_count; i++) {
+        if (bridged_endpoint_ids[i] == endpoint_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+#endif
+
 static esp_err_t on_attribute_update(em::attribute::callback_type_t type, uint16_t endpoint_id, uint32_t cluster_id,
                    uint32_t attribute_id, esp_matter_attr_val_t *val, void *priv_data) {
     if (type == em::attribute::PRE_UPDATE) {
-        Serial.print("Update on endpoint: ");
-        Serial.print(endpoint_id);
-        Serial.print(" cluster: ");
-        Serial.print(cluster_id);
-        Serial.print(" attribute: ");
-        Serial.println(attribute_id);
+        TLOG("Update on endpoint: %u cluster: %lu attribute: %lu", endpoint_id,
+             static_cast<unsigned long>(cluster_id), static_cast<unsigned long>(attribute_id));
 
         if(endpoint_id == curtain_endpoint_id &&
         cluster_id == CLUSTER_ID_CURTAIN && attribute_id == ATTRIBUTE_ID_CURTAIN) { // OperationalStatus Attribute
             // カーテンのattributeの更新を受け取りました
             // bool new_state = val->val.b;
             uint8_t new_state = val->val.u8;
-            Serial.print("OperationalStatus: ");
-            Serial.println(new_state);
+            TLOG("OperationalStatus: %u", new_state);
             // digitalWrite(LED_PIN, new_state);
         }
+
+        if(endpoint_id == curtain_endpoint_id &&
+        cluster_id == CLUSTER_ID_CURTAIN && attribute_id == ATTRIBUTE_ID_TARGET_POSITION) {
+            // 目標位置が変わったので移動を指令する（移動は制御周期で行う）
+            uint16_t target = val->val.u16;
+            TLOG("TargetPosition: %u", target);
+            command_arbiter::Command command = {command_arbiter::Source::REMOTE, command_arbiter::Action::MOVE_TO, target};
+            if (own_target_update.load() == static_cast<int32_t>(target)) {
+                // 本体の指令で受け付け済みの目標を属性に合わせただけ
+            } else if (command_arbiter::submit(command) == command_arbiter::Result::SUPPRESSED) {
+                // 優先度の高い指令が有効なので，属性の更新ごと断る
+                TLOG("TargetPosition suppressed");
+                return ESP_FAIL;
+            }
+        }
+
+#if defined(CURTAIN_BRIDGE_MODE)
+        // バスのモーターの目標位置は，次のトランザクションでバスのタスクが書き込む
+        int bus_index = bridged_motor_index(endpoint_id);
+        if (bus_index >= 0 && cluster_id == CLUSTER_ID_CURTAIN && attribute_id == ATTRIBUTE_ID_TARGET_POSITION) {
+            motor_bus::set_target(static_cast<uint8_t>(bus_index), val->val.u16);
+        }
+#endif
+
+        if(endpoint_id == curtain_endpoint_id &&
+        cluster_id == CLUSTER_ID_SCHEDULE && attribute_id == ATTRIBUTE_ID_SCHEDULE_ENTRIES) {
+            // スケジュールの表を丸ごと置き換える．形式が正しくなければ書き込みを断る
+            if (!schedule::set_entries(val->val.a.b, val->val.a.s)) {
+                TLOG("Schedule rejected");
+                return ESP_FAIL;
+            }
+        }
     }
     return ESP_OK;
 }
 
 
+/**
+ * @brief Matterの属性の読み出し（属性の表を引いて値を取り出す）のベンチマーク
+ */
+static void bench_attribute_get(uint32_t iterations) {
+    esp_matter_attr_val_t value = esp_matter_invalid(NULL);
+    for (uint32_t i = 0; i < iterations; i++) {
+        em::attribute_t *attribute = em::attribute::get(curtain_endpoint_id, CLUSTER_ID_CURTAIN, ATTRIBUTE_ID_CURRENT_POSITION);
+        em::attribute::get_val(attribute, &value);
+    }
+    bench::keep(value);
+}
+
+/**
+ * @brief 実機だけで測るベンチマークを足す（コンソールの bench で走らせる）
+ */
+static void register_benchmarks() {
+    bench::add("attribute_get", bench_attribute_get);
+}
+
+/**
+ * @brief モーターの電力量を公開するエンドポイントを作成する
+ * 
+ * 累積と直前の移動1回分の電力量をmWhで持つ．
+ * このバージョンのesp_matterは構造体型の属性を作れないので，仕様どおりではないところがある．
+ * - CumulativeEnergyImported と PeriodicEnergyImported は EnergyMeasurementStruct の energy フィールドだけを
+ *   int64 の属性として公開している．
+ * - Electrical Energy Measurement の必須の属性 Accuracy（MeasurementAccuracyStruct）は作れず，ない．
+ * 認証テストやコントローラーによっては Electrical Sensor として扱われないことがある．
+ * @param node Matterノード
+ */
+static void create_energy_endpoint(em::node_t *node) {
+    em::endpoint_t *endpoint = em::endpoint::create(node, em::ENDPOINT_FLAG_NONE, NULL);
+    em::endpoint::add_device_type(endpoint, DEVICE_TYPE_ID_ELECTRICAL_SENSOR, 1);
+    em::cluster::descriptor::create(endpoint, em::CLUSTER_FLAG_SERVER);
+
+    em::cluster_t *topology_cluster = em::cluster::create(endpoint, CLUSTER_ID_POWER_TOPOLOGY, em::CLUSTER_FLAG_SERVER);
+    em::cluster::global::attribute::create_feature_map(topology_cluster, POWER_TOPOLOGY_FEATURE_MAP);
+    em::cluster::global::attribute::create_cluster_revision(topology_cluster, 1);
+
+    em::cluster_t *cluster = em::cluster::create(endpoint, CLUSTER_ID_ENERGY, em::CLUSTER_FLAG_SERVER);
+    em::cluster::global::attribute::create_feature_map(cluster, ENERGY_FEATURE_MAP);
+    em::cluster::global::attribute::create_cluster_revision(cluster, 1);
+    em::attribute::create(cluster, ATTRIBUTE_ID_CUMULATIVE_ENERGY_IMPORTED, em::ATTRIBUTE_FLAG_NULLABLE, esp_matter_nullable_int64(0));
+    em::attribute::create(cluster, ATTRIBUTE_ID_PERIODIC_ENERGY_IMPORTED, em::ATTRIBUTE_FLAG_NULLABLE, esp_matter_nullable_int64(0));
+
+    energy_endpoint_id = em::endpoint::get_id(endpoint);
+    TLOG("Energy endpoint ID: %u", energy_endpoint_id);
+}
+
+#if defined(CURTAIN_BRIDGE_MODE)
+/**
+ * @brief バスのモーターごとに，アグリゲーターの下へ WindowCovering のエンドポイントを作成する（ブリッジモード）
+ * 
+ * モーターの数は bridge::begin() が読み出した設定で決まる．
+ * 到達できるかどうかは Bridged Device Basic Information の Reachable で知らせる．
+ * @param node Matterノード
+ * @param motor_count バスのモーターの数
+ */
+static void create_bridged_endpoints(em::node_t *node, uint8_t motor_count) {
+    em::endpoint_t *aggregator = em::endpoint::create(node, em::ENDPOINT_FLAG_NONE, NULL);
+    em::endpoint::add_device_type(aggregator, DEVICE_TYPE_ID_AGGREGATOR, 1);
+    em::cluster::descriptor::create(aggregator, em::CLUSTER_FLAG_SERVER);
+
+    for (uint8_t i = 0; i < motor_count; i++) {
+        em::endpoint::window_covering_device::config_t config;
+        config.window_covering.type = 0x04; // curtain
+        em::endpoint_t *endpoint = em::endpoint::window_covering_device::create(node, &config, em::ENDPOINT_FLAG_NONE, NULL);
+        em::endpoint::add_device_type(endpoint, DEVICE_TYPE_ID_BRIDGED_NODE, 1);
+        em::endpoint::set_parent_endpoint(endpoint, aggregator);
+
+        char label[16];
+        snprintf(label, sizeof(label), "Curtain %u", i + 1);
+        em::cluster_t *cluster = em::cluster::create(endpoint, CLUSTER_ID_BRIDGED_DEVICE_BASIC_INFORMATION, em::CLUSTER_FLAG_SERVER);
+        em::cluster::global::attribute::create_feature_map(cluster, 0);
+        em::cluster::global::attribute::create_cluster_revision(cluster, 1);
+        em::attribute::create(cluster, ATTRIBUTE_ID_NODE_LABEL, em::ATTRIBUTE_FLAG_NONE, esp_matter_char_str(label, strlen(label)));
+        em::attribute::create(cluster, ATTRIBUTE_ID_REACHABLE, em::ATTRIBUTE_FLAG_NONE, esp_matter_bool(false));
+
+        bridged_endpoint_ids[i] = em::endpoint::get_id(endpoint);
+    }
+    bridged_count = motor_count;
+    TLOG("Bridged %u motors from endpoint %u", motor_count, motor_count > 0 ? bridged_endpoint_ids[0] : 0);
+}
+#endif
+
+/**
+ * @brief スケジュールを編集するベンダー独自クラスターをカーテンのエンドポイントに追加する
+ * 
+ * 表は schedule::Entry を並べたバイト列の属性として丸ごと読み書きする．
+ * @param endpoint カーテンのエンドポイント
+ */
+static void create_schedule_cluster(em::endpoint_t *endpoint) {
+    em::cluster_t *cluster = em::cluster::create(endpoint, CLUSTER_ID_SCHEDULE, em::CLUSTER_FLAG_SERVER);
+    em::cluster::global::attribute::create_feature_map(cluster, 0);
+    em::cluster::global::attribute::create_cluster_revision(cluster, 1);
+    uint8_t *entries = reinterpret_cast<uint8_t *>(const_cast<schedule::Entry *>(schedule::entries()));
+    em::attribute::create(cluster, ATTRIBUTE_ID_SCHEDULE_ENTRIES, em::ATTRIBUTE_FLAG_WRITABLE,
+                          esp_matter_long_octet_str(entries, schedule::entry_count() * sizeof(schedule::Entry)));
+    em::attribute::create(cluster, ATTRIBUTE_ID_SCHEDULE_NEXT_EVENT, em::ATTRIBUTE_FLAG_NULLABLE, esp_matter_nullable_uint16(nullable<uint16_t>()));
+}
+
+/**
+ * @brief 予知保全の診断情報を公開するベンダー独自クラスターをカーテンのエンドポイントに追加する
+ * @param endpoint カーテンのエンドポイント
+ */
+static void create_maintenance_cluster(em::endpoint_t *endpoint) {
+    em::cluster_t *cluster = em::cluster::create(endpoint, CLUSTER_ID_MAINTENANCE, em::CLUSTER_FLAG_SERVER);
+    em::cluster::global::attribute::create_feature_map(cluster, 0);
+    em::cluster::global::attribute::create_cluster_revision(cluster, 1);
+    em::attribute::create(cluster, ATTRIBUTE_ID_MAINTENANCE_FLAGS, em::ATTRIBUTE_FLAG_NONE, esp_matter_bitmap8(0));
+    em::attribute::create(cluster, ATTRIBUTE_ID_TRAVEL_TIME, em::ATTRIBUTE_FLAG_NONE, esp_matter_uint32(0));
+    em::attribute::create(cluster, ATTRIBUTE_ID_PEAK_CURRENT, em::ATTRIBUTE_FLAG_NONE, esp_matter_uint32(0));
+    em::attribute::create(cluster, ATTRIBUTE_ID_STALL_RATE, em::ATTRIBUTE_FLAG_NONE, esp_matter_uint8(0));
+}
+
 /**
  * @brief Matterノードを初期化し、ライトエンドポイントを設定するためのセットアップ関数。
  * 
@@ -119,6 +363,8 @@ static esp_err_t on_attribute_update(em::attribute::callback_type_t type, uint16
  */
 void setup() {
     Serial.begin(115200);
+    // ログとトレースの出力先．これより前の TLOG もバッファに残っていて，ここから流れ始める
+    diag_transport::begin();
     pinMode(LED_PIN, OUTPUT);
     pinMode(TOGGLE_BUTTON_PIN, INPUT);
 
@@ -160,12 +406,59 @@ void setup() {
     // 生成されたエンドポイントIDを保存する
     // light_endpoint_id = em::endpoint::get_id(endpoint);
     curtain_endpoint_id = em::endpoint::get_id(endpoint);
-    Serial.print("Curtain endpoint ID: ");
-    Serial.println(curtain_endpoint_id);
+    TLOG("Curtain endpoint ID: %u", curtain_endpoint_id);
+
+    // 週単位のスケジュール（時刻はコントローラーの Time Synchronization クラスターから得る）
+    wall_clock::begin();
+    schedule::begin();
+    time_sync::begin();
+    // 南向きの窓などで直射日光をさえぎる分だけ閉める（コンソールの glare で有効にする）
+    glare_control::begin();
+    // 使われ方の記録（移動の完了と手で動かされた位置）
+    usage_history::begin();
+    create_schedule_cluster(endpoint);
+    // 移動ごとの統計から劣化の兆候を見つける
+    maintenance::begin();
+    create_maintenance_cluster(endpoint);
+
+    create_energy_endpoint(node);
+    register_benchmarks();
+#if defined(CURTAIN_BRIDGE_MODE)
+    // RS-485のバスのモーターをブリッジする（モーターの数は NVS の設定，コンソールの bus で変える）
+    create_bridged_endpoints(node, bridge::begin());
+#endif
+
+    // 前回止まった位置と電力量の積算値を読み出す（制御周期が動き出す前に）
+    int32_t saved_position = 0;
+    bool position_known = false;
+    if (log_store::begin()) {
+        position_known = log_store::read(log_store::KEY_POSITION, &saved_position, sizeof(saved_position));
+        energy_meter::Totals saved_totals;
+        if (log_store::read(log_store::KEY_ENERGY_TOTALS, &saved_totals, sizeof(saved_totals))) {
+            energy_meter::restore(saved_totals);
+        }
+    } else {
+        TLOG("curtainlog partition not found");
+    }
+
+    // モーターとエンコーダの制御を開始する
+    motion::begin();
+    if (position_known) {
+        motion::set_position_counts(saved_position);
+    }
+    // 手で引かれたら自動で開閉する
+    touch_monitor::begin();
+    // RF/IRリモコンの受信（RMT）
+    remote_input::begin();
+    // 原点出し，LED，コミッショニング窓の監視はloopの中のシーケンサで動かす
+    device_flows::begin(position_known);
     
     // DACをセットアップする（ここはカスタムのコミッションデータ、パスコードなどを設定するのに適しています）
     em::set_custom_dac_provider(chip::Credentials::Examples::GetExampleDACProvider());
 
+    // 前回のAPとIP設定で再接続できるように，Matterより先にWi-Fiイベントを受け取る
+    wifi_fast_connect::begin();
+
     // Matterデバイスを起動する
     em::start(on_device_event);
 
@@ -202,6 +495,183 @@ void set_curtain_attribute_value(esp_matter_attr_val_t* curtain_value) {
     em::attribute::update(curtain_endpoint_id, CLUSTER_ID_CURTAIN, ATTRIBUTE_ID_CURTAIN, curtain_value);
 }
 
+/**
+  * @brief 調停で受け付けた本体の指令の目標位置を，目標位置の属性に合わせる
+  * @param target 目標位置（0: 全開，10000: 全閉）
+  */
+static void update_own_target(uint16_t target) {
+    own_target_update.store(target);
+    esp_matter_attr_val_t target_value = esp_matter_nullable_uint16(target);
+    em::attribute::update(curtain_endpoint_id, CLUSTER_ID_CURTAIN, ATTRIBUTE_ID_TARGET_POSITION, &target_value);
+    own_target_update.store(-1);
+}
+
+/**
+  * @brief 本体からの指令を調停に渡し，受け付けたら目標位置の属性も合わせる
+  * @param command 移動指令
+  */
+void submit_local_command(const command_arbiter::Command &command) {
+    if (command_arbiter::submit(command) != command_arbiter::Result::ACCEPTED) {
+        return;
+    }
+    if (command.action == command_arbiter::Action::MOVE_TO) {
+        update_own_target(command.position_100ths);
+    }
+}
+
+/**
+  * @brief 本体のボタンの操作．動いていれば止め，止まっていれば反対側の端へ動かす
+  */
+void toggle_local() {
+    if (motion::state() == motion::State::MOVING) {
+        submit_local_command({command_arbiter::Source::LOCAL, command_arbiter::Action::STOP, 0});
+    } else {
+        uint16_t target = motion::position_100ths() < motion::POSITION_100THS_MAX / 2 ? motion::POSITION_100THS_MAX : 0;
+        submit_local_command({command_arbiter::Source::LOCAL, command_arbiter::Action::MOVE_TO, target});
+    }
+}
+
+/**
+  * @brief 過電流で止まったら安全の指令として調停に知らせる
+  * 以後ホールドオフの間はリモートやスケジュールの指令を受け付けない
+  */
+void check_obstruction() {
+    static motion::State last_state = motion::State::IDLE;
+    motion::State state = motion::state();
+    // 原点出しでは端に当てて止めるので障害物として扱わない
+    if (state == motion::State::STALLED && last_state != motion::State::STALLED && !device_flows::is_homing()) {
+        TLOG("Obstruction detected");
+        submit_local_command({command_arbiter::Source::SAFETY, command_arbiter::Action::STOP, 0});
+    }
+    last_state = state;
+}
+
+/**
+  * @brief 移動制御の現在位置と動作状態をMatterの属性に反映する
+  */
+void report_motion_state() {
+    static uint16_t last_position = UINT16_MAX;
+    static int8_t last_direction = INT8_MAX;
+
+    // 手で引かれて動き出したときは目標位置も合わせておく
+    uint16_t touch_target;
+    if (touch_monitor::take_triggered_target(&touch_target)) {
+        update_own_target(touch_target);
+    }
+
+    uint16_t position = motion::position_100ths();
+    if (position != last_position) {
+        last_position = position;
+        esp_matter_attr_val_t position_value = esp_matter_nullable_uint16(position);
+        em::attribute::update(curtain_endpoint_id, CLUSTER_ID_CURTAIN, ATTRIBUTE_ID_CURRENT_POSITION, &position_value);
+    }
+
+    int8_t direction = motion::direction();
+    if (direction != last_direction) {
+        last_direction = direction;
+        // OperationalStatus: bit0-1 全体，bit2-3 リフト（1: 開方向，2: 閉方向）
+        uint8_t moving = direction > 0 ? 2 : (direction < 0 ? 1 : 0);
+        esp_matter_attr_val_t status_value = esp_matter_bitmap8(moving | (moving << 2));
+        set_curtain_attribute_value(&status_value);
+    }
+}
+
+/**
+  * @brief バスのモーターの位置，動作状態，到達できるかをMatterの属性に反映する（ブリッジモード）
+  * 値はバスのタスクが公開したものを読むだけなので，バスの応答を待つことはない
+  */
+void report_bridged_state() {
+    static motor_bus::MotorState last_states[motor_bus::MAX_MOTORS];
+    static bool reported[motor_bus::MAX_MOTORS];
+
+    for (uint8_t i = 0; i < bridged_count; i++) {
+        motor_bus::MotorState state = motor_bus::state(i);
+        motor_bus::MotorState &last = last_states[i];
+        uint16_t endpoint_id = bridged_endpoint_ids[i];
+        if (!reported[i] || state.reachable != last.reachable) {
+            esp_matter_attr_val_t reachable = esp_matter_bool(state.reachable);
+            em::attribute::update(endpoint_id, CLUSTER_ID_BRIDGED_DEVICE_BASIC_INFORMATION, ATTRIBUTE_ID_REACHABLE, &reachable);
+        }
+        if (state.reachable && (!last.reachable || state.position_100ths != last.position_100ths)) {
+            esp_matter_attr_val_t position_value = esp_matter_nullable_uint16(state.position_100ths);
+            em::attribute::update(endpoint_id, CLUSTER_ID_CURTAIN, ATTRIBUTE_ID_CURRENT_POSITION, &position_value);
+        }
+        if (state.reachable && (!last.reachable || state.status != last.status)) {
+            // report_motion_state と同じ形（1: 開方向，2: 閉方向）
+            uint8_t moving = (state.status & motor_bus::STATUS_MOVING) == 0 ? 0
+                           : ((state.status & motor_bus::STATUS_CLOSING) != 0 ? 2 : 1);
+            esp_matter_attr_val_t status_value = esp_matter_bitmap8(moving | (moving << 2));
+            em::attribute::update(endpoint_id, CLUSTER_ID_CURTAIN, ATTRIBUTE_ID_CURTAIN, &status_value);
+        }
+        last = state;
+        reported[i] = true;
+    }
+}
+
+/**
+  * @brief 移動が完了していれば電力量をMatterの属性に反映する
+  */
+void report_energy() {
+    if (!energy_meter::take_pending_report()) {
+        return;
+    }
+    energy_meter::Totals totals = energy_meter::totals();
+    esp_matter_attr_val_t cumulative = esp_matter_nullable_int64(energy_meter::nj_to_mwh(totals.cumulative_nj));
+    esp_matter_attr_val_t periodic = esp_matter_nullable_int64(energy_meter::nj_to_mwh(totals.last_move_nj));
+    em::attribute::update(energy_endpoint_id, CLUSTER_ID_ENERGY, ATTRIBUTE_ID_CUMULATIVE_ENERGY_IMPORTED, &cumulative);
+    em::attribute::update(energy_endpoint_id, CLUSTER_ID_ENERGY, ATTRIBUTE_ID_PERIODIC_ENERGY_IMPORTED, &periodic);
+}
+
+/**
+  * @brief 次のスケジュールのイベントが変わったらMatterの属性に反映する
+  */
+void report_schedule() {
+    static uint16_t last_next_event = schedule::NO_EVENT;
+    uint16_t next_event = schedule::next_event_minute();
+    if (next_event == last_next_event) {
+        return;
+    }
+    last_next_event = next_event;
+    esp_matter_attr_val_t next_value = next_event == schedule::NO_EVENT
+        ? esp_matter_nullable_uint16(nullable<uint16_t>())
+        : esp_matter_nullable_uint16(next_event);
+    em::attribute::update(curtain_endpoint_id, CLUSTER_ID_SCHEDULE, ATTRIBUTE_ID_SCHEDULE_NEXT_EVENT, &next_value);
+}
+
+/**
+  * @brief 移動が終わったら予知保全の統計を更新し，Matterの属性に反映する
+  */
+void report_maintenance() {
+    if (!maintenance::poll()) {
+        return;
+    }
+    maintenance::Stats stats = maintenance::stats();
+    esp_matter_attr_val_t flags = esp_matter_bitmap8(stats.flags);
+    esp_matter_attr_val_t travel_time = esp_matter_uint32(static_cast<uint32_t>(stats.travel_time_ewma_q8 >> 8));
+    esp_matter_attr_val_t peak_current = esp_matter_uint32(static_cast<uint32_t>(stats.peak_current_ewma_q8 >> 8));
+    esp_matter_attr_val_t stall_rate = esp_matter_uint8(static_cast<uint8_t>(stats.stall_rate_q16 * 100 >> 16));
+    em::attribute::update(curtain_endpoint_id, CLUSTER_ID_MAINTENANCE, ATTRIBUTE_ID_MAINTENANCE_FLAGS, &flags);
+    em::attribute::update(curtain_endpoint_id, CLUSTER_ID_MAINTENANCE, ATTRIBUTE_ID_TRAVEL_TIME, &travel_time);
+    em::attribute::update(curtain_endpoint_id, CLUSTER_ID_MAINTENANCE, ATTRIBUTE_ID_PEAK_CURRENT, &peak_current);
+    em::attribute::update(curtain_endpoint_id, CLUSTER_ID_MAINTENANCE, ATTRIBUTE_ID_STALL_RATE, &stall_rate);
+}
+
+/**
+  * @brief 移動が終わったら位置と電力量の積算値をログストアに追記する
+  * 次の起動ではここから復元して原点出しを省く
+  */
+void persist_state() {
+    static bool was_moving = false;
+    bool moving = motion::state() == motion::State::MOVING || device_flows::is_homing();
+    if (was_moving && !moving) {
+        int32_t position = motion::position_counts();
+        energy_meter::Totals totals = energy_meter::totals();
+        log_store::write(log_store::KEY_POSITION, &position, sizeof(position));
+        log_store::write(log_store::KEY_ENERGY_TOTALS, &totals, sizeof(totals));
+    }
+    was_moving = moving;
+}
+
 /**
   * @brief メインループ。
   * トグルライトボタンが押されたとき（デバウンス処理付き），light on/off attribute 値を変更します。
@@ -216,10 +686,54 @@ void loop() {
             // onoff_value.val.b = !onoff_value.val.b;
             // set_onoff_attribute_value(&onoff_value);
             esp_matter_attr_val_t curtain_value = get_curtain_attribute_value();
-            Serial.print("Current state: ");
-            Serial.println(curtain_value.val.u8);
+            TLOG("Current state: %u", curtain_value.val.u8);
             // curtain_value.val.u8 = curtain_value.val.u8;
             // set_curtain_attribute_value(&curtain_value);
+
+            toggle_local();
+        }
+    }
+
+    // RF/IRリモコンのボタンも本体のボタンと同じ経路で指令にする
+    switch (remote_input::poll()) {
+    case remote_input::Button::OPEN:
+        submit_local_command({command_arbiter::Source::LOCAL, command_arbiter::Action::MOVE_TO, 0});
+        break;
+    case remote_input::Button::CLOSE:
+        submit_local_command({command_arbiter::Source::LOCAL, command_arbiter::Action::MOVE_TO, motion::POSITION_100THS_MAX});
+        break;
+    case remote_input::Button::STOP:
+        submit_local_command({command_arbiter::Source::LOCAL, command_arbiter::Action::STOP, 0});
+        break;
+    case remote_input::Button::TOGGLE:
+        toggle_local();
+        break;
+    default:
+        break;
+    }
+
+    // 停止中に手で引かれていないか調べる
+    touch_monitor::poll();
+
+    // 移動パラメータの調整などのコマンドを受け付ける
+    console::poll();
+    // 原点出しやLEDなどのフローを進める
+    sequencer::poll();
+
+    if ((millis() - last_report) > REPORT_INTERVAL) {
+        last_report = millis();
+        check_obstruction();
+        report_motion_state();
+        report_bridged_state();
+        report_energy();
+        report_schedule();
+        report_maintenance();
+        persist_state();
+        usage_history::poll();
+        // サブスクリプションが戻ったら（または待つ時間が過ぎたら），起動時に止めておいたDHCPを動かし直す
+        subscription_monitor::Stats subscriptions = subscription_monitor::stats();
+        if (subscriptions.all_restored_ms != 0 || subscriptions.window_closed) {
+            wifi_fast_connect::resume_dhcp();
         }
     }
 }
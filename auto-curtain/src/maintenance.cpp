@@ -0,0 +1,158 @@
+/**
+ * @file maintenance.cpp
+ * @brief 移動ごとの統計から，レールやモーターの劣化の兆候を見つける（予知保全）
+ */
+#include "maintenance.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "board_config.h"
+#include "fixed_point.h"
+#include "motion.h"
+#include "tlog.h"
+
+namespace maintenance {
+
+const char *PREFERENCES_NAMESPACE = "maint";
+const char *KEY_STATS = "stats";
+
+// 移動時間の統計に入れる最小の移動距離（短い移動は加減速の割合が大きいので使わない）
+const uint32_t MIN_DISTANCE_COUNTS = CURTAIN_TRAVEL_COUNTS / 5;
+// EWMA の重み（1/2^n）
+const int EWMA_SHIFT = 3;
+const int STALL_EWMA_SHIFT = 4;
+// 傾向と比べるしきい値: 平均 + max(SIGMA_LIMIT σ, 平均 * RELATIVE_LIMIT_PERCENT %)
+const uint32_t SIGMA_LIMIT = 3;
+const uint32_t RELATIVE_LIMIT_PERCENT = 15;
+// ストールの率のしきい値 [Q16]（10%）
+const uint32_t STALL_RATE_LIMIT_Q16 = 65536 / 10;
+// NVSに書き出す間隔 [移動]
+const uint32_t SAVE_INTERVAL_MOVES = 10;
+
+static Stats current = {};
+static uint32_t last_move_count = 0;
+static bool first_poll = true;
+
+/**
+ * @brief Welford法で1サンプルを足し込む
+ */
+static void welford_add(Welford &welford, int64_t value_q8) {
+    welford.count++;
+    int64_t delta = value_q8 - welford.mean_q8;
+    welford.mean_q8 += delta / static_cast<int64_t>(welford.count);
+    int64_t delta_after = value_q8 - welford.mean_q8;
+    int64_t product = delta * delta_after;
+    if (product > 0) {
+        welford.m2_q8 += static_cast<uint64_t>(product >> 8);
+    }
+}
+
+static void ewma_add(int64_t &ewma_q8, int64_t value_q8, bool first) {
+    ewma_q8 = first ? value_q8 : ewma_q8 + ((value_q8 - ewma_q8) >> EWMA_SHIFT);
+}
+
+uint32_t stddev(const Welford &welford) {
+    if (welford.count < 2) {
+        return 0;
+    }
+    // 分散 [Q8] の平方根は Q4 なので，整数に直す
+    uint64_t variance_q8 = welford.m2_q8 / (welford.count - 1);
+    return fixed_point::isqrt(variance_q8) >> 4;
+}
+
+/**
+ * @brief 傾向が基準から外れたかどうか
+ */
+static bool is_rising(const Welford &baseline, int64_t ewma_q8) {
+    if (baseline.count < BASELINE_MOVES) {
+        return false;
+    }
+    int64_t sigma_q8 = static_cast<int64_t>(stddev(baseline)) << 8;
+    int64_t margin_q8 = max(sigma_q8 * SIGMA_LIMIT, baseline.mean_q8 * RELATIVE_LIMIT_PERCENT / 100);
+    return ewma_q8 > baseline.mean_q8 + margin_q8;
+}
+
+static void save() {
+    Preferences preferences;
+    preferences.begin(PREFERENCES_NAMESPACE, false);
+    preferences.putBytes(KEY_STATS, &current, sizeof(current));
+    preferences.end();
+}
+
+/**
+ * @brief 1回分の移動を統計に入れる
+ */
+static void add_move(const motion::Snapshot &snapshot) {
+    // state はもう次の移動に移っているかもしれないので，移動の終わりに残した結果を使う
+    bool stalled = snapshot.last_move_stalled;
+    bool first = current.move_count == 0;
+    current.move_count++;
+
+    uint32_t stall_sample = stalled ? 65536 : 0;
+    current.stall_rate_q16 = first ? stall_sample
+        : current.stall_rate_q16 + ((static_cast<int32_t>(stall_sample) - static_cast<int32_t>(current.stall_rate_q16)) >> STALL_EWMA_SHIFT);
+
+    // ストールした移動は途中で止まっているので，時間と電流の統計には入れない
+    if (!stalled && snapshot.last_move_counts >= MIN_DISTANCE_COUNTS) {
+        uint32_t move_ms = snapshot.last_move_ticks * (motion::CONTROL_PERIOD_US / 1000);
+        int64_t travel_ms_q8 = (static_cast<int64_t>(move_ms) * CURTAIN_TRAVEL_COUNTS << 8) / snapshot.last_move_counts;
+        int64_t peak_ma_q8 = static_cast<int64_t>(snapshot.last_move_peak_ma) << 8;
+        bool first_sample = current.travel_time.count == 0;
+        if (current.travel_time.count < BASELINE_MOVES) {
+            welford_add(current.travel_time, travel_ms_q8);
+            welford_add(current.peak_current, peak_ma_q8);
+        }
+        ewma_add(current.travel_time_ewma_q8, travel_ms_q8, first_sample);
+        ewma_add(current.peak_current_ewma_q8, peak_ma_q8, first_sample);
+    }
+
+    uint8_t flags = 0;
+    if (is_rising(current.travel_time, current.travel_time_ewma_q8)) flags |= FLAG_TRAVEL_TIME_RISING;
+    if (is_rising(current.peak_current, current.peak_current_ewma_q8)) flags |= FLAG_PEAK_CURRENT_RISING;
+    if (current.move_count >= BASELINE_MOVES / 10 && current.stall_rate_q16 > STALL_RATE_LIMIT_Q16) flags |= FLAG_FREQUENT_STALLS;
+    bool flags_changed = flags != current.flags;
+    if (flags_changed) {
+        TLOG("Maintenance flags: %u", flags);
+    }
+    current.flags = flags;
+
+    // フラグが立ったままでも書くのは間隔ごとと変わったときだけにする（NVSの摩耗を抑える）
+    if (current.move_count % SAVE_INTERVAL_MOVES == 0 || flags_changed) {
+        save();
+    }
+}
+
+void begin() {
+    Preferences preferences;
+    preferences.begin(PREFERENCES_NAMESPACE, true);
+    if (preferences.getBytesLength(KEY_STATS) == sizeof(Stats)) {
+        preferences.getBytes(KEY_STATS, &current, sizeof(current));
+    }
+    preferences.end();
+}
+
+bool poll() {
+    motion::Snapshot snapshot = motion::snapshot();
+    if (first_poll) {
+        first_poll = false;
+        last_move_count = snapshot.move_count;
+        return true;
+    }
+    if (snapshot.move_count == last_move_count) {
+        return false;
+    }
+    last_move_count = snapshot.move_count;
+    add_move(snapshot);
+    return true;
+}
+
+Stats stats() {
+    return current;
+}
+
+void reset() {
+    current = {};
+    save();
+}
+
+} // namespace maintenance
@@ -0,0 +1,121 @@
+/**
+ * @file modbus_rtu.cpp
+ * @brief Modbus RTU のフレームの組み立てと解析（マスター側）
+ */
+#include "modbus_rtu.h"
+
+namespace modbus_rtu {
+
+const uint8_t BITS_PER_CHARACTER = 11;
+
+uint16_t crc16(const uint8_t *data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? static_cast<uint16_t>((crc >> 1) ^ 0xA001) : static_cast<uint16_t>(crc >> 1);
+        }
+    }
+    return crc;
+}
+
+static void put_u16(uint8_t *data, uint16_t value) {
+    data[0] = static_cast<uint8_t>(value >> 8);
+    data[1] = static_cast<uint8_t>(value);
+}
+
+static uint16_t get_u16(const uint8_t *data) {
+    return static_cast<uint16_t>((data[0] << 8) | data[1]);
+}
+
+/**
+ * @brief CRCを付ける（下位バイトから）
+ * @return CRCを含めた長さ
+ */
+static size_t finish(uint8_t *frame, size_t length) {
+    uint16_t crc = crc16(frame, length);
+    frame[length] = static_cast<uint8_t>(crc);
+    frame[length + 1] = static_cast<uint8_t>(crc >> 8);
+    return length + 2;
+}
+
+size_t read_registers(uint8_t *frame, uint8_t address, uint16_t first, uint8_t count) {
+    frame[0] = address;
+    frame[1] = READ_HOLDING_REGISTERS;
+    put_u16(frame + 2, first);
+    put_u16(frame + 4, count);
+    return finish(frame, 6);
+}
+
+size_t write_register(uint8_t *frame, uint8_t address, uint16_t reg, uint16_t value) {
+    frame[0] = address;
+    frame[1] = WRITE_SINGLE_REGISTER;
+    put_u16(frame + 2, reg);
+    put_u16(frame + 4, value);
+    return finish(frame, 6);
+}
+
+size_t write_registers(uint8_t *frame, uint8_t address, uint16_t first, const uint16_t *values, uint8_t count) {
+    frame[0] = address;
+    frame[1] = WRITE_MULTIPLE_REGISTERS;
+    put_u16(frame + 2, first);
+    put_u16(frame + 4, count);
+    frame[6] = static_cast<uint8_t>(2 * count);
+    for (uint8_t i = 0; i < count; i++) {
+        put_u16(frame + 7 + 2 * i, values[i]);
+    }
+    return finish(frame, 7 + 2 * count);
+}
+
+size_t expected_response_size(const uint8_t *request) {
+    switch (request[1]) {
+    case READ_HOLDING_REGISTERS:
+        // アドレス，機能コード，バイト数，データ，CRC
+        return 5 + 2 * get_u16(request + 4);
+    case WRITE_SINGLE_REGISTER:
+    case WRITE_MULTIPLE_REGISTERS:
+        // 要求の先頭6バイトを返す
+        return 8;
+    default:
+        return MAX_FRAME_SIZE;
+    }
+}
+
+Status parse_response(const uint8_t *request, const uint8_t *response, size_t length, uint16_t *values) {
+    if (length < 5) {
+        return Status::BAD_FRAME;
+    }
+    uint16_t crc = static_cast<uint16_t>(response[length - 2] | (response[length - 1] << 8));
+    if (crc16(response, length - 2) != crc) {
+        return Status::BAD_CRC;
+    }
+    if (response[0] != request[0]) {
+        return Status::BAD_FRAME;
+    }
+    if (response[1] == (request[1] | EXCEPTION_FLAG)) {
+        return Status::EXCEPTION;
+    }
+    if (response[1] != request[1] || length != expected_response_size(request)) {
+        return Status::BAD_FRAME;
+    }
+    if (request[1] == READ_HOLDING_REGISTERS) {
+        uint16_t count = get_u16(request + 4);
+        if (response[2] != 2 * count) {
+            return Status::BAD_FRAME;
+        }
+        for (uint16_t i = 0; i < count; i++) {
+            values[i] = get_u16(response + 3 + 2 * i);
+        }
+    }
+    return Status::OK;
+}
+
+uint32_t frame_time_us(size_t characters, uint32_t baud) {
+    return static_cast<uint32_t>(static_cast<uint64_t>(characters) * BITS_PER_CHARACTER * 1000000 / baud);
+}
+
+uint32_t inter_frame_gap_us(uint32_t baud) {
+    return baud > 19200 ? 1750 : frame_time_us(7, baud) / 2;
+}
+
+} // namespace modbus_rtu
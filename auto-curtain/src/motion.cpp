@@ -0,0 +1,412 @@
+/**
+ * @file motion.cpp
+ * @brief カーテンの移動制御（台形速度プロファイル + 位置フィードバック）
+ */
+#include "motion.h"
+
+#include <Arduino.h>
+#include <atomic>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "board_config.h"
+#include "diag_transport.h"
+#include "energy_meter.h"
+#include "motor.h"
+#include "seqlock.h"
+#include "task_layout.h"
+
+namespace motion {
+
+// 目標位置に到達したとみなす偏差 [count]
+const int32_t POSITION_TOLERANCE = 8;
+// 整定をあきらめるまでの周期数
+const uint32_t SETTLE_TIMEOUT_TICKS = 2000;
+// 電流制限を超え続けたらストールとみなす周期数
+const uint32_t STALL_TICKS = 50;
+
+// 移動指令がないことと停止指令を表す特別な値
+const int32_t COMMAND_NONE = -1;
+const int32_t COMMAND_STOP = -2;
+
+static volatile int32_t encoder_count = 0;
+static std::atomic<int32_t> pending_command(COMMAND_NONE);
+
+// 移動パラメータの2面バッファ．
+// 制御周期は active_index の面だけを読み，書き込み側はもう一方の面だけに書く．
+// 書き終えたら pending_index で渡し，制御周期が区間の境目で面を切り替える．
+static Params param_buffers[2];
+static std::atomic<int8_t> pending_index(-1);
+static SemaphoreHandle_t param_writer_mutex = nullptr;
+static uint8_t writer_last_index = 0; // 書き込み側が最後に渡した面（param_writer_mutex で保護）
+
+// ここから下は制御周期（esp_timerタスク）からしか書き込まない
+static State current_state = State::IDLE;
+static int8_t current_direction = 0;
+static uint8_t active_index = 0;
+static Plan plan;
+static uint32_t move_ticks = 0;
+static uint32_t last_move_ticks = 0;
+static int32_t move_start_position = 0;
+static uint32_t move_peak_ma = 0;
+static uint32_t last_move_counts = 0;
+static uint32_t last_move_peak_ma = 0;
+static bool last_move_stalled = false;
+static uint32_t move_count = 0;
+static int64_t last_tick_us = 0;
+
+// 周期のゆらぎと指令から反映までの時間の計測
+static std::atomic<uint32_t> command_time_us(0);
+static std::atomic<uint32_t> max_jitter_us(0);
+static std::atomic<uint32_t> last_command_latency_us(0);
+static std::atomic<uint32_t> max_command_latency_us(0);
+
+// 他のタスクへ公開する状態．制御周期の終わりにまとめて書き込む
+static Seqlock<Snapshot> published;
+static uint32_t settle_ticks = 0;
+static uint32_t over_current_ticks = 0;
+static esp_timer_handle_t control_timer = nullptr;
+// 制御周期の処理はタイマーから起こされる専用タスクで行う（配置は task_layout.h）
+static TaskHandle_t motion_task = nullptr;
+// 停止中は制御周期タイマーを止めてライトスリープを妨げないようにする
+static std::atomic<bool> control_timer_running(false);
+
+/**
+ * @brief エンコーダA相の立ち上がり割り込み．B相で回転方向を判定する
+ */
+static void IRAM_ATTR on_encoder_edge() {
+    if (digitalRead(ENCODER_B_PIN)) {
+        encoder_count = encoder_count + 1;
+    } else {
+        encoder_count = encoder_count - 1;
+    }
+}
+
+uint16_t counts_to_100ths(int32_t counts) {
+    if (counts <= 0) return 0;
+    if (counts >= CURTAIN_TRAVEL_COUNTS) return POSITION_100THS_MAX;
+    return static_cast<uint16_t>(static_cast<int64_t>(counts) * POSITION_100THS_MAX / CURTAIN_TRAVEL_COUNTS);
+}
+
+int32_t percent100ths_to_counts(uint16_t position_100ths) {
+    if (position_100ths > POSITION_100THS_MAX) position_100ths = POSITION_100THS_MAX;
+    return static_cast<int32_t>(static_cast<int64_t>(position_100ths) * CURTAIN_TRAVEL_COUNTS / POSITION_100THS_MAX);
+}
+
+/**
+ * @brief 現在の状態をスナップショットとして公開する
+ */
+static void publish() {
+    Snapshot snapshot;
+    snapshot.position_counts = encoder_count;
+    snapshot.velocity_q16 = plan.velocity_q16 * current_direction;
+    snapshot.target_counts = plan.target;
+    snapshot.last_move_ticks = last_move_ticks;
+    snapshot.last_move_counts = last_move_counts;
+    snapshot.last_move_peak_ma = last_move_peak_ma;
+    snapshot.last_move_stalled = last_move_stalled;
+    snapshot.move_count = move_count;
+    snapshot.state = current_state;
+    snapshot.direction = current_direction;
+    published.write(snapshot);
+}
+
+/**
+ * @brief 止まっていれば制御周期タイマーを動かす
+ */
+static void ensure_control_timer() {
+    if (!control_timer_running.exchange(true)) {
+        esp_timer_start_periodic(control_timer, CONTROL_PERIOD_US);
+    }
+}
+
+/**
+ * @brief 移動を終了してモーターを止める
+ */
+static void finish_move(State next_state) {
+    motor::drive(0);
+    if (current_state == State::MOVING) {
+        energy_meter::end_move();
+        last_move_ticks = move_ticks;
+        last_move_counts = abs(encoder_count - move_start_position);
+        last_move_peak_ma = move_peak_ma;
+        last_move_stalled = next_state == State::STALLED;
+        move_count++;
+    }
+    current_direction = 0;
+    current_state = next_state;
+    plan.velocity_q16 = 0;
+    publish();
+
+    esp_timer_stop(control_timer);
+    control_timer_running.store(false);
+    last_tick_us = 0;
+    // 止める直前に届いた指令を取りこぼさない
+    if (pending_command.load() != COMMAND_NONE) {
+        ensure_control_timer();
+    }
+}
+
+/**
+ * @brief 新しい移動パラメータが渡されていれば面を切り替える．区間の境目でだけ呼ぶ
+ * @return 切り替えたらtrue
+ */
+static bool swap_params() {
+    int8_t index = pending_index.exchange(-1);
+    if (index < 0) {
+        return false;
+    }
+    active_index = static_cast<uint8_t>(index);
+    return true;
+}
+
+/**
+ * @brief 指令位置を1周期分進める
+ */
+static void advance_plan() {
+    while (plan.index < Plan::SEGMENT_COUNT && plan.remaining == 0) {
+        plan.index++;
+        if (plan.index < Plan::SEGMENT_COUNT) {
+            plan.remaining = plan.segments[plan.index].ticks;
+        }
+        if (swap_params() && plan.index < Plan::SEGMENT_COUNT) {
+            // 速度や加速度が変わったので，今の指令位置と速度から残りを計画し直す
+            int32_t setpoint = static_cast<int32_t>(plan.setpoint_q16 >> 16);
+            plan = plan_move(setpoint, plan.target, param_buffers[active_index], plan.velocity_q16);
+        }
+    }
+    if (plan.index >= Plan::SEGMENT_COUNT) {
+        plan.velocity_q16 = 0;
+        plan.setpoint_q16 = static_cast<int64_t>(plan.target) << 16;
+        return;
+    }
+    plan.velocity_q16 += plan.segments[plan.index].accel_q16;
+    if (plan.velocity_q16 < 0) plan.velocity_q16 = 0;
+    plan.setpoint_q16 += static_cast<int64_t>(plan.velocity_q16) * plan.direction;
+    plan.remaining--;
+}
+
+/**
+ * @brief 値が最大値を超えていれば更新する
+ */
+static void update_max(std::atomic<uint32_t> &maximum, uint32_t value) {
+    if (value > maximum.load()) {
+        maximum.store(value);
+    }
+}
+
+/**
+ * @brief 周期のゆらぎを計測する
+ */
+static void measure_jitter(int64_t now) {
+    if (last_tick_us != 0) {
+        int64_t jitter = (now - last_tick_us) - CONTROL_PERIOD_US;
+        if (jitter < 0) jitter = -jitter;
+        update_max(max_jitter_us, static_cast<uint32_t>(jitter));
+    }
+    last_tick_us = now;
+}
+
+/**
+ * @brief 指令を受けてから制御周期に反映されるまでの時間を計測する
+ */
+static void measure_command_latency(int64_t now) {
+    uint32_t latency = static_cast<uint32_t>(now) - command_time_us.load();
+    last_command_latency_us.store(latency);
+    update_max(max_command_latency_us, latency);
+}
+
+/**
+ * @brief 制御周期の処理
+ */
+static void control_tick() {
+    int64_t now = esp_timer_get_time();
+    measure_jitter(now);
+    int32_t position = encoder_count;
+
+    int32_t command = pending_command.exchange(COMMAND_NONE);
+    if (command != COMMAND_NONE) {
+        measure_command_latency(now);
+    }
+    if (command == COMMAND_STOP) {
+        finish_move(State::IDLE);
+    } else if (command >= 0 && !(current_state == State::MOVING && command == plan.target)) {
+        // 移動中と同じ目標の指令は計画し直さない（速度が0に戻ってしまうため）
+        bool moving = current_state == State::MOVING;
+        if (!moving) {
+            energy_meter::begin_move();
+            move_ticks = 0;
+            move_start_position = position;
+            move_peak_ma = 0;
+        }
+        // 移動の開始も区間の境目として扱う
+        swap_params();
+        // 同じ向きへの目標変更なら今の速度を引き継ぐ
+        int8_t new_direction = (command >= position) ? 1 : -1;
+        int32_t initial_velocity = (moving && new_direction == plan.direction) ? plan.velocity_q16 : 0;
+        plan = plan_move(position, command, param_buffers[active_index], initial_velocity);
+        settle_ticks = 0;
+        over_current_ticks = 0;
+        current_direction = plan.direction;
+        current_state = State::MOVING;
+    }
+
+    if (current_state != State::MOVING) {
+        return;
+    }
+
+    move_ticks++;
+    advance_plan();
+    const Params &params = param_buffers[active_index];
+
+    int32_t setpoint = static_cast<int32_t>(plan.setpoint_q16 >> 16);
+    int32_t error = setpoint - position;
+    int32_t feedforward = static_cast<int32_t>((static_cast<int64_t>(plan.velocity_q16) * params.kff) >> 16);
+    int32_t duty = feedforward * plan.direction + error * params.kp;
+    if (duty > params.max_duty) duty = params.max_duty;
+    if (duty < -params.max_duty) duty = -params.max_duty;
+    motor::drive(static_cast<int16_t>(duty));
+
+    uint32_t voltage_mv = motor::read_voltage_mv();
+    uint32_t current_ma = motor::read_current_ma();
+    energy_meter::sample(voltage_mv, current_ma, CONTROL_PERIOD_US);
+    if (current_ma > move_peak_ma) {
+        move_peak_ma = current_ma;
+    }
+    if (diag_transport::trace_enabled()) {
+        diag_transport::trace_motion({move_ticks, position, setpoint, static_cast<int16_t>(duty),
+                                      static_cast<uint16_t>(min(current_ma, static_cast<uint32_t>(UINT16_MAX)))});
+    }
+
+    if (current_ma > params.current_limit_ma) {
+        if (++over_current_ticks >= STALL_TICKS) {
+            finish_move(State::STALLED);
+            return;
+        }
+    } else {
+        over_current_ticks = 0;
+    }
+
+    if (plan.index >= Plan::SEGMENT_COUNT) {
+        int32_t remaining = plan.target - position;
+        if (remaining < 0) remaining = -remaining;
+        if (remaining <= POSITION_TOLERANCE || ++settle_ticks >= SETTLE_TIMEOUT_TICKS) {
+            finish_move(State::IDLE);
+            return;
+        }
+    }
+
+    publish();
+}
+
+Params params() {
+    xSemaphoreTake(param_writer_mutex, portMAX_DELAY);
+    Params latest = param_buffers[writer_last_index];
+    xSemaphoreGive(param_writer_mutex);
+    return latest;
+}
+
+void set_params(const Params &new_params) {
+    xSemaphoreTake(param_writer_mutex, portMAX_DELAY);
+    // まだ制御周期に取り込まれていなければ取り消して同じ面に書き直す．
+    // 取り込まれていれば，最後に渡した面が使用中なのでもう一方に書く
+    int8_t retracted = pending_index.exchange(-1);
+    uint8_t back = retracted >= 0 ? static_cast<uint8_t>(retracted) : static_cast<uint8_t>(1 - writer_last_index);
+    param_buffers[back] = new_params;
+    writer_last_index = back;
+    pending_index.store(static_cast<int8_t>(back));
+    xSemaphoreGive(param_writer_mutex);
+}
+
+uint32_t last_move_ms() {
+    return static_cast<uint32_t>(static_cast<uint64_t>(published.read().last_move_ticks) * CONTROL_PERIOD_US / 1000);
+}
+
+/**
+ * @brief 制御周期タイマー．専用タスクを起こすだけ
+ */
+static void on_control_timer(void *arg) {
+    xTaskNotifyGive(motion_task);
+}
+
+/**
+ * @brief 移動制御タスク
+ */
+static void motion_task_main(void *arg) {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        control_tick();
+    }
+}
+
+void begin() {
+    param_buffers[0] = default_params();
+    param_buffers[1] = param_buffers[0];
+    param_writer_mutex = xSemaphoreCreateMutex();
+    publish();
+    motor::begin();
+
+    pinMode(ENCODER_A_PIN, INPUT_PULLUP);
+    pinMode(ENCODER_B_PIN, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(ENCODER_A_PIN), on_encoder_edge, RISING);
+
+    task_layout::create_task(task_layout::MOTION, motion_task_main, &motion_task);
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = on_control_timer;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "motion";
+    esp_timer_create(&timer_args, &control_timer);
+}
+
+void move_to(uint16_t position_100ths) {
+    command_time_us.store(static_cast<uint32_t>(esp_timer_get_time()));
+    pending_command.store(percent100ths_to_counts(position_100ths));
+    ensure_control_timer();
+}
+
+void stop() {
+    command_time_us.store(static_cast<uint32_t>(esp_timer_get_time()));
+    pending_command.store(COMMAND_STOP);
+    ensure_control_timer();
+}
+
+TimingStats timing_stats() {
+    TimingStats stats;
+    stats.max_jitter_us = max_jitter_us.load();
+    stats.last_command_latency_us = last_command_latency_us.load();
+    stats.max_command_latency_us = max_command_latency_us.load();
+    return stats;
+}
+
+void reset_timing_stats() {
+    max_jitter_us.store(0);
+    max_command_latency_us.store(0);
+}
+
+int32_t position_counts() {
+    return encoder_count;
+}
+
+void set_position_counts(int32_t counts) {
+    encoder_count = counts;
+}
+
+uint16_t position_100ths() {
+    return counts_to_100ths(encoder_count);
+}
+
+Snapshot snapshot() {
+    return published.read();
+}
+
+int8_t direction() {
+    return published.read().direction;
+}
+
+State state() {
+    return published.read().state;
+}
+
+} // namespace motion
@@ -0,0 +1,76 @@
+/**
+ * @file motion_plan.cpp
+ * @brief 台形速度プロファイルの計画（motion.h）
+ *
+ * @details
+ * Arduinoにも制御タスクにも依存しない計算だけをここに置く．
+ * ホストのベンチマーク（tools/bench_host.sh）もこのファイルをそのままビルドする．
+ */
+#include "motion.h"
+
+#include "fixed_point.h"
+
+namespace motion {
+
+Params default_params() {
+    Params p;
+    p.max_speed_cps = 3000;
+    p.accel_cps2 = 6000;
+    p.max_duty = 900;
+    p.current_limit_ma = 1500;
+    p.kp = 4;
+    p.kff = 300;
+    return p;
+}
+
+Plan plan_move(int32_t from, int32_t to, const Params &p, int32_t initial_velocity_q16) {
+    Plan result = {};
+    result.direction = (to >= from) ? 1 : -1;
+    result.target = to;
+    result.setpoint_q16 = static_cast<int64_t>(from) << 16;
+    result.velocity_q16 = initial_velocity_q16 > 0 ? initial_velocity_q16 : 0;
+
+    uint64_t distance_q16 = static_cast<uint64_t>(to >= from ? to - from : from - to) << 16;
+    uint64_t period = CONTROL_PERIOD_US;
+    uint64_t v_max = (static_cast<uint64_t>(p.max_speed_cps) << 16) * period / 1000000ULL;
+    uint64_t a = (static_cast<uint64_t>(p.accel_cps2) << 16) * period * period / 1000000000000ULL;
+    if (a < 1) a = 1;
+    if (v_max < a) v_max = a;
+    uint64_t v0 = static_cast<uint64_t>(result.velocity_q16);
+    int32_t a_q16 = static_cast<int32_t>(a);
+
+    // 速度を v から w まで加速度 a で変える間に進む距離は |w^2 - v^2| / 2a
+    auto ramp = [a](uint64_t v, uint64_t w) { return (v > w ? v * v - w * w : w * w - v * v) / (2 * a); };
+    uint64_t d_first = ramp(v0, v_max);
+    uint64_t d_last = ramp(v_max, 0);
+
+    Segment first;
+    Segment last;
+    uint32_t n_cruise = 0;
+    if (d_first + d_last <= distance_q16) {
+        // 台形プロファイル
+        first = {static_cast<uint32_t>((v0 > v_max ? v0 - v_max : v_max - v0) / a), v0 > v_max ? -a_q16 : a_q16};
+        n_cruise = static_cast<uint32_t>((distance_q16 - d_first - d_last) / v_max);
+        last = {static_cast<uint32_t>(v_max / a), -a_q16};
+    } else {
+        // 最高速度に届かない（三角形プロファイル）．頂点の速度は v^2 = (2ad + v0^2) / 2
+        uint64_t v_peak = fixed_point::isqrt((2 * a * distance_q16 + v0 * v0) / 2);
+        if (v_peak <= v0) {
+            // すでに速すぎるのですぐに減速する
+            first = {0, a_q16};
+            last = {static_cast<uint32_t>(v0 / a), -a_q16};
+        } else {
+            first = {static_cast<uint32_t>((v_peak - v0) / a), a_q16};
+            last = {static_cast<uint32_t>(v_peak / a), -a_q16};
+        }
+    }
+
+    result.segments[0] = first;
+    result.segments[1] = {n_cruise, 0};
+    result.segments[2] = last;
+    result.index = 0;
+    result.remaining = result.segments[0].ticks;
+    return result;
+}
+
+} // namespace motion
@@ -0,0 +1,57 @@
+/**
+ * @file motor.cpp
+ * @brief Hブリッジ経由のDCモーター駆動と電圧・電流の計測
+ */
+#include "motor.h"
+
+#include <Arduino.h>
+#include "board_config.h"
+
+namespace motor {
+
+// LEDCのチャネルと周波数（20kHzで可聴域の外に出す）
+const uint8_t PWM_CHANNEL_IN1 = 0;
+const uint8_t PWM_CHANNEL_IN2 = 1;
+const uint32_t PWM_FREQUENCY = 20000;
+const uint8_t PWM_RESOLUTION_BITS = 10;
+
+void begin() {
+    ledcSetup(PWM_CHANNEL_IN1, PWM_FREQUENCY, PWM_RESOLUTION_BITS);
+    ledcSetup(PWM_CHANNEL_IN2, PWM_FREQUENCY, PWM_RESOLUTION_BITS);
+    ledcAttachPin(MOTOR_IN1_PIN, PWM_CHANNEL_IN1);
+    ledcAttachPin(MOTOR_IN2_PIN, PWM_CHANNEL_IN2);
+    drive(0);
+
+    analogReadResolution(12);
+    pinMode(MOTOR_VOLTAGE_SENSE_PIN, INPUT);
+    pinMode(MOTOR_CURRENT_SENSE_PIN, INPUT);
+}
+
+void drive(int16_t duty) {
+    if (duty > DUTY_MAX) duty = DUTY_MAX;
+    if (duty < -DUTY_MAX) duty = -DUTY_MAX;
+
+    if (duty > 0) {
+        ledcWrite(PWM_CHANNEL_IN1, duty);
+        ledcWrite(PWM_CHANNEL_IN2, 0);
+    } else if (duty < 0) {
+        ledcWrite(PWM_CHANNEL_IN1, 0);
+        ledcWrite(PWM_CHANNEL_IN2, -duty);
+    } else {
+        // 両方Highでショートブレーキ
+        ledcWrite(PWM_CHANNEL_IN1, DUTY_MAX);
+        ledcWrite(PWM_CHANNEL_IN2, DUTY_MAX);
+    }
+}
+
+uint32_t read_voltage_mv() {
+    uint32_t adc_mv = analogReadMilliVolts(MOTOR_VOLTAGE_SENSE_PIN);
+    return adc_mv * VOLTAGE_SENSE_DIVIDER_NUM / VOLTAGE_SENSE_DIVIDER_DEN;
+}
+
+uint32_t read_current_ma() {
+    uint32_t adc_mv = analogReadMilliVolts(MOTOR_CURRENT_SENSE_PIN);
+    return adc_mv * 1000 / CURRENT_SENSE_MV_PER_A;
+}
+
+} // namespace motor
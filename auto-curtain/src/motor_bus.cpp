@@ -0,0 +1,277 @@
+/**
+ * @file motor_bus.cpp
+ * @brief RS-485（Modbus RTU）のバスにつないだモーターコントローラーを順に読み書きするマスター
+ */
+#include "motor_bus.h"
+
+#include <atomic>
+#include "modbus_rtu.h"
+#include "seqlock.h"
+
+namespace motor_bus {
+
+// 1回に読むレジスタ（REG_POSITION と REG_STATUS）
+const uint8_t POLL_REGISTERS = 2;
+// ブロードキャストのあと，スレーブが処理し終えるまで待つ時間 [us]（応答がないので固定）
+const uint32_t BROADCAST_TURNAROUND_US = 2000;
+
+// 指令のメールボックス: 最上位ビットが「未送信」，その次が「停止」，下位16ビットが目標位置
+const uint32_t PENDING = 1UL << 31;
+const uint32_t PENDING_STOP = 1UL << 30;
+const uint32_t TARGET_MASK = 0xFFFF;
+
+static Config bus_config = {};
+static Transport bus = {};
+static uint32_t gap_us = 0;
+
+static Seqlock<MotorState> motor_states[MAX_MOTORS];
+static std::atomic<uint32_t> pending[MAX_MOTORS];
+static std::atomic<uint32_t> requested_us[MAX_MOTORS];
+static uint8_t failures[MAX_MOTORS];
+static uint32_t updated_us[MAX_MOTORS];
+
+static Seqlock<Stats> published_stats;
+static Stats counters = {};
+
+// 次に読むモーター
+static uint8_t poll_cursor = 0;
+// 次の要求を送ってよい時刻（前のフレームの終わり + t3.5）
+static uint32_t bus_free_us = 0;
+// 今の周回の始まりと，回線を使った時間の合計
+static uint32_t cycle_start_us = 0;
+static uint32_t busy_us = 0;
+
+/**
+ * @brief 要求を送り，応答を受け取る（ブロードキャストなら受け取らない）
+ * @return 応答の長さ
+ */
+static size_t transact(const uint8_t *request, size_t request_length, uint8_t *response) {
+    bus.wait_until_us(bus_free_us);
+    bus.send(request, request_length);
+    busy_us += modbus_rtu::frame_time_us(request_length, bus_config.baud);
+    counters.transactions++;
+    if (request[0] == modbus_rtu::BROADCAST_ADDRESS) {
+        bus_free_us = bus.now_us() + BROADCAST_TURNAROUND_US;
+        return 0;
+    }
+
+    size_t expected = modbus_rtu::expected_response_size(request);
+    size_t length = bus.receive(response, modbus_rtu::MAX_FRAME_SIZE, expected, bus_config.response_timeout_us);
+    // 次の要求はここから t3.5 後まで送れない．その間に解析と次の要求の組み立てを済ませる
+    bus_free_us = bus.now_us() + gap_us;
+    busy_us += modbus_rtu::frame_time_us(length, bus_config.baud);
+    if (length == 0) {
+        counters.timeouts++;
+    }
+    return length;
+}
+
+static void note_command_latency(uint8_t index, uint32_t now) {
+    uint32_t latency = now - requested_us[index].load(std::memory_order_relaxed);
+    counters.last_command_latency_us = latency;
+    if (latency > counters.max_command_latency_us) {
+        counters.max_command_latency_us = latency;
+    }
+}
+
+/**
+ * @brief 送った指令をメールボックスから消す（送っている間に新しい指令が来ていれば残す）
+ */
+static void clear_pending(uint8_t index, uint32_t sent) {
+    pending[index].compare_exchange_strong(sent, 0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 応答がなかった，または壊れていた
+ */
+static void note_failure(uint8_t index) {
+    if (failures[index] < OFFLINE_FAILURES) {
+        failures[index]++;
+        if (failures[index] == OFFLINE_FAILURES) {
+            MotorState state = motor_states[index].read();
+            state.reachable = false;
+            motor_states[index].write(state);
+        }
+    }
+}
+
+/**
+ * @brief 全モーターに同じ目標が来ていればブロードキャストで1回に書く
+ * @return 書いた
+ */
+static bool write_broadcast() {
+    if (bus_config.motor_count < 2) {
+        return false;
+    }
+    uint32_t command = pending[0].load(std::memory_order_acquire);
+    if ((command & PENDING) == 0 || (command & PENDING_STOP) != 0) {
+        return false;
+    }
+    for (uint8_t i = 1; i < bus_config.motor_count; i++) {
+        if (pending[i].load(std::memory_order_acquire) != command) {
+            return false;
+        }
+    }
+
+    uint8_t request[modbus_rtu::MAX_FRAME_SIZE];
+    size_t length = modbus_rtu::write_register(request, modbus_rtu::BROADCAST_ADDRESS, REG_TARGET,
+                                               static_cast<uint16_t>(command & TARGET_MASK));
+    transact(request, length, nullptr);
+    uint32_t now = bus.now_us();
+    for (uint8_t i = 0; i < bus_config.motor_count; i++) {
+        note_command_latency(i, now);
+        clear_pending(i, command);
+    }
+    return true;
+}
+
+/**
+ * @brief 指令が来ているモーターに1台だけ書く
+ * @return 書いた
+ */
+static bool write_pending() {
+    for (uint8_t i = 0; i < bus_config.motor_count; i++) {
+        uint32_t command = pending[i].load(std::memory_order_acquire);
+        if ((command & PENDING) == 0) {
+            continue;
+        }
+
+        uint8_t request[modbus_rtu::MAX_FRAME_SIZE];
+        uint8_t response[modbus_rtu::MAX_FRAME_SIZE];
+        uint8_t address = static_cast<uint8_t>(bus_config.first_address + i);
+        size_t length = (command & PENDING_STOP) != 0
+                            ? modbus_rtu::write_register(request, address, REG_COMMAND, COMMAND_STOP)
+                            : modbus_rtu::write_register(request, address, REG_TARGET,
+                                                         static_cast<uint16_t>(command & TARGET_MASK));
+        size_t received = transact(request, length, response);
+        modbus_rtu::Status status = received == 0 ? modbus_rtu::Status::BAD_FRAME
+                                                  : modbus_rtu::parse_response(request, response, received, nullptr);
+        if (status == modbus_rtu::Status::OK) {
+            note_command_latency(i, bus.now_us());
+            clear_pending(i, command);
+            return true;
+        }
+        if (received != 0) {
+            counters.errors++;
+        }
+        note_failure(i);
+        // 到達できないモーターへの指令は捨てる（読み出しが止まらないように）
+        if (failures[i] == OFFLINE_FAILURES) {
+            clear_pending(i, command);
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 周回の終わりに統計を更新する
+ */
+static void finish_cycle(uint32_t now) {
+    counters.cycle_us = now - cycle_start_us;
+    counters.utilisation_percent =
+        counters.cycle_us == 0 ? 0 : static_cast<uint8_t>(static_cast<uint64_t>(busy_us) * 100 / counters.cycle_us);
+    uint32_t max_age = 0;
+    for (uint8_t i = 0; i < bus_config.motor_count; i++) {
+        if (failures[i] < OFFLINE_FAILURES && now - updated_us[i] > max_age) {
+            max_age = now - updated_us[i];
+        }
+    }
+    counters.max_age_us = max_age;
+    cycle_start_us = now;
+    busy_us = 0;
+}
+
+/**
+ * @brief 次のモーターの位置と状態を読む
+ */
+static void poll_next() {
+    uint8_t index = poll_cursor;
+    uint8_t request[modbus_rtu::MAX_FRAME_SIZE];
+    uint8_t response[modbus_rtu::MAX_FRAME_SIZE];
+    size_t length = modbus_rtu::read_registers(request, static_cast<uint8_t>(bus_config.first_address + index),
+                                               REG_POSITION, POLL_REGISTERS);
+    size_t received = transact(request, length, response);
+    uint16_t values[POLL_REGISTERS];
+    modbus_rtu::Status status = received == 0 ? modbus_rtu::Status::BAD_FRAME
+                                              : modbus_rtu::parse_response(request, response, received, values);
+    uint32_t now = bus.now_us();
+    if (status == modbus_rtu::Status::OK) {
+        failures[index] = 0;
+        updated_us[index] = now;
+        motor_states[index].write({values[0], values[1], true, now});
+    } else {
+        if (received != 0) {
+            counters.errors++;
+        }
+        note_failure(index);
+    }
+
+    poll_cursor++;
+    if (poll_cursor >= bus_config.motor_count) {
+        poll_cursor = 0;
+        finish_cycle(now);
+    }
+}
+
+void begin(const Config &config, const Transport &transport) {
+    bus_config = config;
+    if (bus_config.motor_count > MAX_MOTORS) {
+        bus_config.motor_count = MAX_MOTORS;
+    }
+    bus = transport;
+    gap_us = modbus_rtu::inter_frame_gap_us(config.baud);
+    for (uint8_t i = 0; i < MAX_MOTORS; i++) {
+        pending[i].store(0, std::memory_order_relaxed);
+        // 最初に応答するまでは到達できないとみなす
+        failures[i] = OFFLINE_FAILURES;
+        updated_us[i] = 0;
+        motor_states[i].write({});
+    }
+    counters = {};
+    poll_cursor = 0;
+    busy_us = 0;
+    cycle_start_us = bus.now_us();
+    bus_free_us = cycle_start_us;
+}
+
+void step() {
+    if (bus_config.motor_count == 0) {
+        return;
+    }
+    // 指令は読み出しより先に送る
+    if (!write_broadcast() && !write_pending()) {
+        poll_next();
+    }
+    published_stats.write(counters);
+}
+
+static void post(uint8_t index, uint32_t command) {
+    if (index >= bus_config.motor_count) {
+        return;
+    }
+    requested_us[index].store(bus.now_us(), std::memory_order_relaxed);
+    pending[index].store(command, std::memory_order_release);
+}
+
+void set_target(uint8_t index, uint16_t position_100ths) {
+    post(index, PENDING | position_100ths);
+}
+
+void stop(uint8_t index) {
+    post(index, PENDING | PENDING_STOP);
+}
+
+MotorState state(uint8_t index) {
+    return index < MAX_MOTORS ? motor_states[index].read() : MotorState{};
+}
+
+uint8_t motor_count() {
+    return bus_config.motor_count;
+}
+
+Stats stats() {
+    return published_stats.read();
+}
+
+} // namespace motor_bus
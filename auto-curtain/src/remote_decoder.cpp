@@ -0,0 +1,169 @@
+/**
+ * @file remote_decoder.cpp
+ * @brief RF（433MHz）とIRのリモコンのパルス列をボタンのコードにする
+ */
+#include "remote_decoder.h"
+
+namespace remote_decoder {
+
+// NEC と Samsung のタイミング [us]
+const int32_t NEC_HEADER_MARK = 9000;
+const int32_t NEC_HEADER_SPACE = 4500;
+const int32_t NEC_REPEAT_SPACE = 2250;
+const int32_t SAMSUNG_HEADER_MARK = 4500;
+const int32_t SAMSUNG_HEADER_SPACE = 4500;
+const int32_t BIT_MARK = 560;
+const int32_t ZERO_SPACE = 560;
+const int32_t ONE_SPACE = 1690;
+const uint8_t IR_BITS = 32;
+// IRのタイミングの許容誤差 [%]
+const int32_t IR_TOLERANCE_PERCENT = 25;
+
+// EV1527 のビット数と，基本の長さ T の範囲 [us]（リモコンによって 150〜700us 程度まで違う）
+const uint8_t RF_BITS = 24;
+const uint8_t RF_COMMAND_BITS = 4;
+const int32_t RF_MIN_T = 150;
+const int32_t RF_MAX_T = 700;
+// RFのタイミングの許容誤差 [%]（受信機の出力はデューティがずれやすいので広めにする）
+const int32_t RF_TOLERANCE_PERCENT = 45;
+// 同期のスペースとみなす長さ [T]
+const int32_t RF_SYNC_MIN_T = 8;
+
+/**
+ * @brief 長さが期待値の許容誤差に入っているか
+ */
+static bool near(int32_t value, int32_t expected, int32_t tolerance_percent) {
+    int32_t margin = expected * tolerance_percent / 100;
+    return value >= expected - margin && value <= expected + margin;
+}
+
+static bool is_mark(int32_t pulse, int32_t expected) {
+    return pulse > 0 && near(pulse, expected, IR_TOLERANCE_PERCENT);
+}
+
+static bool is_space(int32_t pulse, int32_t expected) {
+    return pulse < 0 && near(-pulse, expected, IR_TOLERANCE_PERCENT);
+}
+
+/**
+ * @brief パルス間隔のビット列（NEC と Samsung）を読む．LSBから
+ */
+static bool read_pulse_distance_bits(const int32_t *pulses, uint32_t *bits) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < IR_BITS; i++) {
+        if (!is_mark(pulses[2 * i], BIT_MARK)) {
+            return false;
+        }
+        if (is_space(pulses[2 * i + 1], ONE_SPACE)) {
+            value |= 1u << i;
+        } else if (!is_space(pulses[2 * i + 1], ZERO_SPACE)) {
+            return false;
+        }
+    }
+    *bits = value;
+    return true;
+}
+
+static bool decode_ir(const int32_t *pulses, size_t count, Code *code) {
+    if (count < 3) {
+        return false;
+    }
+    // リピート符号: 9ms のマーク，2.25ms のスペース，ストップビット
+    if (is_mark(pulses[0], NEC_HEADER_MARK) && is_space(pulses[1], NEC_REPEAT_SPACE) && is_mark(pulses[2], BIT_MARK)) {
+        *code = {Protocol::NEC, true, 0, 0};
+        return true;
+    }
+
+    Protocol protocol;
+    if (is_mark(pulses[0], NEC_HEADER_MARK) && is_space(pulses[1], NEC_HEADER_SPACE)) {
+        protocol = Protocol::NEC;
+    } else if (is_mark(pulses[0], SAMSUNG_HEADER_MARK) && is_space(pulses[1], SAMSUNG_HEADER_SPACE)) {
+        protocol = Protocol::SAMSUNG;
+    } else {
+        return false;
+    }
+    // ヘッダ，32ビット，ストップビットのマーク
+    uint32_t bits;
+    if (count < 2 + 2 * IR_BITS + 1 || !read_pulse_distance_bits(pulses + 2, &bits) ||
+        !is_mark(pulses[2 + 2 * IR_BITS], BIT_MARK)) {
+        return false;
+    }
+
+    uint8_t command = static_cast<uint8_t>(bits >> 16);
+    uint8_t inverted_command = static_cast<uint8_t>(bits >> 24);
+    if (static_cast<uint8_t>(~command) != inverted_command) {
+        return false;
+    }
+    uint32_t address = bits & 0xFFFF;
+    if (protocol == Protocol::NEC && static_cast<uint8_t>(~address) == static_cast<uint8_t>(address >> 8)) {
+        // 8ビットのアドレスとその反転（拡張NECなら16ビットのアドレスのまま）
+        address &= 0xFF;
+    }
+    *code = {protocol, false, address, command};
+    return true;
+}
+
+/**
+ * @brief start から EV1527 のフレームとして読む
+ */
+static bool decode_rf_at(const int32_t *pulses, size_t count, size_t start, Code *code) {
+    const size_t length = 2 * RF_BITS;
+    int32_t total = 0;
+    for (size_t i = start; i < start + length; i++) {
+        total += pulses[i] > 0 ? pulses[i] : -pulses[i];
+    }
+    // 1ビットは 4T
+    int32_t t = total / (RF_BITS * 4);
+    if (t < RF_MIN_T || t > RF_MAX_T) {
+        return false;
+    }
+    // 前後は同期（フレームの前は長いスペース，後ろは 1T のマーク）か，記録の端
+    if (start > 0 && pulses[start - 1] > -RF_SYNC_MIN_T * t) {
+        return false;
+    }
+    if (start + length < count && !(pulses[start + length] > 0 && near(pulses[start + length], t, RF_TOLERANCE_PERCENT))) {
+        return false;
+    }
+
+    uint32_t bits = 0;
+    for (uint8_t i = 0; i < RF_BITS; i++) {
+        int32_t mark = pulses[start + 2 * i];
+        int32_t space = -pulses[start + 2 * i + 1];
+        if (mark <= 0 || space <= 0) {
+            return false;
+        }
+        bits <<= 1;
+        if (near(mark, 3 * t, RF_TOLERANCE_PERCENT) && near(space, t, RF_TOLERANCE_PERCENT)) {
+            bits |= 1;
+        } else if (!(near(mark, t, RF_TOLERANCE_PERCENT) && near(space, 3 * t, RF_TOLERANCE_PERCENT))) {
+            return false;
+        }
+    }
+    *code = {Protocol::EV1527, false, bits >> RF_COMMAND_BITS, bits & ((1u << RF_COMMAND_BITS) - 1)};
+    return true;
+}
+
+static bool decode_rf(const int32_t *pulses, size_t count, Code *code) {
+    // 433MHzの受信機は信号がないときも雑音を出すので，記録の途中からフレームを探す
+    for (size_t start = 0; start + 2 * RF_BITS <= count; start++) {
+        if (pulses[start] > 0 && decode_rf_at(pulses, count, start, code)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool decode(const int32_t *pulses, size_t count, Code *code) {
+    return decode_ir(pulses, count, code) || decode_rf(pulses, count, code);
+}
+
+const char *protocol_name(Protocol protocol) {
+    switch (protocol) {
+    case Protocol::NEC: return "nec";
+    case Protocol::SAMSUNG: return "samsung";
+    case Protocol::EV1527: return "ev1527";
+    default: return "none";
+    }
+}
+
+} // namespace remote_decoder
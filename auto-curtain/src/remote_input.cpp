@@ -0,0 +1,259 @@
+/**
+ * @file remote_input.cpp
+ * @brief RF（433MHz）とIRのリモコンで操作する
+ */
+#include "remote_input.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <driver/rmt.h>
+#include <freertos/ringbuf.h>
+#include <string.h>
+#include "board_config.h"
+#include "diag_transport.h"
+#include "tlog.h"
+
+namespace remote_input {
+
+const char *PREFERENCES_NAMESPACE = "remote";
+const char *KEY_BINDINGS = "bindings";
+
+// RMTのカウンタを 1us にする（APB 80MHz）
+const uint8_t RMT_CLOCK_DIVIDER = 80;
+// これより短いパルスは雑音として捨てる [APBクロック]（最大255）
+const uint8_t RMT_FILTER_TICKS = 200;
+// 受信したパルス列を入れるリングバッファの大きさ [byte]
+const size_t RING_BUFFER_SIZE = 1024;
+// 1回の記録から読むパルスの数の上限
+const size_t MAX_PULSES = 192;
+
+/**
+ * @brief 受信機1つ分の設定と状態
+ */
+struct Receiver {
+    const char *name;
+    int pin;
+    rmt_channel_t channel;
+    uint16_t idle_threshold_us; ///< 線がこの時間動かなければ1回分の記録を終える
+    bool active_low;            ///< 受信機の出力が負論理（IRの受光モジュール）
+    RingbufHandle_t ring_buffer;
+};
+
+// ESP32-C3 のRMTはチャネル2と3だけが受信に使える（ESP32はどのチャネルでもよいので合わせておく）
+// IRはフレームの中の最長のスペースが 4.5ms，RFは同期のスペースが 31T（5ms以上）なので，その間で区切る
+static Receiver receivers[] = {
+    {"ir", REMOTE_IR_PIN, RMT_CHANNEL_2, 12000, true, nullptr},
+    {"rf", REMOTE_RF_PIN, RMT_CHANNEL_3, 5000, false, nullptr},
+};
+
+static Preferences preferences;
+static Binding binding_table[MAX_BINDINGS];
+static uint8_t binding_used = 0;
+static Button learning = Button::NONE;
+static bool dumping = false;
+static remote_decoder::Code last = {};
+static bool received = false;
+static uint32_t last_received_ms = 0;
+
+/**
+ * @brief RMTの記録を符号付きの長さの並びにする
+ */
+static size_t to_pulses(const rmt_item32_t *items, size_t item_count, bool active_low, int32_t *pulses) {
+    size_t count = 0;
+    for (size_t i = 0; i < item_count && count + 2 <= MAX_PULSES; i++) {
+        const uint32_t durations[2] = {items[i].duration0, items[i].duration1};
+        const uint32_t levels[2] = {items[i].level0, items[i].level1};
+        for (int k = 0; k < 2; k++) {
+            // 長さ0は記録の終わり（idle）
+            if (durations[k] == 0) {
+                return count;
+            }
+            bool mark = (levels[k] == 0) == active_low;
+            int32_t length = static_cast<int32_t>(durations[k]);
+            pulses[count++] = mark ? length : -length;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief 受信したパルス列を1回の書き込みで表示する（途中にログが割り込まないように）
+ */
+static void print_pulses(const Receiver &receiver, const int32_t *pulses, size_t count) {
+    // 1つのパルスは " +32767" までの7文字
+    static char text[32 + MAX_PULSES * 7 + 2];
+    size_t length = snprintf(text, sizeof(text), "# %s\npulses:", receiver.name);
+    for (size_t i = 0; i < count && length < sizeof(text); i++) {
+        length += snprintf(text + length, sizeof(text) - length, " %+ld", static_cast<long>(pulses[i]));
+    }
+    length = min(length, sizeof(text) - 2);
+    text[length++] = '\n';
+    diag_transport::console_output().write(reinterpret_cast<const uint8_t *>(text), length);
+}
+
+static bool matches(const remote_decoder::Code &code, remote_decoder::Protocol protocol, uint32_t address, uint32_t command) {
+    return code.protocol == protocol && code.address == address && code.command == command;
+}
+
+static void save_bindings() {
+    preferences.putBytes(KEY_BINDINGS, binding_table, sizeof(Binding) * binding_used);
+}
+
+/**
+ * @brief コードを button として覚える．同じコードを覚えていれば役割を変える
+ */
+static void bind(const remote_decoder::Code &code, Button button) {
+    uint8_t index = 0;
+    while (index < binding_used &&
+           !matches(code, binding_table[index].protocol, binding_table[index].address, binding_table[index].command)) {
+        index++;
+    }
+    if (index == MAX_BINDINGS) {
+        TLOG("Remote: no room for more buttons");
+        return;
+    }
+    if (index == binding_used) {
+        binding_used++;
+    }
+    binding_table[index] = {code.protocol, button, code.address, code.command};
+    save_bindings();
+    TLOG("Remote: learned %s %lx/%lx as %s", remote_decoder::protocol_name(code.protocol),
+         static_cast<unsigned long>(code.address), static_cast<unsigned long>(code.command), button_name(button));
+}
+
+/**
+ * @brief 復号したコードをボタンにする
+ */
+static Button handle_code(const remote_decoder::Code &code) {
+    uint32_t now = millis();
+    bool held = received && now - last_received_ms < HOLD_MS &&
+                (code.repeat || matches(code, last.protocol, last.address, last.command));
+    last_received_ms = now;
+    if (code.repeat) {
+        // リピート符号は押し続け．押し続けの時間だけ延ばす
+        return Button::NONE;
+    }
+    last = code;
+    received = true;
+    if (held) {
+        return Button::NONE;
+    }
+
+    if (learning != Button::NONE) {
+        bind(code, learning);
+        learning = Button::NONE;
+        return Button::NONE;
+    }
+    for (uint8_t i = 0; i < binding_used; i++) {
+        const Binding &binding = binding_table[i];
+        if (matches(code, binding.protocol, binding.address, binding.command)) {
+            return binding.button;
+        }
+    }
+    return Button::NONE;
+}
+
+/**
+ * @brief 受信チャネルを設定して受信を始める
+ */
+static void start_receiver(Receiver &receiver) {
+    rmt_config_t config = RMT_DEFAULT_CONFIG_RX(static_cast<gpio_num_t>(receiver.pin), receiver.channel);
+    config.clk_div = RMT_CLOCK_DIVIDER;
+    config.rx_config.filter_en = true;
+    config.rx_config.filter_ticks_thresh = RMT_FILTER_TICKS;
+    config.rx_config.idle_threshold = receiver.idle_threshold_us;
+    if (rmt_config(&config) != ESP_OK || rmt_driver_install(receiver.channel, RING_BUFFER_SIZE, 0) != ESP_OK ||
+        rmt_get_ringbuf_handle(receiver.channel, &receiver.ring_buffer) != ESP_OK) {
+        TLOG("Remote: %s receiver not available", receiver.name);
+        receiver.ring_buffer = nullptr;
+        return;
+    }
+    rmt_rx_start(receiver.channel, true);
+}
+
+void begin() {
+    preferences.begin(PREFERENCES_NAMESPACE, false);
+    size_t length = preferences.getBytes(KEY_BINDINGS, binding_table, sizeof(binding_table));
+    binding_used = static_cast<uint8_t>(length / sizeof(Binding));
+
+    for (Receiver &receiver : receivers) {
+        if (receiver.pin >= 0) {
+            start_receiver(receiver);
+        }
+    }
+}
+
+Button poll() {
+    Button pressed = Button::NONE;
+    for (Receiver &receiver : receivers) {
+        if (receiver.ring_buffer == nullptr) {
+            continue;
+        }
+        size_t size = 0;
+        rmt_item32_t *items;
+        while ((items = static_cast<rmt_item32_t *>(xRingbufferReceive(receiver.ring_buffer, &size, 0))) != nullptr) {
+            int32_t pulses[MAX_PULSES];
+            size_t count = to_pulses(items, size / sizeof(rmt_item32_t), receiver.active_low, pulses);
+            vRingbufferReturnItem(receiver.ring_buffer, items);
+            if (dumping) {
+                print_pulses(receiver, pulses, count);
+            }
+            remote_decoder::Code code;
+            if (remote_decoder::decode(pulses, count, &code)) {
+                Button button = handle_code(code);
+                if (button != Button::NONE) {
+                    pressed = button;
+                }
+            }
+        }
+    }
+    return pressed;
+}
+
+void learn(Button button) {
+    learning = button;
+}
+
+void clear() {
+    binding_used = 0;
+    learning = Button::NONE;
+    preferences.remove(KEY_BINDINGS);
+}
+
+void set_dump(bool enabled) {
+    dumping = enabled;
+}
+
+uint8_t binding_count() {
+    return binding_used;
+}
+
+const Binding *bindings() {
+    return binding_table;
+}
+
+bool last_code(remote_decoder::Code *code) {
+    *code = last;
+    return received;
+}
+
+const char *button_name(Button button) {
+    switch (button) {
+    case Button::OPEN: return "open";
+    case Button::CLOSE: return "close";
+    case Button::STOP: return "stop";
+    case Button::TOGGLE: return "toggle";
+    default: return "none";
+    }
+}
+
+Button from_name(const char *name) {
+    for (Button button : {Button::OPEN, Button::CLOSE, Button::STOP, Button::TOGGLE}) {
+        if (strcmp(name, button_name(button)) == 0) {
+            return button;
+        }
+    }
+    return Button::NONE;
+}
+
+} // namespace remote_input
@@ -0,0 +1,76 @@
+/**
+ * @file rs485_port.cpp
+ * @brief ブリッジモードのRS-485の送受信（UART2，半二重）
+ */
+#include "rs485_port.h"
+
+#include <Arduino.h>
+#include <driver/uart.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "board_config.h"
+
+namespace rs485_port {
+
+const uart_port_t RS485_UART = UART_NUM_2;
+const int RX_BUFFER_SIZE = 256;
+// この文字数の間受信が途切れたら，FIFOにたまった分をドライバに渡す
+const uint8_t RX_TIMEOUT_CHARACTERS = 2;
+// 送り終わるのを待つ上限
+const TickType_t TX_WAIT = pdMS_TO_TICKS(20);
+
+static void send(const uint8_t *frame, size_t length) {
+    // 前の応答の残りや雑音を捨ててから送る
+    uart_flush_input(RS485_UART);
+    uart_write_bytes(RS485_UART, frame, length);
+    uart_wait_tx_done(RS485_UART, TX_WAIT);
+}
+
+static size_t receive(uint8_t *frame, size_t capacity, size_t expected, uint32_t timeout_us) {
+    size_t wanted = expected < capacity ? expected : capacity;
+    // tick に切り上げる（1tick 未満で戻らないように1足す）
+    TickType_t timeout = pdMS_TO_TICKS((timeout_us + 999) / 1000) + 1;
+    int length = uart_read_bytes(RS485_UART, frame, wanted, timeout);
+    return length < 0 ? 0 : static_cast<size_t>(length);
+}
+
+static uint32_t now_us() {
+    return static_cast<uint32_t>(esp_timer_get_time());
+}
+
+static void wait_until_us(uint32_t time_us) {
+    int32_t remaining = static_cast<int32_t>(time_us - now_us());
+    if (remaining <= 0) {
+        return;
+    }
+    // 1tick 以上はほかのタスクに譲り，残りだけ待つ
+    if (remaining >= 1000 * portTICK_PERIOD_MS) {
+        vTaskDelay(remaining / 1000 / portTICK_PERIOD_MS);
+        remaining = static_cast<int32_t>(time_us - now_us());
+    }
+    if (remaining > 0) {
+        delayMicroseconds(remaining);
+    }
+}
+
+void begin(uint32_t baud) {
+    uart_config_t config = {};
+    config.baud_rate = static_cast<int>(baud);
+    config.data_bits = UART_DATA_8_BITS;
+    config.parity = UART_PARITY_EVEN;
+    config.stop_bits = UART_STOP_BITS_1;
+    config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    config.source_clk = UART_SCLK_APB;
+    uart_driver_install(RS485_UART, RX_BUFFER_SIZE, 0, 0, nullptr, 0);
+    uart_param_config(RS485_UART, &config);
+    uart_set_pin(RS485_UART, RS485_TX_PIN, RS485_RX_PIN, RS485_DE_PIN, UART_PIN_NO_CHANGE);
+    uart_set_mode(RS485_UART, UART_MODE_RS485_HALF_DUPLEX);
+    uart_set_rx_timeout(RS485_UART, RX_TIMEOUT_CHARACTERS);
+}
+
+motor_bus::Transport transport() {
+    return {send, receive, now_us, wait_until_us};
+}
+
+} // namespace rs485_port
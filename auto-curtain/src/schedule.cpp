@@ -0,0 +1,235 @@
+/**
+ * @file schedule.cpp
+ * @brief 週単位のスケジュール（曜日と時刻ごとの目標位置）
+ */
+#include "schedule.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <algorithm>
+#include <atomic>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <string.h>
+#include "command_arbiter.h"
+#include "motion.h"
+#include "sequencer.h"
+#include "tlog.h"
+#include "wall_clock.h"
+
+namespace schedule {
+
+const char *PREFERENCES_NAMESPACE = "schedule";
+const char *KEY_ENTRIES = "entries";
+
+// タイマーが少し早く切れても（時刻の補正など）そのイベントとして実行する幅 [s]
+const uint32_t EARLY_TOLERANCE_SECONDS = 5;
+
+// フローに送るイベント
+const uint32_t EVENT_TIMER = 1 << 0;
+const uint32_t EVENT_TABLE_CHANGED = 1 << 1;
+const uint32_t EVENT_CLOCK_CHANGED = 1 << 2;
+
+static sequencer::Flow schedule_flow;
+static esp_timer_handle_t event_timer = nullptr;
+
+// 使用中の表．loopタスクからしか触らない
+static Entry table[MAX_ENTRIES];
+static uint16_t table_count = 0;
+static uint16_t armed_index = 0;
+static std::atomic<uint16_t> armed_minute(NO_EVENT);
+
+// set_entries() で受け取った新しい表．loopタスクで table に移す
+static SemaphoreHandle_t pending_mutex = nullptr;
+static Entry pending_table[MAX_ENTRIES];
+static uint16_t pending_count = 0;
+// 受け取った表を確かめて並べるための作業領域（pending_mutex で守る）
+static Entry received[MAX_ENTRIES];
+
+/**
+ * @brief 時刻順に並べ，同じ時刻のものは後のものを残す
+ * @return 残った件数
+ */
+static uint16_t sort_entries(Entry *entries, uint16_t count) {
+    std::stable_sort(entries, entries + count, [](const Entry &a, const Entry &b) {
+        return a.minute_of_week < b.minute_of_week;
+    });
+    uint16_t kept = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        if (kept > 0 && entries[kept - 1].minute_of_week == entries[i].minute_of_week) {
+            entries[kept - 1] = entries[i];
+        } else {
+            entries[kept++] = entries[i];
+        }
+    }
+    return kept;
+}
+
+static void on_event_timer(void *arg) {
+    sequencer::post(schedule_flow, EVENT_TIMER);
+}
+
+/**
+ * @brief after_second より後の最初のイベントにタイマーを仕掛ける
+ * @param after_second 基準にする週の中の秒数（これより後のイベントを探す）
+ */
+static void arm_after(uint32_t after_second) {
+    esp_timer_stop(event_timer);
+    if (table_count == 0) {
+        armed_minute.store(NO_EVENT);
+        return;
+    }
+
+    // 時刻順に並んでいるので二分探索で探す．最後より後なら翌週の先頭
+    uint16_t after_minute = after_second / 60;
+    const Entry *next = std::upper_bound(table, table + table_count, after_minute,
+        [](uint16_t minute, const Entry &entry) { return minute < entry.minute_of_week; });
+    armed_index = next == table + table_count ? 0 : next - table;
+    uint32_t target_second = table[armed_index].minute_of_week * 60UL;
+
+    uint32_t delay = (target_second + wall_clock::SECONDS_PER_WEEK - after_second) % wall_clock::SECONDS_PER_WEEK;
+    if (delay == 0) {
+        delay = wall_clock::SECONDS_PER_WEEK;
+    }
+    // 基準が現在時刻からずれている分（早く切れたときなど）を足し引きする．
+    // 週の境目をまたぐと差が ±1週に近くなるので，(-半週, 半週] に折り返す
+    // （そうしないと境目の直前に早く切れたとき1秒に切り詰められ，同じイベントが2回実行される）
+    int32_t offset = static_cast<int32_t>(after_second) - static_cast<int32_t>(wall_clock::local_second_of_week());
+    const int32_t half_week = wall_clock::SECONDS_PER_WEEK / 2;
+    if (offset > half_week) {
+        offset -= wall_clock::SECONDS_PER_WEEK;
+    } else if (offset <= -half_week) {
+        offset += wall_clock::SECONDS_PER_WEEK;
+    }
+    int64_t delay_us = (static_cast<int64_t>(delay) + offset) * 1000000LL;
+    if (delay_us < 1000000LL) {
+        delay_us = 1000000LL;
+    }
+    esp_timer_start_once(event_timer, delay_us);
+    armed_minute.store(table[armed_index].minute_of_week);
+}
+
+/**
+ * @brief タイマーが切れた．仕掛けたイベントの時刻なら実行して次を仕掛ける
+ */
+static void fire() {
+    if (table_count == 0) {
+        return;
+    }
+    uint32_t now = wall_clock::local_second_of_week();
+    const Entry &entry = table[armed_index];
+    uint32_t entry_second = entry.minute_of_week * 60UL;
+    uint32_t late = (now + wall_clock::SECONDS_PER_WEEK - entry_second) % wall_clock::SECONDS_PER_WEEK;
+    if (late < 60 || late >= wall_clock::SECONDS_PER_WEEK - EARLY_TOLERANCE_SECONDS) {
+        TLOG("Schedule: move to %u", entry.position_100ths);
+        command_arbiter::submit({command_arbiter::Source::SCHEDULE, command_arbiter::Action::MOVE_TO, entry.position_100ths});
+        arm_after(entry_second);
+    } else {
+        // 時刻が大きく変わっていたので探し直す
+        arm_after(now);
+    }
+}
+
+/**
+ * @brief 新しい表を使用中の表に移して保存する
+ */
+static void apply_pending_table() {
+    xSemaphoreTake(pending_mutex, portMAX_DELAY);
+    memcpy(table, pending_table, pending_count * sizeof(Entry));
+    table_count = pending_count;
+    xSemaphoreGive(pending_mutex);
+
+    Preferences preferences;
+    preferences.begin(PREFERENCES_NAMESPACE, false);
+    preferences.putBytes(KEY_ENTRIES, table, table_count * sizeof(Entry));
+    preferences.end();
+}
+
+/**
+ * @brief スケジュールのフロー．時刻が設定されるのを待ってから，イベントごとに実行と再設定をする
+ */
+static sequencer::Status run_schedule(sequencer::Flow &flow) {
+    static uint32_t events = 0;
+    SEQ_BEGIN(flow);
+    while (true) {
+        SEQ_WAIT_UNTIL(flow, (events = sequencer::take_events(flow, EVENT_TIMER | EVENT_TABLE_CHANGED | EVENT_CLOCK_CHANGED)) != 0);
+        if (events & EVENT_TABLE_CHANGED) {
+            apply_pending_table();
+        }
+        if (!wall_clock::is_set()) {
+            continue;
+        }
+        if ((events & (EVENT_TABLE_CHANGED | EVENT_CLOCK_CHANGED)) != 0) {
+            arm_after(wall_clock::local_second_of_week());
+        } else {
+            fire();
+        }
+    }
+    SEQ_END(flow);
+}
+
+void begin() {
+    Preferences preferences;
+    preferences.begin(PREFERENCES_NAMESPACE, true);
+    size_t length = preferences.getBytesLength(KEY_ENTRIES);
+    if (length % sizeof(Entry) == 0 && length <= sizeof(table)) {
+        table_count = preferences.getBytes(KEY_ENTRIES, table, length) / sizeof(Entry);
+    }
+    preferences.end();
+
+    pending_mutex = xSemaphoreCreateMutex();
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = on_event_timer;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "schedule";
+    esp_timer_create(&timer_args, &event_timer);
+
+    sequencer::add(schedule_flow, "schedule", run_schedule);
+}
+
+bool set_entries(const uint8_t *data, size_t length) {
+    if (length % sizeof(Entry) != 0 || length / sizeof(Entry) > MAX_ENTRIES) {
+        return false;
+    }
+    uint16_t count = length / sizeof(Entry);
+
+    xSemaphoreTake(pending_mutex, portMAX_DELAY);
+    memcpy(received, data, length);
+    bool valid = true;
+    for (uint16_t i = 0; i < count; i++) {
+        if (received[i].minute_of_week >= MINUTES_PER_WEEK || received[i].position_100ths > motion::POSITION_100THS_MAX) {
+            valid = false;
+            break;
+        }
+    }
+    if (valid) {
+        pending_count = sort_entries(received, count);
+        memcpy(pending_table, received, pending_count * sizeof(Entry));
+    }
+    xSemaphoreGive(pending_mutex);
+
+    if (valid) {
+        sequencer::post(schedule_flow, EVENT_TABLE_CHANGED);
+    }
+    return valid;
+}
+
+void reschedule() {
+    sequencer::post(schedule_flow, EVENT_CLOCK_CHANGED);
+}
+
+uint16_t entry_count() {
+    return table_count;
+}
+
+const Entry *entries() {
+    return table;
+}
+
+uint16_t next_event_minute() {
+    return armed_minute.load();
+}
+
+} // namespace schedule
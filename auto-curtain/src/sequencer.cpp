@@ -0,0 +1,41 @@
+/**
+ * @file sequencer.cpp
+ * @brief スタックを持たない協調型シーケンサ（protothread 風）
+ */
+#include "sequencer.h"
+
+namespace sequencer {
+
+static Flow *flows = nullptr;
+
+void add(Flow &flow, const char *name, FlowFunction function) {
+    flow.name = name;
+    flow.function = function;
+    flow.resume_line = 0;
+    flow.done = false;
+    flow.wake_at = 0;
+    flow.events.store(0);
+    flow.next = flows;
+    flows = &flow;
+}
+
+void post(Flow &flow, uint32_t event_bits) {
+    flow.events.fetch_or(event_bits);
+}
+
+uint32_t take_events(Flow &flow, uint32_t event_bits) {
+    return flow.events.fetch_and(~event_bits) & event_bits;
+}
+
+void poll() {
+    for (Flow *flow = flows; flow != nullptr; flow = flow->next) {
+        if (flow->done) {
+            continue;
+        }
+        if (flow->function(*flow) == Status::DONE) {
+            flow->done = true;
+        }
+    }
+}
+
+} // namespace sequencer
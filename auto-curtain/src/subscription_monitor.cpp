@@ -0,0 +1,95 @@
+/**
+ * @file subscription_monitor.cpp
+ * @brief 再起動後にサブスクリプションが戻るまでの時間を計測する
+ */
+#include "subscription_monitor.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <app/InteractionModelEngine.h>
+#include <app/ReadHandler.h>
+#include <platform/CHIPDeviceLayer.h>
+#include "tlog.h"
+
+namespace subscription_monitor {
+
+const char *PREFERENCES_NAMESPACE = "subs";
+const char *KEY_EXPECTED = "expected";
+// 張り直しを待つ時間 [ms]．過ぎたら，そろわなくても戻った数を次の起動の expected にする
+const uint32_t RESTORE_WINDOW_MS = 120000;
+
+static Preferences preferences;
+static Stats current = {};
+
+/**
+ * @brief 次の起動のために現在の数を保存する（起動直後の張り直しが終わってから）
+ */
+static void save_expected() {
+    if (current.all_restored_ms == 0 && !current.window_closed) {
+        return;
+    }
+    if (preferences.getUShort(KEY_EXPECTED, 0) != current.active) {
+        preferences.putUShort(KEY_EXPECTED, current.active);
+    }
+}
+
+/**
+ * @brief 張り直しを待つ時間が過ぎた（CHIPのタスクで呼ばれる）
+ *
+ * 再起動前より少ない数しか戻らないと all_restored_ms は決まらないので，ここで計測を打ち切って戻った数を保存する．
+ * そうしないと expected が古い数のまま残り，次の起動からもずっとそろわない．
+ */
+static void on_restore_window_closed(chip::System::Layer *layer, void *context) {
+    current.window_closed = true;
+    if (current.all_restored_ms == 0) {
+        TLOG("Subscriptions restored within window: %u / %u", current.active, current.expected);
+    }
+    save_expected();
+}
+
+/**
+ * @brief サブスクリプションの確立と終了を受け取るコールバック
+ */
+class Callback : public chip::app::ReadHandler::ApplicationCallback {
+public:
+    void OnSubscriptionEstablished(chip::app::ReadHandler &handler) override {
+        current.active++;
+        uint32_t now = millis();
+        if (current.first_ms == 0) {
+            current.first_ms = now;
+        }
+        if (current.all_restored_ms == 0 && current.active >= current.expected) {
+            current.all_restored_ms = now;
+            TLOG("All subscriptions restored after [ms]: %lu", static_cast<unsigned long>(now));
+        }
+        save_expected();
+    }
+
+    void OnSubscriptionTerminated(chip::app::ReadHandler &handler) override {
+        if (current.active > 0) {
+            current.active--;
+        }
+        save_expected();
+    }
+};
+
+static Callback callback;
+
+void begin() {
+    preferences.begin(PREFERENCES_NAMESPACE, false);
+    current.expected = preferences.getUShort(KEY_EXPECTED, 0);
+    if (current.expected == 0) {
+        // 以前のサブスクリプションがないので，そろうのを待つものもない
+        current.all_restored_ms = millis();
+    } else {
+        chip::DeviceLayer::SystemLayer().StartTimer(chip::System::Clock::Milliseconds32(RESTORE_WINDOW_MS),
+                                                    on_restore_window_closed, nullptr);
+    }
+    chip::app::InteractionModelEngine::GetInstance()->RegisterReadHandlerAppCallback(&callback);
+}
+
+Stats stats() {
+    return current;
+}
+
+} // namespace subscription_monitor
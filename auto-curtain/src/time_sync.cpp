@@ -0,0 +1,222 @@
+/**
+ * @file time_sync.cpp
+ * @brief ファブリック上のコントローラーの Time Synchronization クラスターから時刻を得る
+ */
+#include "time_sync.h"
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <access/AccessControl.h>
+#include <app/CASESessionManager.h>
+#include <app/InteractionModelEngine.h>
+#include <app/server/Server.h>
+#include <controller/ReadInteraction.h>
+#include <platform/CHIPDeviceLayer.h>
+#include "schedule.h"
+#include "sequencer.h"
+#include "wall_clock.h"
+
+namespace time_sync {
+
+namespace TimeSynchronization = chip::app::Clusters::TimeSynchronization;
+
+// 同期の間隔 [s]．誤差に応じてこの範囲で伸び縮みさせる
+const uint32_t MIN_INTERVAL_S = 15 * 60;
+const uint32_t MAX_INTERVAL_S = 24 * 60 * 60;
+// 誤差がこれより小さければ間隔を伸ばし，GROW_LIMIT より大きければ縮める [us]
+const int64_t GROW_LIMIT_US = 200000;
+const int64_t SHRINK_LIMIT_US = 1000000;
+// これより大きくずれていたらスケジュールのタイマーを仕掛け直す [us]
+const int64_t RESCHEDULE_LIMIT_US = 1000000;
+// 返事を待つ時間と，失敗したときに次を試すまでの時間 [ms]
+const uint32_t RESPONSE_TIMEOUT_MS = 30000;
+const uint32_t RETRY_DELAY_MS = 60000;
+
+// UTCTime は 2000-01-01 からのマイクロ秒．1970-01-01 からの差
+const uint64_t MATTER_EPOCH_OFFSET_US = 946684800ULL * 1000000ULL;
+// コントローラーの Time Synchronization クラスターはルートエンドポイントにある
+const chip::EndpointId TIME_SOURCE_ENDPOINT = 0;
+
+// フローに送るイベント
+const uint32_t EVENT_SERVER_READY = 1 << 0;
+const uint32_t EVENT_RESPONSE = 1 << 1;
+const uint32_t EVENT_SYNC_NOW = 1 << 2;
+
+static sequencer::Flow sync_flow;
+
+// 読み出しの結果．CHIPのタスクで書き，EVENT_RESPONSE を送ってからloopタスクで読む
+static portMUX_TYPE result_mux = portMUX_INITIALIZER_UNLOCKED;
+static bool result_ok = false;
+static uint64_t result_unix_us = 0;
+static int64_t request_timer_us = 0;
+static int64_t response_timer_us = 0;
+
+// CHIPのタスクからしか触らない
+static chip::ScopedNodeId peer;
+
+static Stats current = {0, 0, 0, 0, MIN_INTERVAL_S, 0};
+
+/**
+ * @brief 結果を記録してフローに知らせる（CHIPのタスクから呼ぶ）
+ */
+static void finish_request(bool ok, uint64_t unix_us) {
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&result_mux);
+    result_ok = ok;
+    result_unix_us = unix_us;
+    response_timer_us = now;
+    portEXIT_CRITICAL(&result_mux);
+    sequencer::post(sync_flow, EVENT_RESPONSE);
+}
+
+/**
+ * @brief 時刻を読むコントローラーを探す．最初のファブリックのACLで，CASEで管理者権限を持つノード
+ * @return 見つかればtrue
+ */
+static bool find_time_source(chip::ScopedNodeId &found) {
+    for (const chip::FabricInfo &fabric : chip::Server::GetInstance().GetFabricTable()) {
+        chip::FabricIndex fabric_index = fabric.GetFabricIndex();
+        chip::Access::AccessControl::EntryIterator iterator;
+        if (chip::Access::GetAccessControl().Entries(iterator, &fabric_index) != CHIP_NO_ERROR) {
+            continue;
+        }
+        chip::Access::AccessControl::Entry entry;
+        while (iterator.Next(entry) == CHIP_NO_ERROR) {
+            chip::Access::Privilege privilege;
+            chip::Access::AuthMode auth_mode;
+            size_t subject_count = 0;
+            chip::NodeId subject;
+            if (entry.GetPrivilege(privilege) == CHIP_NO_ERROR && privilege == chip::Access::Privilege::kAdminister &&
+                entry.GetAuthMode(auth_mode) == CHIP_NO_ERROR && auth_mode == chip::Access::AuthMode::kCase &&
+                entry.GetSubjectCount(subject_count) == CHIP_NO_ERROR && subject_count > 0 &&
+                entry.GetSubject(0, subject) == CHIP_NO_ERROR) {
+                found = chip::ScopedNodeId(subject, fabric_index);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void on_connected(void *context, chip::Messaging::ExchangeManager &exchange_manager, const chip::SessionHandle &session) {
+    auto on_success = [](const chip::app::ConcreteDataAttributePath &path,
+                         const TimeSynchronization::Attributes::UTCTime::TypeInfo::DecodableType &value) {
+        if (value.IsNull()) {
+            finish_request(false, 0);
+        } else {
+            finish_request(true, value.Value() + MATTER_EPOCH_OFFSET_US);
+        }
+    };
+    auto on_failure = [](const chip::app::ConcreteDataAttributePath *path, CHIP_ERROR error) {
+        finish_request(false, 0);
+    };
+    CHIP_ERROR error = chip::Controller::ReadAttribute<TimeSynchronization::Attributes::UTCTime::TypeInfo>(
+        &exchange_manager, session, TIME_SOURCE_ENDPOINT, on_success, on_failure);
+    if (error != CHIP_NO_ERROR) {
+        finish_request(false, 0);
+    }
+}
+
+static void on_connection_failure(void *context, const chip::ScopedNodeId &peer_id, CHIP_ERROR error) {
+    finish_request(false, 0);
+}
+
+static chip::Callback::Callback<chip::OnDeviceConnected> connected_callback(on_connected, nullptr);
+static chip::Callback::Callback<chip::OnDeviceConnectionFailure> failure_callback(on_connection_failure, nullptr);
+
+/**
+ * @brief コントローラーにつないで UTCTime を読む（CHIPのタスクで動かす）
+ */
+static void start_request(intptr_t arg) {
+    if (!find_time_source(peer)) {
+        finish_request(false, 0);
+        return;
+    }
+    request_timer_us = esp_timer_get_time();
+    chip::app::InteractionModelEngine::GetInstance()->GetCASESessionManager()->FindOrEstablishSession(
+        peer, &connected_callback, &failure_callback);
+}
+
+/**
+ * @brief 読み出しの結果を時計に反映し，次の同期までの間隔を決める
+ * @return 時刻を得られたらtrue
+ */
+static bool apply_result() {
+    portENTER_CRITICAL(&result_mux);
+    bool ok = result_ok;
+    uint64_t unix_us = result_unix_us;
+    int64_t sent = request_timer_us;
+    int64_t received = response_timer_us;
+    portEXIT_CRITICAL(&result_mux);
+
+    if (!ok) {
+        return false;
+    }
+    // 読んだ時刻は往復の途中のどこかなので，中点に対応させる
+    int64_t error_us = wall_clock::synchronize(unix_us, sent + (received - sent) / 2);
+    bool first = current.sync_count == 0;
+    current.sync_count++;
+    current.last_error_ms = static_cast<int32_t>(error_us / 1000);
+    current.round_trip_ms = static_cast<uint32_t>((received - sent) / 1000);
+    current.peer_node_id = peer.GetNodeId();
+
+    int64_t magnitude = error_us < 0 ? -error_us : error_us;
+    if (!first && magnitude < GROW_LIMIT_US && current.interval_s < MAX_INTERVAL_S) {
+        current.interval_s = min(current.interval_s * 2, MAX_INTERVAL_S);
+    } else if (magnitude > SHRINK_LIMIT_US && current.interval_s > MIN_INTERVAL_S) {
+        current.interval_s = max(current.interval_s / 2, MIN_INTERVAL_S);
+    }
+    if (first || magnitude > RESCHEDULE_LIMIT_US) {
+        schedule::reschedule();
+    }
+    return true;
+}
+
+/**
+ * @brief 同期のフロー．サーバーの準備ができたら同期し，間隔をおいて繰り返す
+ */
+static sequencer::Status run_sync(sequencer::Flow &flow) {
+    static bool responded = false;
+    static bool synced = false;
+    SEQ_BEGIN(flow);
+    SEQ_WAIT_UNTIL(flow, sequencer::take_events(flow, EVENT_SERVER_READY) != 0);
+    while (true) {
+        // 前回の遅れて届いた返事は捨てる
+        sequencer::take_events(flow, EVENT_RESPONSE | EVENT_SYNC_NOW);
+        portENTER_CRITICAL(&result_mux);
+        result_ok = false;
+        portEXIT_CRITICAL(&result_mux);
+        chip::DeviceLayer::PlatformMgr().ScheduleWork(start_request, 0);
+
+        flow.wake_at = millis() + RESPONSE_TIMEOUT_MS;
+        SEQ_WAIT_UNTIL(flow, (responded = sequencer::take_events(flow, EVENT_RESPONSE) != 0) || sequencer::sleep_elapsed(flow));
+        synced = responded && apply_result();
+        if (!synced) {
+            current.failure_count++;
+        }
+
+        // 失敗したら短い間隔で試し直す
+        flow.wake_at = millis() + (synced ? current.interval_s * 1000UL : RETRY_DELAY_MS);
+        SEQ_WAIT_UNTIL(flow, sequencer::take_events(flow, EVENT_SYNC_NOW) != 0 || sequencer::sleep_elapsed(flow));
+    }
+    SEQ_END(flow);
+}
+
+void begin() {
+    sequencer::add(sync_flow, "time_sync", run_sync);
+}
+
+void notify_server_ready() {
+    sequencer::post(sync_flow, EVENT_SERVER_READY);
+}
+
+void request_sync() {
+    sequencer::post(sync_flow, EVENT_SYNC_NOW);
+}
+
+Stats stats() {
+    return current;
+}
+
+} // namespace time_sync
@@ -0,0 +1,69 @@
+/**
+ * @file tlog.cpp
+ * @brief トークン化したログ（書式文字列の代わりに番号と引数のバイナリを送る）
+ */
+#include "tlog.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "diag_transport.h"
+
+namespace tlog {
+
+Encoder::Encoder(uint32_t token) : size(2) {
+    frame[0] = FRAME_START;
+    for (int i = 0; i < 4; i++) {
+        put_byte(static_cast<uint8_t>(token >> (8 * i)));
+    }
+}
+
+void Encoder::put_byte(uint8_t value) {
+    // 入りきらない引数は捨てる（デコーダーは足りない引数を ? で表示する）
+    if (size < sizeof(frame)) {
+        frame[size++] = value;
+    }
+}
+
+void Encoder::put_integer(int64_t value) {
+    uint64_t zigzag = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    while (zigzag >= 0x80) {
+        put_byte(static_cast<uint8_t>(zigzag | 0x80));
+        zigzag >>= 7;
+    }
+    put_byte(static_cast<uint8_t>(zigzag));
+}
+
+void Encoder::put_float(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 4; i++) {
+        put_byte(static_cast<uint8_t>(bits >> (8 * i)));
+    }
+}
+
+void Encoder::put_string(const char *value) {
+    size_t length = value == nullptr ? 0 : strnlen(value, MAX_STRING_LENGTH);
+    put_byte(static_cast<uint8_t>(length));
+    for (size_t i = 0; i < length; i++) {
+        put_byte(static_cast<uint8_t>(value[i]));
+    }
+}
+
+void Encoder::send() {
+    frame[1] = static_cast<uint8_t>(size - 2);
+    diag_transport::write(frame, size);
+}
+
+void print(const char *format, ...) {
+    char text[96];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length > 0) {
+        diag_transport::write(text, min(static_cast<size_t>(length), sizeof(text) - 1));
+    }
+}
+
+} // namespace tlog
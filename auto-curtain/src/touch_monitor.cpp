@@ -0,0 +1,89 @@
+/**
+ * @file touch_monitor.cpp
+ * @brief 停止中のカーテンが手で引かれたことを検出して自動で開閉する（タッチ操作）
+ */
+#include "touch_monitor.h"
+
+#include <Arduino.h>
+#include <atomic>
+#include "board_config.h"
+#include "command_arbiter.h"
+#include "device_flows.h"
+#include "motion.h"
+
+namespace touch_monitor {
+
+// 手で引かれたとみなす移動量 [count]（全行程の2%）
+const int32_t PULL_THRESHOLD_COUNTS = CURTAIN_TRAVEL_COUNTS / 50;
+// この周期数のうちに閾値を超えなければ基準位置を取り直す（ゆっくりしたずれは無視する）
+const uint32_t WINDOW_SAMPLES = 20;
+
+// トリガーがないことを表す特別な値
+const int32_t NO_TRIGGER = -1;
+
+static std::atomic<int32_t> triggered_target(NO_TRIGGER);
+
+// ここから下は poll()（loop）からしか触らない
+static bool started = false;
+static uint32_t last_sample_ms = 0;
+static bool was_idle = false;
+static int32_t window_start_count = 0;
+static uint32_t window_samples = 0;
+
+/**
+ * @brief サンプル周期の処理
+ */
+static void sample_tick() {
+    int32_t count = motion::position_counts();
+
+    // 原点出しは止まったまま位置を上書きするので，終わるまで基準位置を取らない
+    if (motion::state() == motion::State::MOVING || device_flows::is_homing()) {
+        was_idle = false;
+        return;
+    }
+    if (!was_idle || window_samples >= WINDOW_SAMPLES) {
+        // 停止した直後と窓の終わりで基準位置を取り直す
+        was_idle = true;
+        window_start_count = count;
+        window_samples = 0;
+        return;
+    }
+    window_samples++;
+
+    int32_t displacement = count - window_start_count;
+    if (displacement >= PULL_THRESHOLD_COUNTS || displacement <= -PULL_THRESHOLD_COUNTS) {
+        // 引かれた方向の端まで動かす
+        uint16_t target = displacement > 0 ? motion::POSITION_100THS_MAX : 0;
+        command_arbiter::Command command = {command_arbiter::Source::LOCAL, command_arbiter::Action::MOVE_TO, target};
+        if (command_arbiter::submit(command) == command_arbiter::Result::ACCEPTED) {
+            triggered_target.store(target);
+        }
+        was_idle = false;
+    }
+}
+
+void begin() {
+    was_idle = false;
+    last_sample_ms = millis();
+    started = true;
+}
+
+void poll() {
+    // loop が遅れて溜まった周期はまとめて1回だけ処理すればよい
+    if (!started || millis() - last_sample_ms < SAMPLE_PERIOD_MS) {
+        return;
+    }
+    last_sample_ms = millis();
+    sample_tick();
+}
+
+bool take_triggered_target(uint16_t *target) {
+    int32_t value = triggered_target.exchange(NO_TRIGGER);
+    if (value == NO_TRIGGER) {
+        return false;
+    }
+    *target = static_cast<uint16_t>(value);
+    return true;
+}
+
+} // namespace touch_monitor
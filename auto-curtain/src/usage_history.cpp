@@ -0,0 +1,262 @@
+/**
+ * @file usage_history.cpp
+ * @brief カーテンの使われ方の記録（位置と時刻の時系列）と集計
+ *
+ * @details
+ * 1件の記録は，前の記録からの差分を2つのvarintで表す．
+ * - (経過秒数 << 1) | 種類
+ * - 位置の差をジグザグ符号化（0, -1, 1, -2, ... を 0, 1, 2, 3, ...）したもの
+ * バッファの先頭の記録の時刻と位置（base）を別に持ち，先頭を捨てるときはその差分を足して進める．
+ */
+#include "usage_history.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <string.h>
+#include "motion.h"
+#include "wall_clock.h"
+
+namespace usage_history {
+
+const char *PREFERENCES_NAMESPACE = "usage";
+const char *KEY_BUFFER = "buffer";
+const char *KEY_STATE = "state";
+
+// NVSに書き出す間隔 [ms]
+const uint32_t FLUSH_INTERVAL_MS = 60 * 60 * 1000;
+// 止まっているときにこれ以上位置が変わったら手で動かされたとして記録する
+const int32_t MANUAL_THRESHOLD_100THS = 200;
+// varint 1つの最大の長さ（32ビット）
+const size_t MAX_VARINT_SIZE = 5;
+const uint32_t SECONDS_PER_DAY = 24 * 60 * 60;
+
+/**
+ * @brief NVSに保存する状態（バッファ以外）
+ */
+struct State {
+    uint32_t base_time;       ///< バッファの先頭の記録の時刻
+    uint16_t base_position;   ///< バッファの先頭の記録の位置
+    uint32_t last_time;       ///< 最後の記録の時刻
+    uint16_t last_position;   ///< 最後の記録の位置
+    uint16_t length;          ///< バッファの使用量
+    Aggregates aggregates;
+};
+
+static uint8_t buffer[BUFFER_SIZE];
+static State state = {};
+static bool dirty = false;
+static uint32_t last_flush = 0;
+
+// poll() で使う
+static bool was_moving = false;
+static int32_t idle_position = -1;
+
+static size_t put_varint(uint8_t *out, uint32_t value) {
+    size_t size = 0;
+    while (value >= 0x80) {
+        out[size++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = static_cast<uint8_t>(value);
+    return size;
+}
+
+static size_t get_varint(const uint8_t *in, uint32_t *value) {
+    uint32_t result = 0;
+    size_t size = 0;
+    int shift = 0;
+    do {
+        result |= static_cast<uint32_t>(in[size] & 0x7F) << shift;
+        shift += 7;
+    } while (in[size++] & 0x80);
+    *value = result;
+    return size;
+}
+
+static uint32_t zigzag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+/**
+ * @brief offset の記録を1件読み，時刻と位置を進める
+ * @return 記録の長さ [byte]
+ */
+static size_t decode(size_t offset, Event *event) {
+    uint32_t head, position_delta;
+    size_t size = get_varint(buffer + offset, &head);
+    size += get_varint(buffer + offset + size, &position_delta);
+    event->kind = (head & 1) ? Kind::MANUAL : Kind::MOVE;
+    event->time += head >> 1;
+    event->position_100ths = static_cast<uint16_t>(event->position_100ths + unzigzag(position_delta));
+    return size;
+}
+
+/**
+ * @brief 古い記録を捨ててバッファの前に詰め，needed バイトを空ける
+ */
+static void make_room(size_t needed) {
+    size_t offset = 0;
+    Event event = {Kind::MOVE, state.base_time, state.base_position};
+    while (state.length - offset + needed > BUFFER_SIZE && offset < state.length) {
+        offset += decode(offset, &event);
+        state.aggregates.event_count--;
+        state.aggregates.dropped_count++;
+    }
+    if (offset == 0) {
+        return;
+    }
+    // 捨てた最後の記録が新しい base．次の記録はそこからの差分になっている
+    memmove(buffer, buffer + offset, state.length - offset);
+    state.length -= offset;
+    state.base_time = event.time;
+    state.base_position = event.position_100ths;
+    if (state.length > 0) {
+        Event first = event;
+        decode(0, &first);
+        state.aggregates.first_time = first.time;
+    }
+}
+
+/**
+ * @brief 現地時刻の日（1970-01-01からの日数）
+ */
+static uint32_t local_day(uint32_t utc) {
+    int64_t local = static_cast<int64_t>(utc) + wall_clock::utc_offset_minutes() * 60;
+    return static_cast<uint32_t>(local / SECONDS_PER_DAY);
+}
+
+/**
+ * @brief 日ごとの移動回数を今日の日までずらす
+ */
+static void roll_days(uint32_t today) {
+    Aggregates &a = state.aggregates;
+    if (today <= a.today) {
+        return;
+    }
+    uint32_t shift = today - a.today;
+    if (shift >= DAYS) {
+        memset(a.moves_per_day, 0, sizeof(a.moves_per_day));
+    } else {
+        memmove(a.moves_per_day + shift, a.moves_per_day, (DAYS - shift) * sizeof(a.moves_per_day[0]));
+        memset(a.moves_per_day, 0, shift * sizeof(a.moves_per_day[0]));
+    }
+    a.today = today;
+}
+
+static uint8_t bucket_of(uint16_t position_100ths) {
+    uint32_t bucket = static_cast<uint32_t>(position_100ths) * POSITION_BUCKETS / (motion::POSITION_100THS_MAX + 1);
+    return static_cast<uint8_t>(bucket);
+}
+
+/**
+ * @brief 記録とバッファをNVSに書き出す
+ */
+static void flush() {
+    Preferences preferences;
+    preferences.begin(PREFERENCES_NAMESPACE, false);
+    preferences.putBytes(KEY_BUFFER, buffer, state.length);
+    preferences.putBytes(KEY_STATE, &state, sizeof(state));
+    preferences.end();
+    dirty = false;
+}
+
+void begin() {
+    Preferences preferences;
+    preferences.begin(PREFERENCES_NAMESPACE, true);
+    if (preferences.getBytesLength(KEY_STATE) == sizeof(State)) {
+        preferences.getBytes(KEY_STATE, &state, sizeof(state));
+        if (state.length > BUFFER_SIZE || preferences.getBytes(KEY_BUFFER, buffer, state.length) != state.length) {
+            state = {};
+        }
+    }
+    preferences.end();
+    last_flush = millis();
+}
+
+void record(Kind kind, uint16_t position_100ths) {
+    if (!wall_clock::is_set()) {
+        return;
+    }
+    uint32_t now = static_cast<uint32_t>(wall_clock::now_utc());
+    Aggregates &a = state.aggregates;
+
+    if (a.event_count == 0 && state.length == 0) {
+        // 最初の記録．base は記録の直前の時刻と位置にしておく
+        state.base_time = now;
+        state.base_position = position_100ths;
+        state.last_time = now;
+        state.last_position = position_100ths;
+        a.first_time = now;
+    }
+    if (now < state.last_time) {
+        // 時刻が戻された．差分が負にならないように前の時刻にそろえる
+        now = state.last_time;
+    }
+
+    // 集計を更新する（前の記録から今までは前の位置にいた）
+    a.seconds_in_bucket[bucket_of(state.last_position)] += now - state.last_time;
+    roll_days(local_day(now));
+    if (kind == Kind::MOVE) {
+        a.moves_per_day[0]++;
+    }
+
+    uint8_t encoded[2 * MAX_VARINT_SIZE];
+    size_t size = put_varint(encoded, ((now - state.last_time) << 1) | (kind == Kind::MANUAL ? 1 : 0));
+    size += put_varint(encoded + size, zigzag(static_cast<int32_t>(position_100ths) - state.last_position));
+    make_room(size);
+    memcpy(buffer + state.length, encoded, size);
+    state.length += size;
+    a.event_count++;
+
+    state.last_time = now;
+    state.last_position = position_100ths;
+    dirty = true;
+}
+
+void poll() {
+    bool moving = motion::state() == motion::State::MOVING;
+    uint16_t position = motion::position_100ths();
+    if (was_moving && !moving) {
+        record(Kind::MOVE, position);
+        idle_position = position;
+    } else if (!moving) {
+        if (idle_position < 0) {
+            idle_position = position;
+        } else if (abs(static_cast<int32_t>(position) - idle_position) >= MANUAL_THRESHOLD_100THS) {
+            record(Kind::MANUAL, position);
+            idle_position = position;
+        }
+    }
+    was_moving = moving;
+
+    if (dirty && millis() - last_flush >= FLUSH_INTERVAL_MS) {
+        last_flush = millis();
+        flush();
+    }
+}
+
+Aggregates aggregates() {
+    if (wall_clock::is_set()) {
+        roll_days(local_day(static_cast<uint32_t>(wall_clock::now_utc())));
+    }
+    return state.aggregates;
+}
+
+void for_each(void (*visit)(const Event &event, void *context), void *context) {
+    Event event = {Kind::MOVE, state.base_time, state.base_position};
+    size_t offset = 0;
+    while (offset < state.length) {
+        offset += decode(offset, &event);
+        visit(event, context);
+    }
+}
+
+size_t used_bytes() {
+    return state.length;
+}
+
+} // namespace usage_history
@@ -0,0 +1,143 @@
+/**
+ * @file wall_clock.cpp
+ * @brief 時刻（UTC）と現地時刻への変換，時計のずれ（ドリフト）の補正
+ */
+#include "wall_clock.h"
+
+#include <Preferences.h>
+#include <atomic>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+namespace wall_clock {
+
+const char *PREFERENCES_NAMESPACE = "clock";
+const char *KEY_UTC_OFFSET = "utc_offset";
+const char *KEY_DRIFT = "drift_ppb";
+
+// 1970-01-01 は木曜日なので，月曜始まりの週に直すには3日ずらす
+const uint32_t EPOCH_WEEKDAY_OFFSET_SECONDS = 3 * 24 * 60 * 60;
+
+// ずれを推定するのに使う最短の同期間隔 [us]．短いと同期の誤差が目立つ
+const int64_t MIN_DRIFT_SPAN_US = 10LL * 60 * 1000000;
+// 推定値の更新の重み（1/2^n）
+const int DRIFT_GAIN_SHIFT = 1;
+// 水晶のずれとしてありえる範囲 [ppb]．これを超えたら同期の失敗とみなす
+const int32_t MAX_DRIFT_PPB = 200000;
+// NVSに書き直すのは推定値がこれ以上変わったときだけ [ppb]
+const int32_t DRIFT_SAVE_THRESHOLD_PPB = 1000;
+
+static portMUX_TYPE clock_mux = portMUX_INITIALIZER_UNLOCKED;
+// 基準の組．set_utc() と synchronize() のときに取り直す
+static uint64_t base_utc_us = 0;
+static int64_t base_timer_us = 0;
+static bool clock_set = false;
+static bool base_synchronized = false; // 基準が時刻同期で得たものか
+static int32_t current_drift_ppb = 0;
+static int32_t saved_drift_ppb = 0;
+static std::atomic<int16_t> offset_minutes_setting(0);
+
+/**
+ * @brief 基準からの経過時間にずれの補正を掛けてUTCを求める（clock_mux を取って呼ぶ）
+ */
+static uint64_t utc_us_at(int64_t timer_us) {
+    int64_t elapsed = timer_us - base_timer_us;
+    return base_utc_us + elapsed + elapsed * current_drift_ppb / 1000000000LL;
+}
+
+void begin() {
+    Preferences preferences;
+    preferences.begin(PREFERENCES_NAMESPACE, true);
+    offset_minutes_setting.store(preferences.getShort(KEY_UTC_OFFSET, 0));
+    current_drift_ppb = preferences.getInt(KEY_DRIFT, 0);
+    saved_drift_ppb = current_drift_ppb;
+    preferences.end();
+}
+
+void set_utc(uint64_t unix_seconds) {
+    int64_t timer_us = esp_timer_get_time();
+    portENTER_CRITICAL(&clock_mux);
+    base_utc_us = unix_seconds * 1000000ULL;
+    base_timer_us = timer_us;
+    clock_set = true;
+    base_synchronized = false;
+    portEXIT_CRITICAL(&clock_mux);
+}
+
+int64_t synchronize(uint64_t unix_us, int64_t timer_us) {
+    portENTER_CRITICAL(&clock_mux);
+    int64_t error_us = 0;
+    if (clock_set) {
+        error_us = static_cast<int64_t>(unix_us - utc_us_at(timer_us));
+    }
+    int64_t span_us = timer_us - base_timer_us;
+    // 誤差が大きすぎるときは，ずれではなく時刻そのものが変わったとみなす
+    int64_t max_error_us = span_us / (1000000000LL / MAX_DRIFT_PPB);
+    if (base_synchronized && span_us >= MIN_DRIFT_SPAN_US && error_us < max_error_us && error_us > -max_error_us) {
+        // 残っている誤差を経過時間で割ったものが，補正しきれていないずれ
+        // （error_us [us] / span [s] * 1000 = ppb．掛け算があふれないように秒で割る）
+        int64_t residual_ppb = error_us * 1000 / (span_us / 1000000);
+        int64_t drift = current_drift_ppb + residual_ppb / (1 << DRIFT_GAIN_SHIFT);
+        if (drift > -MAX_DRIFT_PPB && drift < MAX_DRIFT_PPB) {
+            current_drift_ppb = static_cast<int32_t>(drift);
+        }
+    }
+    base_utc_us = unix_us;
+    base_timer_us = timer_us;
+    clock_set = true;
+    base_synchronized = true;
+    int32_t drift = current_drift_ppb;
+    portEXIT_CRITICAL(&clock_mux);
+
+    if (drift - saved_drift_ppb >= DRIFT_SAVE_THRESHOLD_PPB || saved_drift_ppb - drift >= DRIFT_SAVE_THRESHOLD_PPB) {
+        saved_drift_ppb = drift;
+        Preferences preferences;
+        preferences.begin(PREFERENCES_NAMESPACE, false);
+        preferences.putInt(KEY_DRIFT, drift);
+        preferences.end();
+    }
+    return error_us;
+}
+
+void set_utc_offset_minutes(int16_t offset_minutes) {
+    offset_minutes_setting.store(offset_minutes);
+    Preferences preferences;
+    preferences.begin(PREFERENCES_NAMESPACE, false);
+    preferences.putShort(KEY_UTC_OFFSET, offset_minutes);
+    preferences.end();
+}
+
+bool is_set() {
+    portENTER_CRITICAL(&clock_mux);
+    bool result = clock_set;
+    portEXIT_CRITICAL(&clock_mux);
+    return result;
+}
+
+uint64_t now_utc() {
+    int64_t timer_us = esp_timer_get_time();
+    portENTER_CRITICAL(&clock_mux);
+    bool set = clock_set;
+    uint64_t utc_us = utc_us_at(timer_us);
+    portEXIT_CRITICAL(&clock_mux);
+    return set ? utc_us / 1000000ULL : 0;
+}
+
+uint32_t local_second_of_week() {
+    int64_t local = static_cast<int64_t>(now_utc()) + offset_minutes_setting.load() * 60;
+    int64_t second = (local + EPOCH_WEEKDAY_OFFSET_SECONDS) % SECONDS_PER_WEEK;
+    return static_cast<uint32_t>(second < 0 ? second + SECONDS_PER_WEEK : second);
+}
+
+int16_t utc_offset_minutes() {
+    return offset_minutes_setting.load();
+}
+
+int32_t drift_ppb() {
+    portENTER_CRITICAL(&clock_mux);
+    int32_t drift = current_drift_ppb;
+    portEXIT_CRITICAL(&clock_mux);
+    return drift;
+}
+
+} // namespace wall_clock
@@ -0,0 +1,245 @@
+/**
+ * @file wifi_fast_connect.cpp
+ * @brief 前回つながったAP（BSSID，チャネル）とIP設定を覚えておき，起動時にスキャンとDHCPを省いて再接続する
+ */
+#include "wifi_fast_connect.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <atomic>
+#include <esp_event.h>
+#include <esp_netif.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <string.h>
+#include "tlog.h"
+
+namespace wifi_fast_connect {
+
+// 保存した設定でこの時間内にIPを得られなければ通常の接続に戻す [us]
+const uint64_t FAST_CONNECT_TIMEOUT_US = 3000000;
+
+const char *PREFERENCES_NAMESPACE = "wifi_cache";
+const char *KEY_CACHE = "cache";
+const char *KEY_LAST_ONLINE = "online_ms";
+
+/**
+ * @brief NVSに保存する接続情報
+ */
+struct Cache {
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t valid;
+    esp_netif_ip_info_t ip_info;
+    esp_ip4_addr_t dns;
+};
+
+static Preferences preferences;
+static Cache cache = {};
+static esp_timer_handle_t fallback_timer = nullptr;
+static BootStats stats = {};
+// 保存したBSSIDとチャネルに固定してつないでいる途中
+static bool ap_locked = false;
+// DHCPを止めて保存したIPを使っている（起動時の接続だけ）
+static std::atomic<bool> static_ip(false);
+// 保存したIPで接続できた．resume_dhcp() でDHCPを動かし直すのを待っている
+static std::atomic<bool> dhcp_deferred(false);
+
+/**
+ * @brief STAのネットワークインターフェース
+ */
+static esp_netif_t *sta_netif() {
+    return esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+}
+
+/**
+ * @brief 保存した設定を捨てて，通常のスキャンとDHCPに戻す
+ */
+static void fall_back() {
+    if (!ap_locked) {
+        return;
+    }
+    ap_locked = false;
+    esp_timer_stop(fallback_timer);
+
+    wifi_config_t config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &config) == ESP_OK) {
+        config.sta.bssid_set = false;
+        config.sta.channel = 0;
+        esp_wifi_set_config(WIFI_IF_STA, &config);
+    }
+    if (static_ip.exchange(false)) {
+        dhcp_deferred = false;
+        stats.fell_back = true;
+        esp_netif_dhcpc_start(sta_netif());
+    }
+
+    cache.valid = 0;
+    preferences.remove(KEY_CACHE);
+}
+
+/**
+ * @brief 保存した設定で時間内にIPを得られなかった．切断すればMatterのスタックが通常の手順で接続し直す
+ */
+static void on_fallback_timeout(void *arg) {
+    if (ap_locked) {
+        fall_back();
+        esp_wifi_disconnect();
+    }
+}
+
+/**
+ * @brief 保存したBSSIDとチャネルに固定する（スキャンを省く）．時間内にIPを得られなければ元に戻す
+ * @return 固定したらtrue
+ */
+static bool lock_ap() {
+    if (!cache.valid) {
+        return false;
+    }
+    wifi_config_t config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &config) != ESP_OK || config.sta.ssid[0] == '\0') {
+        // まだコミッショニングされていない
+        return false;
+    }
+    config.sta.bssid_set = true;
+    memcpy(config.sta.bssid, cache.bssid, sizeof(cache.bssid));
+    config.sta.channel = cache.channel;
+    config.sta.scan_method = WIFI_FAST_SCAN;
+    esp_wifi_set_config(WIFI_IF_STA, &config);
+
+    ap_locked = true;
+    esp_timer_start_once(fallback_timer, FAST_CONNECT_TIMEOUT_US);
+    return true;
+}
+
+/**
+ * @brief Wi-Fiが始まった（まだ接続していない）．保存した設定を使えるようにしておく
+ */
+static void apply_cache() {
+    if (!lock_ap()) {
+        return;
+    }
+
+    // DHCPを止めて前回のIPを使う．接続時にすぐIPが割り当てられる
+    esp_netif_t *netif = sta_netif();
+    esp_netif_dhcpc_stop(netif);
+    esp_netif_set_ip_info(netif, &cache.ip_info);
+    esp_netif_dns_info_t dns_info = {};
+    dns_info.ip.type = ESP_IPADDR_TYPE_V4;
+    dns_info.ip.u_addr.ip4 = cache.dns;
+    esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns_info);
+
+    static_ip = true;
+    stats.fast_path = true;
+}
+
+/**
+ * @brief 切断された．固定した設定でつなげなかったのなら通常の接続に戻し，
+ * 動作中にAPから切れたのなら，つなぎ直す前に保存したAPに固定しておく
+ */
+static void on_disconnected() {
+    if (ap_locked) {
+        fall_back();
+    } else if (stats.online_ms != 0) {
+        lock_ap();
+    }
+}
+
+/**
+ * @brief IPを得た．接続情報が変わっていれば保存する
+ */
+static void update_cache() {
+    ap_locked = false;
+    esp_timer_stop(fallback_timer);
+    if (static_ip) {
+        // 保存したIPで通信できるようになった．ここでDHCPを動かし直すとIPv4の設定がいったん消え，
+        // 起動直後のコミッショニングやサブスクリプションの張り直しの最中に取り直しが走る．
+        // そこで resume_dhcp() が呼ばれるまで保存したIPのまま使い続ける
+        dhcp_deferred = true;
+        return;
+    }
+
+    wifi_ap_record_t ap;
+    esp_netif_ip_info_t ip_info;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK || esp_netif_get_ip_info(sta_netif(), &ip_info) != ESP_OK) {
+        return;
+    }
+    esp_netif_dns_info_t dns_info = {};
+    esp_netif_get_dns_info(sta_netif(), ESP_NETIF_DNS_MAIN, &dns_info);
+
+    Cache latest = {};
+    memcpy(latest.bssid, ap.bssid, sizeof(latest.bssid));
+    latest.channel = ap.primary;
+    latest.valid = 1;
+    latest.ip_info = ip_info;
+    latest.dns = dns_info.ip.u_addr.ip4;
+
+    // フラッシュの書き込みを減らすため，変わったときだけ保存する
+    if (memcmp(&latest, &cache, sizeof(Cache)) != 0) {
+        cache = latest;
+        preferences.putBytes(KEY_CACHE, &cache, sizeof(Cache));
+    }
+}
+
+/**
+ * @brief Wi-FiとIPのイベントハンドラ．Matterのスタックより先に登録しておく
+ */
+static void on_network_event(void *arg, esp_event_base_t base, int32_t id, void *data) {
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_START) {
+        apply_cache();
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
+        on_disconnected();
+    } else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+        update_cache();
+    }
+}
+
+void begin() {
+    preferences.begin(PREFERENCES_NAMESPACE, false);
+    if (preferences.getBytes(KEY_CACHE, &cache, sizeof(Cache)) != sizeof(Cache)) {
+        cache.valid = 0;
+    }
+    stats.last_online_ms = preferences.getUInt(KEY_LAST_ONLINE, 0);
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = on_fallback_timeout;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "wifi_fast";
+    esp_timer_create(&timer_args, &fallback_timer);
+
+    // Matterのスタックも同じデフォルトループを使う（作成済みでもエラーにしない）
+    esp_event_loop_create_default();
+    esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_START, on_network_event, nullptr);
+    esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, on_network_event, nullptr);
+    esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, on_network_event, nullptr);
+}
+
+void notify_online() {
+    if (stats.online_ms != 0) {
+        return;
+    }
+    stats.online_ms = millis();
+    preferences.putUInt(KEY_LAST_ONLINE, stats.online_ms);
+    if (stats.fast_path && !stats.fell_back) {
+        TLOG("Online after [ms]: %lu (cached AP/IP)", static_cast<unsigned long>(stats.online_ms));
+    } else {
+        TLOG("Online after [ms]: %lu (full scan/DHCP)", static_cast<unsigned long>(stats.online_ms));
+    }
+}
+
+void resume_dhcp() {
+    if (!dhcp_deferred.exchange(false)) {
+        return;
+    }
+    if (static_ip.exchange(false)) {
+        // リースを取り直す．取り直したときにもう一度 update_cache() に来て，ゲートウェイやDNSの変更を保存する
+        TLOG("Resuming DHCP after cached IP");
+        esp_netif_dhcpc_start(sta_netif());
+    }
+}
+
+BootStats boot_stats() {
+    return stats;
+}
+
+} // namespace wifi_fast_connect
@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+# ファームウェアの部品ごとのベンチマーク（src/bench.cpp）をLinuxでビルドして走らせる．
+#
+# 実機ではシリアルコンソールの `bench [名前の一部]` で同じベンチマークが走り，同じ形式で表示される．
+# ホストの値は実機の絶対値の代わりにはならない．変更の前後の比較に使うこと．
+# synth_ で始まるものは処理の一部だけを取り出した合成のベンチマークで，本物の経路の下限の目安．
+# 実機だけのベンチマーク（motion_snapshot，queue_push_pop，timer_insert，attribute_get）はホストでは走らない．
+#
+# 使い方:
+#   ./tools/bench_host.sh [名前の一部]
+#
+# 環境変数:
+#   CXX       コンパイラ（既定: g++）
+#   CXXFLAGS  最適化などのオプション（既定: -O2．実機に近づけるなら -Os）
+
+set -eu
+
+cd "$(dirname "$0")/.."
+OUT_DIR=.pio/bench_host
+mkdir -p "$OUT_DIR"
+
+${CXX:-g++} -std=gnu++17 ${CXXFLAGS:--O2} -Wall -Wextra -Wno-unused-parameter \
+    -Itools/bench_host -Iinclude \
+    tools/bench_host/main.cpp src/bench.cpp src/motion_plan.cpp src/tlog.cpp \
+    -o "$OUT_DIR/bench"
+
+"$OUT_DIR/bench" "$@"
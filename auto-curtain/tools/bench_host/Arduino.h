@@ -0,0 +1,12 @@
+/**
+ * @file Arduino.h
+ * @brief ホストのベンチマーク用．ベンチマークが使うソースが必要とする分だけを用意する
+ */
+#pragma once
+
+#include <algorithm>
+#include <stdint.h>
+#include <stdlib.h>
+
+using std::max;
+using std::min;
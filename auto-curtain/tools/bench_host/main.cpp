@@ -0,0 +1,23 @@
+/**
+ * @file main.cpp
+ * @brief ホストでベンチマーク（src/bench.cpp）を走らせる
+ */
+#include <stdio.h>
+#include "bench.h"
+#include "diag_transport.h"
+
+// ホストではログを送らない（tlog.cpp の送り先）
+namespace diag_transport {
+bool write(const void *data, size_t length) {
+    return true;
+}
+} // namespace diag_transport
+
+int main(int argc, char **argv) {
+    bench::run(argc > 1 ? argv[1] : nullptr, [](const bench::Result &result) {
+        char text[96];
+        bench::format(result, text, sizeof(text));
+        puts(text);
+    });
+    return 0;
+}
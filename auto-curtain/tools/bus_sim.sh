@@ -0,0 +1,21 @@
+#!/usr/bin/env bash
+# ブリッジモードのバスのマスター（src/motor_bus.cpp）を，模擬のRS-485のバスでホストで動かす．
+#
+# モーターの数を 1, 4, 8, 16, 32 と変えて，1周の時間，回線の使用率，状態の古さ，
+# 指令の遅れを表示する．応答の一部はわざと壊すので，再送と到達できないモーターの扱いも確かめられる．
+# どれかの台数で動き終わらなければ終了コードが1になる．
+#
+# 使い方:
+#   ./tools/bus_sim.sh [ボーレート（既定: 115200）] [壊す応答の割合 /1000（既定: 10）]
+
+set -eu
+
+cd "$(dirname "$0")/.."
+OUT_DIR=.pio/bus_sim
+mkdir -p "$OUT_DIR"
+
+${CXX:-g++} -std=gnu++17 -O2 -Wall -Wextra -Iinclude \
+    tools/bus_sim/main.cpp src/motor_bus.cpp src/modbus_rtu.cpp \
+    -o "$OUT_DIR/bus_sim"
+
+"$OUT_DIR/bus_sim" "$@"
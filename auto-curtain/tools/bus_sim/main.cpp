@@ -0,0 +1,246 @@
+/**
+ * @file main.cpp
+ * @brief ブリッジモードのバスのマスター（src/motor_bus.cpp）を模擬のRS-485のバスで動かす
+ *
+ * @details
+ * 時計は仮想で，送受信にかかる時間（1文字11ビット），コントローラーの応答の遅れ，
+ * UARTの受信タイムアウト割り込み（2文字）の分だけ進める．
+ * コントローラーは位置を目標へ一定の速さで動かし，応答の一部（既定1%）をわざと壊す．
+ * モーターの数ごとに次を測り，1周の時間がモーターの数に比例することと，指令が届いて動き終わることを確かめる．
+ * - 1周の時間，回線の使用率，状態の古さの最大
+ * - 全台に同じ目標（ブロードキャスト1回）と，1台ずつ違う目標を出したときの指令の遅れ
+ */
+#include <initializer_list>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "modbus_rtu.h"
+#include "motor_bus.h"
+
+// 応答が最後の文字から何文字の間途切れたら受信を終えるか（rs485_port の受信タイムアウト）
+const uint32_t RX_TIMEOUT_CHARACTERS = 2;
+// コントローラーが要求を受けてから応答を送り始めるまで [us]
+const uint32_t RESPONSE_DELAY_US = 500;
+// コントローラーの速さ [0.01%/ms]（全行程 20s）
+const uint32_t SPEED_100THS_PER_MS = 1;
+// 動き終わるまで待つ上限 [us]
+const uint32_t SETTLE_LIMIT_US = 30000000;
+
+/**
+ * @brief 模擬のモーターコントローラー
+ */
+struct Controller {
+    bool online;
+    uint16_t position;
+    uint16_t target;
+    uint32_t updated_us;
+};
+
+static uint32_t clock_us = 0;
+static uint32_t baud = 115200;
+static uint8_t first_address = 1;
+static uint8_t controller_count = 0;
+static Controller controllers[motor_bus::MAX_MOTORS];
+static uint8_t response[modbus_rtu::MAX_FRAME_SIZE];
+static size_t response_length = 0;
+static unsigned corrupt_per_mille = 10;
+
+static void advance(Controller &controller) {
+    uint32_t elapsed_ms = (clock_us - controller.updated_us) / 1000;
+    if (elapsed_ms == 0) {
+        return;
+    }
+    controller.updated_us += elapsed_ms * 1000;
+    uint32_t step = elapsed_ms * SPEED_100THS_PER_MS;
+    if (controller.position < controller.target) {
+        controller.position = static_cast<uint16_t>(controller.position + step < controller.target ? controller.position + step : controller.target);
+    } else if (controller.position > controller.target) {
+        controller.position = static_cast<uint16_t>(controller.position > controller.target + step ? controller.position - step : controller.target);
+    }
+}
+
+static void write_register(Controller &controller, uint16_t reg, uint16_t value) {
+    advance(controller);
+    if (reg == motor_bus::REG_TARGET) {
+        controller.target = value;
+    } else if (reg == motor_bus::REG_COMMAND && value == motor_bus::COMMAND_STOP) {
+        controller.target = controller.position;
+    }
+}
+
+/**
+ * @brief 応答を組み立てる（CRCは modbus_rtu で付け直す）
+ */
+static void respond(const uint8_t *request, Controller &controller) {
+    uint16_t first = static_cast<uint16_t>((request[2] << 8) | request[3]);
+    uint16_t value = static_cast<uint16_t>((request[4] << 8) | request[5]);
+    response[0] = request[0];
+    response[1] = request[1];
+    size_t length;
+    if (request[1] == modbus_rtu::READ_HOLDING_REGISTERS && first == motor_bus::REG_POSITION && value == 2) {
+        advance(controller);
+        uint16_t status = 0;
+        if (controller.position != controller.target) {
+            status = motor_bus::STATUS_MOVING | (controller.target > controller.position ? motor_bus::STATUS_CLOSING : 0);
+        }
+        response[2] = 4;
+        response[3] = static_cast<uint8_t>(controller.position >> 8);
+        response[4] = static_cast<uint8_t>(controller.position);
+        response[5] = static_cast<uint8_t>(status >> 8);
+        response[6] = static_cast<uint8_t>(status);
+        length = 7;
+    } else if (request[1] == modbus_rtu::WRITE_SINGLE_REGISTER) {
+        write_register(controller, first, value);
+        memcpy(response, request, 6);
+        length = 6;
+    } else {
+        // Illegal Data Address
+        response[1] = static_cast<uint8_t>(request[1] | modbus_rtu::EXCEPTION_FLAG);
+        response[2] = 0x02;
+        length = 3;
+    }
+    uint16_t crc = modbus_rtu::crc16(response, length);
+    response[length] = static_cast<uint8_t>(crc);
+    response[length + 1] = static_cast<uint8_t>(crc >> 8);
+    response_length = length + 2;
+    if (static_cast<unsigned>(rand() % 1000) < corrupt_per_mille) {
+        response[rand() % response_length] ^= 0x10;
+    }
+}
+
+static void send(const uint8_t *frame, size_t length) {
+    clock_us += modbus_rtu::frame_time_us(length, baud);
+    response_length = 0;
+    if (frame[0] == modbus_rtu::BROADCAST_ADDRESS) {
+        uint16_t reg = static_cast<uint16_t>((frame[2] << 8) | frame[3]);
+        uint16_t value = static_cast<uint16_t>((frame[4] << 8) | frame[5]);
+        for (uint8_t i = 0; i < controller_count; i++) {
+            if (controllers[i].online) {
+                write_register(controllers[i], reg, value);
+            }
+        }
+        return;
+    }
+    uint8_t index = static_cast<uint8_t>(frame[0] - first_address);
+    if (index < controller_count && controllers[index].online) {
+        respond(frame, controllers[index]);
+    }
+}
+
+static size_t receive(uint8_t *frame, size_t capacity, size_t expected, uint32_t timeout_us) {
+    if (response_length == 0) {
+        clock_us += timeout_us;
+        return 0;
+    }
+    clock_us += RESPONSE_DELAY_US + modbus_rtu::frame_time_us(response_length, baud);
+    // 期待した長さでなければ受信タイムアウト割り込みまで待たされる
+    if (response_length != expected) {
+        clock_us += modbus_rtu::frame_time_us(RX_TIMEOUT_CHARACTERS, baud);
+    }
+    size_t length = response_length < capacity ? response_length : capacity;
+    memcpy(frame, response, length);
+    response_length = 0;
+    return length;
+}
+
+static uint32_t now_us() {
+    return clock_us;
+}
+
+static void wait_until_us(uint32_t time_us) {
+    if (static_cast<int32_t>(time_us - clock_us) > 0) {
+        clock_us = time_us;
+    }
+}
+
+static void run_for(uint32_t duration_us) {
+    uint32_t end = clock_us + duration_us;
+    while (static_cast<int32_t>(end - clock_us) > 0) {
+        motor_bus::step();
+    }
+}
+
+/**
+ * @brief バスから見た位置が全台 targets にそろうまで回す
+ * @return かかった時間 [us]．そろわなければ0
+ */
+static uint32_t run_until_settled(const uint16_t *targets) {
+    uint32_t start = clock_us;
+    while (clock_us - start < SETTLE_LIMIT_US) {
+        motor_bus::step();
+        bool settled = true;
+        for (uint8_t i = 0; i < controller_count && settled; i++) {
+            motor_bus::MotorState state = motor_bus::state(i);
+            settled = !controllers[i].online ||
+                      (state.position_100ths == targets[i] && (state.status & motor_bus::STATUS_MOVING) == 0);
+        }
+        if (settled) {
+            return clock_us - start;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief モーター count 台で測る
+ * @return 動き終わらなかった，または状態が合わなかったらfalse
+ */
+static bool scenario(uint8_t count, uint8_t offline) {
+    controller_count = count;
+    clock_us = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        controllers[i] = {i >= offline, 5000, 5000, 0};
+    }
+    motor_bus::begin({count, first_address, baud, 10000}, {send, receive, now_us, wait_until_us});
+    run_for(2000000);
+    motor_bus::Stats idle = motor_bus::stats();
+
+    // 全台に同じ目標（グループの指令）
+    uint16_t targets[motor_bus::MAX_MOTORS] = {};
+    for (uint8_t i = 0; i < count; i++) {
+        targets[i] = 10000;
+        motor_bus::set_target(i, targets[i]);
+    }
+    uint32_t group_settle_us = run_until_settled(targets);
+    uint32_t group_latency_us = motor_bus::stats().last_command_latency_us;
+
+    // 1台ずつ違う目標
+    for (uint8_t i = 0; i < count; i++) {
+        targets[i] = static_cast<uint16_t>(i * 10000 / count);
+        motor_bus::set_target(i, targets[i]);
+    }
+    uint32_t individual_settle_us = run_until_settled(targets);
+    motor_bus::Stats after = motor_bus::stats();
+
+    bool reachable_ok = true;
+    for (uint8_t i = 0; i < count; i++) {
+        reachable_ok = reachable_ok && motor_bus::state(i).reachable == controllers[i].online;
+    }
+    bool ok = group_settle_us != 0 && individual_settle_us != 0 && reachable_ok;
+    printf("%5u %7u %9.1f %6u %9.1f %12.2f %12.2f %7lu %6lu %s\n", count, offline, idle.cycle_us / 1000.0,
+           idle.utilisation_percent, idle.max_age_us / 1000.0, group_latency_us / 1000.0,
+           after.max_command_latency_us / 1000.0, static_cast<unsigned long>(after.errors),
+           static_cast<unsigned long>(after.timeouts), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        baud = static_cast<uint32_t>(strtoul(argv[1], nullptr, 10));
+    }
+    if (argc > 2) {
+        corrupt_per_mille = static_cast<unsigned>(strtoul(argv[2], nullptr, 10));
+    }
+    srand(1);
+    printf("baud %lu, response delay %u us, corrupted responses %u/1000\n", static_cast<unsigned long>(baud),
+           RESPONSE_DELAY_US, corrupt_per_mille);
+    printf("%5s %7s %9s %6s %9s %12s %12s %7s %6s\n", "N", "offline", "cycle[ms]", "util%", "age[ms]",
+           "group[ms]", "max cmd[ms]", "errors", "t/o");
+    bool ok = true;
+    for (uint8_t count : {1, 4, 8, 16, 32}) {
+        ok = scenario(count, 0) && ok;
+    }
+    // つながっていないモーターは1周ごとに応答のタイムアウトだけ時間を使う
+    ok = scenario(8, 1) && ok;
+    return ok ? 0 : 1;
+}
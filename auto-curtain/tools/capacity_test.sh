@@ -0,0 +1,94 @@
+#!/usr/bin/env bash
+# Matterコントローラー（ファブリック）とサブスクリプションの同時接続数の上限を調べる．
+#
+# Linuxでビルドした chip-tool を使い，ファブリックを1つずつ増やしながら
+# それぞれのファブリックから SUBS_PER_FABRIC 個のサブスクリプションを張る．
+# 失敗したところで止まり，それまでに張れた数を表示する．
+# 計測中はデバイスのシリアルコンソールで `mem` と `subs` を叩いてヒープの残りを記録すること．
+#
+# 使い方:
+#   ./capacity_test.sh <セットアップPIN> <discriminator> [最大ファブリック数] [ファブリックあたりのサブスクリプション数]
+#
+# 前提:
+#   - chip-tool に PATH が通っていること
+#   - デバイスが未コミッショニングでBLEで見えていること（1つ目のファブリックはBLE-WiFiでペアリングする）
+#   - WIFI_SSID と WIFI_PASSWORD を環境変数で渡すこと
+
+set -u
+
+PIN=${1:?setup pin code}
+DISCRIMINATOR=${2:?discriminator}
+MAX_FABRICS=${3:-5}
+SUBS_PER_FABRIC=${4:-3}
+NODE_ID=${NODE_ID:-0x1234}
+ENDPOINT=${ENDPOINT:-1}
+# chip-tool が持てるコミッショナーは alpha, beta, gamma と 4 以降の番号
+COMMISSIONERS=(alpha beta gamma 4 5 6 7 8 9 10 11 12 13 14 15 16)
+# サブスクリプションごとに別の属性を選ぶ（同じ属性を重ねてもデバイス側のReadHandlerは別に確保される）
+ATTRIBUTES=(current-position-lift-percent100ths target-position-lift-percent100ths operational-status)
+
+fabrics=0
+subscriptions=0
+pids=()
+
+cleanup() {
+    for pid in "${pids[@]}"; do
+        kill "$pid" 2>/dev/null
+    done
+}
+trap cleanup EXIT
+
+pair() {
+    local commissioner=$1
+    if [ "$fabrics" -eq 0 ]; then
+        chip-tool pairing ble-wifi "$NODE_ID" "$WIFI_SSID" "$WIFI_PASSWORD" "$PIN" "$DISCRIMINATOR" \
+            --commissioner-name "$commissioner"
+    else
+        # 1つ目のファブリックからコミッショニング窓を開いて，次のファブリックを追加する
+        local code
+        code=$(chip-tool pairing open-commissioning-window "$NODE_ID" 1 300 1000 "$DISCRIMINATOR" \
+            --commissioner-name alpha | sed -n 's/.*Manual pairing code: \[\([0-9]*\)\].*/\1/p' | tail -n 1)
+        [ -n "$code" ] || return 1
+        chip-tool pairing code "$NODE_ID" "$code" --commissioner-name "$commissioner"
+    fi
+}
+
+subscribe() {
+    local commissioner=$1
+    local attribute=$2
+    # サブスクリプションを張ったまま残すため，インタラクティブモードで常駐させる
+    local log
+    log=$(mktemp)
+    (echo "windowcovering subscribe $attribute 1 60 $NODE_ID $ENDPOINT --keepSubscriptions true"; sleep infinity) |
+        chip-tool interactive start --commissioner-name "$commissioner" >"$log" 2>&1 &
+    pids+=($!)
+    # 最初のレポートが届くまで待つ
+    for _ in $(seq 1 30); do
+        if grep -q "Subscription established" "$log"; then
+            return 0
+        fi
+        sleep 1
+    done
+    return 1
+}
+
+for ((f = 0; f < MAX_FABRICS; f++)); do
+    commissioner=${COMMISSIONERS[$f]}
+    if ! pair "$commissioner"; then
+        echo "pairing failed on fabric $((f + 1))"
+        break
+    fi
+    fabrics=$((fabrics + 1))
+
+    for ((s = 0; s < SUBS_PER_FABRIC; s++)); do
+        attribute=${ATTRIBUTES[$((s % ${#ATTRIBUTES[@]}))]}
+        if ! subscribe "$commissioner" "$attribute"; then
+            echo "subscription failed: fabric $fabrics, subscription $((s + 1))"
+            break 2
+        fi
+        subscriptions=$((subscriptions + 1))
+    done
+done
+
+echo "fabrics: $fabrics"
+echo "subscriptions: $subscriptions"
@@ -0,0 +1,182 @@
+"""デバイスモデル（device_model.json）から，ビルドに入れるクラスターのサーバー実装を決める．
+
+esp32-arduino-matter はすべてのクラスターのサーバー実装を持っていて，
+MATTER_PLUGINS_INIT がそれぞれの初期化関数を呼ぶので，使わないクラスターのコードもイメージに残る．
+ここではモデルに書いたクラスターの実装（src/app/clusters/<server>/）だけを残し，残りをビルドから外す．
+外したクラスターについては，ライブラリの生成コードが参照する関数を
+何もしない弱いシンボルとして生成する（コマンドは失敗として返す）．
+- プラグインの初期化: Matter<Cluster>PluginServerInitCallback（PluginApplicationCallbacks.h）
+- コマンド: emberAf<Cluster>Cluster<Command>Callback（callback.h）
+外したソースで定義されていた関数だけが対象なので，ライブラリがビルド済みで持っている実装を隠すことはない．
+
+platformio.ini の custom_device_model にモデルのファイルを書くと有効になる（書かなければ何もしない）．
+有効にしたのにライブラリのクラスターのソースが見つからなければ，ビルドを止める．
+モデルは "extends" で別のモデルにエンドポイントを足したものにできる（device_model_bridge.json）．
+単体で実行すると，モデルと外すクラスターの一覧を表示する:
+    python tools/device_model.py [プロジェクトのディレクトリ] [モデルのファイル]
+"""
+import json
+import os
+import re
+import sys
+
+LIBRARY_SOURCE = os.path.join("lib", "esp32-arduino-matter", "src")
+CLUSTERS_DIRECTORY = os.path.join("app", "clusters")
+PLUGIN_CALLBACKS = "PluginApplicationCallbacks.h"
+COMMAND_CALLBACKS = "callback.h"
+STUB_NAME = "device_model_stubs.cpp"
+
+PLUGIN_INIT = re.compile(r"\bvoid\s+Matter(\w+)PluginServerInitCallback\s*\(\s*(?:void)?\s*\)\s*;")
+COMMAND_CALLBACK = re.compile(r"\bbool\s+(emberAf(\w+?)Cluster(\w+)Callback)\s*\(([^;{]*?)\)\s*;", re.S)
+DEFINITION = re.compile(r"\b(Matter\w+PluginServerInitCallback|emberAf\w+Callback)\s*\([^;{}]*?\)\s*\{", re.S)
+
+
+def load_model(path):
+    with open(path, encoding="utf-8") as model_file:
+        model = json.load(model_file)
+    # "extends" に書いたモデルのエンドポイントの後ろに，このモデルのエンドポイントを足す
+    if "extends" in model:
+        base, _ = load_model(os.path.join(os.path.dirname(path), model["extends"]))
+        model["endpoints"] = base["endpoints"] + model["endpoints"]
+        model["client_clusters"] = base.get("client_clusters", []) + model.get("client_clusters", [])
+    clusters = []
+    ids = set()
+    for endpoint in model["endpoints"]:
+        if endpoint["id"] in ids:
+            raise SystemExit("device_model: endpoint %d is declared twice" % endpoint["id"])
+        ids.add(endpoint["id"])
+        names = set()
+        for cluster in endpoint["clusters"]:
+            if cluster["name"] in names:
+                raise SystemExit("device_model: %s is declared twice on endpoint %d" % (cluster["name"], endpoint["id"]))
+            names.add(cluster["name"])
+            clusters.append(cluster)
+    return model, clusters
+
+
+def find_file(root, name):
+    for dirpath, _, filenames in os.walk(root):
+        if name in filenames:
+            return os.path.join(dirpath, name)
+    return None
+
+
+def read_text(path):
+    if path is None:
+        return ""
+    with open(path, encoding="utf-8", errors="replace") as source:
+        return source.read()
+
+
+class Pruning:
+    """モデルから外すクラスターを求める"""
+
+    def __init__(self, project_dir, model_path):
+        self.model, clusters = load_model(os.path.join(project_dir, model_path))
+        self.library = os.path.join(project_dir, LIBRARY_SOURCE)
+        self.kept_servers = {cluster["server"] for cluster in clusters if cluster.get("server")}
+        self.commands = {cluster["name"]: cluster.get("commands", []) for cluster in clusters}
+        clusters_root = os.path.join(self.library, CLUSTERS_DIRECTORY)
+        self.clusters_root = clusters_root
+        available = set()
+        if os.path.isdir(clusters_root):
+            available = {name for name in os.listdir(clusters_root) if os.path.isdir(os.path.join(clusters_root, name))}
+        self.pruned_servers = available - self.kept_servers
+        if available:
+            for server in sorted(self.kept_servers - available):
+                print("device_model: warning: %s is not in the library sources" % server)
+
+    def is_pruned(self, path):
+        parts = os.path.normpath(path).split(os.sep)
+        for i in range(len(parts) - 2):
+            if parts[i] == "app" and parts[i + 1] == "clusters":
+                return parts[i + 2] in self.pruned_servers
+        return False
+
+    def check_commands(self, callbacks):
+        declared = {}
+        for _, cluster, command, _ in COMMAND_CALLBACK.findall(callbacks):
+            declared.setdefault(cluster, set()).add(command)
+        for name, commands in sorted(self.commands.items()):
+            for command in commands:
+                if name in declared and command not in declared[name]:
+                    raise SystemExit("device_model: %s has no command %s" % (name, command))
+
+    def pruned_definitions(self):
+        """外すソースで定義されている関数の名前"""
+        names = set()
+        for server in self.pruned_servers:
+            for dirpath, _, filenames in os.walk(os.path.join(self.clusters_root, server)):
+                for filename in filenames:
+                    if filename.endswith((".cpp", ".c")):
+                        names.update(DEFINITION.findall(read_text(os.path.join(dirpath, filename))))
+        return names
+
+    def stubs(self):
+        """外したクラスターのための弱いシンボルのソース"""
+        defined = self.pruned_definitions()
+        plugins = read_text(find_file(self.library, PLUGIN_CALLBACKS))
+        callbacks = read_text(find_file(self.library, COMMAND_CALLBACKS))
+        self.check_commands(callbacks)
+        lines = [
+            "// tools/device_model.py が生成する．編集しないこと",
+            "#include <app-common/zap-generated/callback.h>",
+            "",
+        ]
+        count = 0
+        for name in PLUGIN_INIT.findall(plugins):
+            if "Matter%sPluginServerInitCallback" % name in defined:
+                lines.append("__attribute__((weak)) void Matter%sPluginServerInitCallback() {}" % name)
+                count += 1
+        for function, _, _, parameters in COMMAND_CALLBACK.findall(callbacks):
+            if function in defined:
+                lines.append("__attribute__((weak)) bool %s(%s) { return false; }" % (function, " ".join(parameters.split())))
+                count += 1
+        return "\n".join(lines) + "\n", count
+
+
+def apply(env):
+    model_path = env.GetProjectOption("custom_device_model", "")
+    if not model_path:
+        return
+    pruning = Pruning(env.subst("$PROJECT_DIR"), model_path)
+
+    if not pruning.pruned_servers:
+        # モデルを有効にした環境が外さないままのイメージを作らないように止める
+        raise SystemExit("device_model: no cluster sources under %s, cannot prune (is the library in lib/?)"
+                         % os.path.join(LIBRARY_SOURCE, CLUSTERS_DIRECTORY))
+
+    def skip_pruned(node):
+        return None if pruning.is_pruned(node.srcnode().get_abspath()) else node
+
+    env.AddBuildMiddleware(skip_pruned, "*/app/clusters/*")
+
+    source, count = pruning.stubs()
+    stub_dir = os.path.join(env.subst("$BUILD_DIR"), "device_model")
+    os.makedirs(stub_dir, exist_ok=True)
+    stub_path = os.path.join(stub_dir, STUB_NAME)
+    # 内容が変わったときだけ書く（毎回ビルドし直さないように）
+    if read_text(stub_path if os.path.exists(stub_path) else None) != source:
+        with open(stub_path, "w", encoding="utf-8") as stub:
+            stub.write(source)
+    env.BuildSources(os.path.join("$BUILD_DIR", "device_model_build"), stub_dir)
+    print("device_model: keeping %d cluster servers, pruning %d (%d stub symbols)"
+          % (len(pruning.kept_servers), len(pruning.pruned_servers), count))
+
+
+def main(project_dir, model_path):
+    pruning = Pruning(project_dir, model_path)
+    for endpoint in pruning.model["endpoints"]:
+        print("endpoint %d (%s)" % (endpoint["id"], endpoint["device_type"]))
+        for cluster in endpoint["clusters"]:
+            print("  %-10s %-28s %s" % (cluster["id"], cluster["name"], cluster.get("server") or "-"))
+    print("pruned servers: %s" % (", ".join(sorted(pruning.pruned_servers)) or "(library sources not found)"))
+
+
+try:
+    Import("env")  # noqa: F821  PlatformIO（SCons）から読み込まれたとき
+    apply(env)  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        main(sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.dirname(os.path.abspath(__file__))),
+             sys.argv[2] if len(sys.argv) > 2 else "device_model.json")
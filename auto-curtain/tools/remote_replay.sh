@@ -0,0 +1,25 @@
+#!/usr/bin/env bash
+# 記録したリモコンのパルス列を，ファームウェアと同じ復号器（src/remote_decoder.cpp）でホストで復号する．
+#
+# 実機のシリアルコンソールで `remote dump on` にすると，受信したパルス列が1回ごとに
+# "pulses: +9000 -4500 ..." の形で表示される．これをファイルに保存して渡す．
+# その前の行に "expect: nec 0x0 0x45"（または "expect: nec repeat"，"expect: none"）を書くと
+# 復号結果と比べ，1つでも合わなければ終了コード1で終わる（tools/remote_captures はすべて expect つき）．
+#
+# 使い方:
+#   ./tools/remote_replay.sh [記録したファイル...]   （省略すると tools/remote_captures/*.txt）
+
+set -eu
+
+cd "$(dirname "$0")/.."
+OUT_DIR=.pio/remote_replay
+mkdir -p "$OUT_DIR"
+
+${CXX:-g++} -std=gnu++17 -O2 -Wall -Wextra -Iinclude \
+    tools/remote_replay/main.cpp src/remote_decoder.cpp \
+    -o "$OUT_DIR/remote_replay"
+
+if [ $# -eq 0 ]; then
+    set -- tools/remote_captures/*.txt
+fi
+"$OUT_DIR/remote_replay" "$@"
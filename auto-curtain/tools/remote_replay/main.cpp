@@ -0,0 +1,160 @@
+/**
+ * @file main.cpp
+ * @brief 記録したリモコンのパルス列（remote dump の出力）をホストで復号する
+ *
+ * @details
+ * 1行が1回の受信．"+9000 -4500 +560 ..." のように符号付きの長さ [us] を並べる．
+ * 行頭の "pulses:" は読み飛ばす．# から始まる行と空行は無視する．
+ *
+ * パルス列の行の前に "expect:" の行を置くと，その復号結果を期待値と比べる．
+ *   expect: nec 0x0 0x45   （プロトコル アドレス コマンド）
+ *   expect: nec repeat     （リピート）
+ *   expect: none           （復号できないこと）
+ * 1つでも合わなければ終了コード1を返す．expect のない行は結果を表示するだけ．
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "remote_decoder.h"
+
+const size_t MAX_PULSES = 512;
+
+/**
+ * @brief 期待する復号結果
+ */
+struct Expect {
+    bool present;       ///< expect: の行があった
+    char protocol[16];  ///< プロトコル名（"none" なら復号できないこと）
+    bool repeat;        ///< リピート
+    unsigned long address;
+    unsigned long command;
+};
+
+/**
+ * @brief "expect:" のあとを読む
+ * @return 書式が正しければ true
+ */
+static bool parse_expect(const char *text, Expect *expect) {
+    char second[32] = "";
+    unsigned long command = 0;
+    int fields = sscanf(text, "%15s %31s %lx", expect->protocol, second, &command);
+    expect->present = true;
+    expect->repeat = false;
+    expect->address = 0;
+    expect->command = 0;
+    if (fields == 1) {
+        return strcmp(expect->protocol, "none") == 0;
+    }
+    if (fields == 2) {
+        expect->repeat = strcmp(second, "repeat") == 0;
+        return expect->repeat;
+    }
+    if (fields == 3) {
+        char *end;
+        expect->address = strtoul(second, &end, 16);
+        expect->command = command;
+        return *end == '\0';
+    }
+    return false;
+}
+
+/**
+ * @brief 復号結果を "nec 0x0 0x45" の形（expect: と同じ書式）にする
+ */
+static void format_code(bool decoded, const remote_decoder::Code &code, char *buffer, size_t size) {
+    if (!decoded) {
+        snprintf(buffer, size, "none");
+    } else if (code.repeat) {
+        snprintf(buffer, size, "%s repeat", remote_decoder::protocol_name(code.protocol));
+    } else {
+        snprintf(buffer, size, "%s 0x%lx 0x%lx", remote_decoder::protocol_name(code.protocol),
+                 static_cast<unsigned long>(code.address), static_cast<unsigned long>(code.command));
+    }
+}
+
+static void format_expect(const Expect &expect, char *buffer, size_t size) {
+    if (strcmp(expect.protocol, "none") == 0) {
+        snprintf(buffer, size, "none");
+    } else if (expect.repeat) {
+        snprintf(buffer, size, "%s repeat", expect.protocol);
+    } else {
+        snprintf(buffer, size, "%s 0x%lx 0x%lx", expect.protocol, expect.address, expect.command);
+    }
+}
+
+/**
+ * @brief 1つのファイルを復号する
+ * @return 期待値と合わなかった（または expect: の書式が誤っていた）数
+ */
+static unsigned replay(FILE *input, const char *name) {
+    char line[4096];
+    unsigned number = 0;
+    unsigned failures = 0;
+    Expect expect = {};
+    while (fgets(line, sizeof(line), input) != nullptr) {
+        number++;
+        char *cursor = line;
+        while (*cursor == ' ' || *cursor == '\t') cursor++;
+        if (*cursor == '#' || *cursor == '\n' || *cursor == '\0') {
+            continue;
+        }
+        if (strncmp(cursor, "expect:", 7) == 0) {
+            if (!parse_expect(cursor + 7, &expect)) {
+                printf("%s:%u: bad expect line\n", name, number);
+                failures++;
+                expect.present = false;
+            }
+            continue;
+        }
+        if (strncmp(cursor, "pulses:", 7) == 0) {
+            cursor += 7;
+        }
+        int32_t pulses[MAX_PULSES];
+        size_t count = 0;
+        char *end;
+        for (long value = strtol(cursor, &end, 10); end != cursor && count < MAX_PULSES; value = strtol(cursor, &end, 10)) {
+            pulses[count++] = static_cast<int32_t>(value);
+            cursor = end;
+        }
+        remote_decoder::Code code = {};
+        bool decoded = remote_decoder::decode(pulses, count, &code);
+        char actual[64];
+        format_code(decoded, code, actual, sizeof(actual));
+        if (!expect.present) {
+            printf("%s:%u: %zu pulses, %s\n", name, number, count, actual);
+            continue;
+        }
+        char expected[64];
+        format_expect(expect, expected, sizeof(expected));
+        if (strcmp(actual, expected) == 0) {
+            printf("%s:%u: %s ok\n", name, number, actual);
+        } else {
+            printf("%s:%u: %s MISMATCH (expected %s)\n", name, number, actual, expected);
+            failures++;
+        }
+        // expect: はすぐ後の1行にだけ効く
+        expect.present = false;
+    }
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    unsigned failures = 0;
+    if (argc < 2) {
+        failures = replay(stdin, "-");
+    }
+    for (int i = 1; i < argc; i++) {
+        FILE *input = fopen(argv[i], "r");
+        if (input == nullptr) {
+            perror(argv[i]);
+            return 1;
+        }
+        failures += replay(input, argv[i]);
+        fclose(input);
+    }
+    if (failures > 0) {
+        printf("%u mismatch(es)\n", failures);
+        return 1;
+    }
+    return 0;
+}
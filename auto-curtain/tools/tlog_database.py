@@ -0,0 +1,73 @@
+"""トークン化したログ（tlog.h）のトークンと書式の対応表を作る．
+
+ソースの TLOG("...") を探し，tlog::hash() と同じ FNV-1a でトークンを求めて
+tlog_database.csv（トークン, 書式, 場所）に書き出す．
+異なる書式が同じトークンになったらビルドを止める．
+
+PlatformIO の extra_scripts（pre:）として動くほか，単体でも実行できる:
+    python tools/tlog_database.py [プロジェクトのディレクトリ]
+"""
+import csv
+import os
+import re
+import sys
+
+TLOG_CALL = re.compile(r'\bTLOG\(\s*"((?:[^"\\]|\\.)*)"')
+ESCAPES = {"n": "\n", "t": "\t", "r": "\r", "\\": "\\", '"': '"', "'": "'"}
+SOURCE_DIRECTORIES = ("src", "include")
+DATABASE_NAME = "tlog_database.csv"
+
+
+def unescape(literal):
+    return re.sub(r"\\(.)", lambda m: ESCAPES.get(m.group(1), m.group(1)), literal)
+
+
+def fnv1a(text):
+    value = 2166136261
+    for byte in text.encode("utf-8"):
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value
+
+
+def collect(project_dir):
+    entries = {}
+    for directory in SOURCE_DIRECTORIES:
+        root = os.path.join(project_dir, directory)
+        for dirpath, _, filenames in os.walk(root):
+            for filename in sorted(filenames):
+                if not filename.endswith((".cpp", ".h")):
+                    continue
+                path = os.path.join(dirpath, filename)
+                with open(path, encoding="utf-8") as source:
+                    for number, line in enumerate(source, 1):
+                        if line.lstrip().startswith(("*", "//")):
+                            continue  # コメントの中の例
+                        for match in TLOG_CALL.finditer(line):
+                            text = unescape(match.group(1))
+                            token = fnv1a(text)
+                            location = "%s:%d" % (os.path.relpath(path, project_dir), number)
+                            if token in entries and entries[token][0] != text:
+                                raise SystemExit("tlog: token collision 0x%08x: %r (%s) and %r (%s)"
+                                                 % (token, entries[token][0], entries[token][1], text, location))
+                            entries.setdefault(token, (text, location))
+    return entries
+
+
+def write_database(project_dir):
+    entries = collect(project_dir)
+    path = os.path.join(project_dir, DATABASE_NAME)
+    with open(path, "w", newline="", encoding="utf-8") as database:
+        writer = csv.writer(database)
+        writer.writerow(["token", "format", "location"])
+        for token, (text, location) in sorted(entries.items()):
+            writer.writerow(["0x%08x" % token, text, location])
+    print("tlog: %d formats -> %s" % (len(entries), path))
+
+
+try:
+    Import("env")  # noqa: F821  PlatformIO（SCons）から読み込まれたとき
+    write_database(env.subst("$PROJECT_DIR"))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        write_database(sys.argv[1] if len(sys.argv) > 1 else
+                       os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
@@ -0,0 +1,117 @@
+"""トークン化したログ（tlog.h）を元の文字列に戻して表示する．
+
+制御周期のトレース（diag_transport.h，0xFD, 長さ, MotionTrace）は
+"trace,tick,position,setpoint,duty,current_ma" の形のCSVの行にする．
+どちらのフレームでもないバイトは，コンソールの応答などの
+ふつうの文字列としてそのまま表示する．
+
+使い方:
+    python tools/tlog_decode.py <シリアルポート> [ボーレート]   （pyserial が必要）
+    python tools/tlog_decode.py - < 記録したファイル
+"""
+import csv
+import os
+import re
+import struct
+import sys
+
+FRAME_START = 0xFE
+TRACE_FRAME_START = 0xFD
+TRACE_FORMAT = "<IiihH"
+DATABASE = os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(__file__))), "tlog_database.csv")
+# printf の変換指定．長さ修飾子（l, h, z など）は Python の % 書式にないので取り除く
+SPECIFIER = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|j|t)?([diuxXocfeEgGs%])")
+
+
+def load_database(path):
+    with open(path, encoding="utf-8") as database:
+        return {int(row["token"], 16): row["format"] for row in csv.DictReader(database)}
+
+
+def read_varint(payload, offset):
+    value = 0
+    shift = 0
+    while True:
+        byte = payload[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, offset
+
+
+def format_frame(formats, payload):
+    token = struct.unpack_from("<I", payload, 0)[0]
+    text = formats.get(token)
+    if text is None:
+        return "<unknown token 0x%08x>" % token
+    offset = 4
+
+    def convert(match):
+        nonlocal offset
+        flags, conversion = match.groups()
+        if conversion == "%":
+            return "%"
+        try:
+            if conversion == "s":
+                length = payload[offset]
+                value = payload[offset + 1:offset + 1 + length].decode("utf-8", "replace")
+                offset += 1 + length
+            elif conversion in "feEgG":
+                value = struct.unpack_from("<f", payload, offset)[0]
+                offset += 4
+            else:
+                zigzag, offset = read_varint(payload, offset)
+                value = (zigzag >> 1) ^ -(zigzag & 1)
+                if conversion in "uxXo" and value < 0:
+                    value &= 0xFFFFFFFF
+                if conversion == "i":
+                    conversion = "d"
+            return ("%" + flags + conversion) % value
+        except (IndexError, struct.error):
+            return "?"
+
+    return SPECIFIER.sub(convert, text)
+
+
+def decode(stream, formats, out):
+    text = bytearray()
+    while True:
+        byte = stream.read(1)
+        if not byte:
+            break
+        if byte[0] not in (FRAME_START, TRACE_FRAME_START):
+            text += byte
+            if byte == b"\n":
+                out.write(text.decode("utf-8", "replace"))
+                text.clear()
+            continue
+        header = stream.read(1)
+        if not header:
+            break
+        payload = stream.read(header[0])
+        if len(payload) < 4:
+            break
+        if text:
+            out.write(text.decode("utf-8", "replace") + "\n")
+            text.clear()
+        if byte[0] == TRACE_FRAME_START:
+            if len(payload) == struct.calcsize(TRACE_FORMAT):
+                out.write("trace,%d,%d,%d,%d,%d\n" % struct.unpack(TRACE_FORMAT, payload))
+            continue
+        out.write(format_frame(formats, payload) + "\n")
+        out.flush()
+
+
+def main():
+    formats = load_database(DATABASE)
+    if len(sys.argv) < 2 or sys.argv[1] == "-":
+        decode(sys.stdin.buffer, formats, sys.stdout)
+        return
+    import serial  # pyserial
+    port = serial.Serial(sys.argv[1], int(sys.argv[2]) if len(sys.argv) > 2 else 115200)
+    decode(port, formats, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,77 @@
+/**
+ * @file power_meter.h
+ * @brief プラグインユニットの電圧・電流をADCのDMAで連続サンプリングし，実効値と電力と電力量を求める
+ *
+ * @details
+ * ADC1 のデジタルコントローラー（DMA）が電圧と各チャネルの電流を順番に変換し続け，
+ * 変換結果はブロック（BLOCK_BYTES）ごとにまとめて渡される．CPUはサンプルごとに割り込みを受けず，
+ * 低い優先度のタスクがブロック単位で整数の和（Σx，Σx²，Σv·i）を足し込むだけなので，
+ * チャネルを増やしても1コアのわずかな割合しか使わない（stats() の cpu_permille）．
+ * 1秒（WINDOW_US）ごとに和から次を求め，measurement() で公開する．
+ * - 実効値: sqrt(Σx²/n - (Σx/n)²)（直流のバイアスを引いたもの．Q8 の整数平方根）
+ * - 有効電力: Σv·i/n - (Σv/n)(Σi/n)
+ * - 電力量: 有効電力 × 窓の時間の積算
+ * 電圧は全チャネル共通（同じコンセントの電源）．電圧と電流は同時ではなく1変換ずつずれるが，
+ * 9kHz の変換では 50Hz で約2度なので力率の誤差は無視できる．
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace power_meter {
+
+// 電流を測るチャネルの数の上限（ESP32-C3 の ADC1 は5チャネル．1つは電圧に使う）
+const uint8_t MAX_CHANNELS = 4;
+// 実効値と電力を求める窓 [us]（50Hz と 60Hz のどちらでも整数周期）
+const uint32_t WINDOW_US = 1000000;
+
+/**
+ * @brief 計測の設定
+ */
+struct Config {
+  int voltage_pin;               ///< 電圧センサー（ZMPT101B など）の出力．ADC1 のピン
+  const int *current_pins;       ///< チャネルごとの電流センサー（ACS712 など）の出力．ADC1 のピン
+  uint8_t channel_count;         ///< チャネルの数
+  uint32_t voltage_uv_per_count; ///< ADCの1カウントあたりの電源電圧 [uV]（校正値）
+  uint32_t current_ua_per_count; ///< ADCの1カウントあたりの電流 [uA]（校正値）
+};
+
+/**
+ * @brief 1チャネルの直近の窓の計測値
+ */
+struct Measurement {
+  int64_t rms_voltage_mv;    ///< 電圧の実効値 [mV]
+  int64_t rms_current_ma;    ///< 電流の実効値 [mA]
+  int64_t active_power_mw;   ///< 有効電力 [mW]（負荷が消費する向きが正）
+  int64_t apparent_power_mw; ///< 皮相電力 [mW]（電圧と電流の実効値の積）
+  int64_t energy_mwh;        ///< 起動してからの電力量（消費した分だけ）[mWh]
+};
+
+/**
+ * @brief サンプリングの統計
+ */
+struct Stats {
+  uint32_t windows;       ///< 求めた窓の数（増えたら新しい計測値がある）
+  uint32_t blocks;        ///< 処理したDMAのブロックの数
+  uint32_t samples;       ///< 直近の窓の1チャネルあたりのサンプル数
+  uint32_t overruns;      ///< 処理が間に合わず捨てられたブロックの数
+  uint32_t cpu_permille;  ///< ブロックの処理に使ったCPUの割合 [‰]（直近の窓）
+};
+
+/**
+ * @brief ADCのDMAを設定し，サンプリングと計測のタスクを始める
+ * @return ピンが ADC1 でないなどで始められなければfalse
+ */
+bool begin(const Config &config);
+
+/**
+ * @brief 直近の窓の計測値（どのタスクからでもよい）
+ */
+Measurement measurement(uint8_t channel);
+
+/**
+ * @brief 統計
+ */
+Stats stats();
+
+} // namespace power_meter
@@ -0,0 +1,70 @@
+/**
+ * @file zero_cross_relay.h
+ * @brief リレーの接点を交流のゼロクロスで開閉するスケジューラ
+ *
+ * @details
+ * 指令を受けた瞬間にリレーを動かすと，電圧（電流）が大きいところで接点が開閉してアークが出て，接点が傷む．
+ * ここでは，ゼロクロス検出の入力の割り込みで交流のゼロクロスの時刻と半周期を測っておき，
+ * 「次のゼロクロス - リレーの動作時間」にタイマー（esp_timer）でリレーを駆動する．
+ * 接点が実際に動くのがちょうどゼロクロスになる．駆動はタイマーから行うので loop() の遅れに左右されない．
+ *
+ * - ゼロクロス検出: フォトカプラのゼロクロス検出モジュールのパルス（ゼロクロスの前後で出る）．
+ *   パルスの始まりと終わりの中点をゼロクロスとする．
+ * - リレーの動作時間（駆動から接点が閉じるまで）と復帰時間（駆動をやめてから接点が開くまで）は
+ *   リレーごとに違い，経年でも変わる．2回路のリレーの空きの接点をGNDとの間につなぐ（sense_pin）と，
+ *   開閉のたびに実際の時間を測って平均に取り込む．つながなければ設定の値をそのまま使う．
+ * - ゼロクロスが一定時間来なければ（直流の負荷，検出の故障）すぐに駆動する．
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace zero_cross_relay {
+
+// 扱うチャネルの数の上限
+const uint8_t MAX_CHANNELS = 4;
+
+/**
+ * @brief リレー1つ分の設定
+ */
+struct ChannelConfig {
+  int relay_pin;       ///< リレーの駆動（Hで動作）
+  int sense_pin;       ///< 空きの接点（閉じるとL）．つながなければ -1
+  uint32_t operate_us; ///< 動作時間の初期値（データシートの値）
+  uint32_t release_us; ///< 復帰時間の初期値
+};
+
+/**
+ * @brief リレー1つ分の状態（表示用）
+ */
+struct ChannelStatus {
+  bool on;              ///< 最後に指令した状態
+  uint32_t operate_us;  ///< 動作時間（測っていれば平均）
+  uint32_t release_us;  ///< 復帰時間（測っていれば平均）
+  int32_t last_error_us; ///< 直近の開閉で，接点が動いた時刻 - 狙ったゼロクロス（測っていなければ0）
+  uint32_t measurements; ///< 測った回数
+};
+
+/**
+ * @brief ゼロクロス検出とリレーを設定する．リレーはすべて切っておく
+ * @param zero_cross_pin ゼロクロス検出の入力
+ * @param channels リレーの設定（count 個）
+ */
+void begin(int zero_cross_pin, const ChannelConfig *channels, uint8_t count);
+
+/**
+ * @brief リレーを次のゼロクロスで on にする（どのタスクからでもよい．すぐに戻る）
+ */
+void request(uint8_t channel, bool on);
+
+/**
+ * @brief 交流の半周期 [us]（ゼロクロスが来ていなければ0）
+ */
+uint32_t half_period_us();
+
+/**
+ * @brief リレーの状態
+ */
+ChannelStatus status(uint8_t channel);
+
+} // namespace zero_cross_relay
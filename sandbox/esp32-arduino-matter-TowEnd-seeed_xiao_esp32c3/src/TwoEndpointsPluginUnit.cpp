@@ -8,14 +8,26 @@
  * プラグインユニットは以下の方法でトグルできます:
  *  - Matter（CHIPToolや他のMatterコントローラーを介して）
  *  - トグルボタン（デバウンス付き）
+ * 出力はリレーで，接点は交流のゼロクロスで開閉する（zero_cross_relay.h）．
+ * 各エンドポイントの電圧・電流・電力と電力量を Electrical Power/Energy Measurement クラスターで公開する
+ * （ADCのDMAで連続サンプリングする．power_meter.h）．
  * 
  * @note PINの設定が必要です。
  * 
  * @section pins ピン設定
- * - LED_PIN_1: D0
- * - LED_PIN_2: D1
+ * - RELAY_PIN_1: D4（リレー1の駆動）
+ * - RELAY_PIN_2: D5（リレー2の駆動）
  * - TOGGLE_BUTTON_PIN_1: D9
  * - TOGGLE_BUTTON_PIN_2: D8
+ * - ZERO_CROSS_PIN: D3（ゼロクロス検出モジュールの出力）
+ * - RELAY_SENSE_PIN_1: D6，RELAY_SENSE_PIN_2: D7（リレーの空きの接点．なければ -1）
+ * - VOLTAGE_SENSE_PIN: A0（電圧センサー．両チャネル共通）
+ * - CURRENT_SENSE_PIN_1: A1，CURRENT_SENSE_PIN_2: A2（チャネルごとの電流センサー）
+ * DMAで読めるのは ADC1（XIAO では A0〜A2）だけなので，アナログ入力をここに集めている．
+ * リレーの駆動はUART0（D6: U0TXD，D7: U0RXD）とストラッピングピン（D8，D9）を避けている
+ * （UART0のピンにつなぐと，起動時のROMのログでリレーがばたつく）．
+ * Serial は USB CDC なので，UART0のピンは空きの接点の入力に使う．起動中はROMが U0TXD をHに駆動するので，
+ * 空きの接点はリレーが切れているときに開くものを使い，ピンとの間に1kΩ程度を直列に入れる．
  * 
  * @section debounce デバウンス設定
  * - DEBOUNCE_DELAY: 500ms
@@ -32,7 +44,7 @@
  * 
  * @section functions 関数
  * - setup(): 初期設定を行います。
- * - loop(): トグルボタンの状態を監視し、デバウンス処理を行います。
+ * - loop(): トグルボタンの状態を監視し、デバウンス処理を行います。リレーの動作時間を測ったら表示します。電力の計測値を属性に反映します。
  * - on_device_event(): デバイスイベントのリスナー（空の実装）。
  * - on_identification(): デバイス識別のコールバック。
  * - on_attribute_update(): 属性更新リクエストのリスナー。
@@ -48,16 +60,36 @@
 #include "Matter.h"
 #include <app/server/OnboardingCodesUtil.h>
 #include <credentials/examples/DeviceAttestationCredsExample.h>
+#include "power_meter.h"
+#include "zero_cross_relay.h"
 using namespace chip;
 using namespace chip::app::Clusters;
 using namespace esp_matter;
 using namespace esp_matter::endpoint;
 
 // PINを設定してください
-const int LED_PIN_1 = D0;
-const int LED_PIN_2 = D1;
+const int RELAY_PIN_1 = D4;
+const int RELAY_PIN_2 = D5;
 const int TOGGLE_BUTTON_PIN_1 = D9;
 const int TOGGLE_BUTTON_PIN_2 = D8;
+const int ZERO_CROSS_PIN = D3;
+const int RELAY_SENSE_PIN_1 = D6;
+const int RELAY_SENSE_PIN_2 = D7;
+const int VOLTAGE_SENSE_PIN = A0;
+const int CURRENT_SENSE_PINS[] = {A1, A2};
+
+// リレーの動作時間と復帰時間の初期値 [us]（データシートの値．空きの接点をつなげば実測で置き換わる）
+const uint32_t RELAY_OPERATE_US = 8000;
+const uint32_t RELAY_RELEASE_US = 4000;
+const zero_cross_relay::ChannelConfig RELAY_CHANNELS[] = {
+  {RELAY_PIN_1, RELAY_SENSE_PIN_1, RELAY_OPERATE_US, RELAY_RELEASE_US},
+  {RELAY_PIN_2, RELAY_SENSE_PIN_2, RELAY_OPERATE_US, RELAY_RELEASE_US},
+};
+
+// ADCの1カウントあたりの電圧と電流（校正値．既知の負荷をつないで合わせること）
+// ZMPT101B: 100Vrms で約 ±1000 カウント振れるように調整したとき，ACS712-5A: 185mV/A
+const uint32_t VOLTAGE_UV_PER_COUNT = 141000;
+const uint32_t CURRENT_UA_PER_COUNT = 3300;
 
 // トグルボタンのデバウンス
 const int DEBOUNCE_DELAY = 500;
@@ -67,12 +99,68 @@ int last_toggle;
 const uint32_t CLUSTER_ID = OnOff::Id;
 const uint32_t ATTRIBUTE_ID = OnOff::Attributes::OnOff::Id;
 
+// Electrical Sensor デバイスタイプの Power Topology，Electrical Power Measurement，Electrical Energy Measurement クラスター
+// （esp32-arduino-matterのZAP生成物に含まれないのでIDを直接書く）
+const uint32_t DEVICE_TYPE_ID_ELECTRICAL_SENSOR = 0x0510;
+const uint32_t CLUSTER_ID_POWER_TOPOLOGY = 0x009C;
+const uint32_t POWER_TOPOLOGY_FEATURE_MAP = 0x02; // TreeTopology（このエンドポイントの分だけを測る）
+const uint32_t CLUSTER_ID_POWER = 0x0090;
+const uint32_t ATTRIBUTE_ID_POWER_MODE = 0x0000;
+const uint32_t ATTRIBUTE_ID_NUMBER_OF_MEASUREMENT_TYPES = 0x0001;
+const uint32_t ATTRIBUTE_ID_VOLTAGE = 0x0004;
+const uint32_t ATTRIBUTE_ID_ACTIVE_CURRENT = 0x0005;
+const uint32_t ATTRIBUTE_ID_ACTIVE_POWER = 0x0008;
+const uint32_t ATTRIBUTE_ID_APPARENT_POWER = 0x000A;
+const uint32_t ATTRIBUTE_ID_RMS_VOLTAGE = 0x000B;
+const uint32_t ATTRIBUTE_ID_RMS_CURRENT = 0x000C;
+// 公開する計測値（MeasurementType ごとに1つ）
+const uint32_t MEASUREMENT_ATTRIBUTE_IDS[] = {ATTRIBUTE_ID_VOLTAGE, ATTRIBUTE_ID_ACTIVE_CURRENT, ATTRIBUTE_ID_ACTIVE_POWER,
+                                              ATTRIBUTE_ID_APPARENT_POWER, ATTRIBUTE_ID_RMS_VOLTAGE, ATTRIBUTE_ID_RMS_CURRENT};
+const uint32_t POWER_FEATURE_MAP = 0x02; // AlternatingCurrent
+const uint8_t POWER_MODE_AC = 2;
+const uint32_t CLUSTER_ID_ENERGY = 0x0091;
+const uint32_t ATTRIBUTE_ID_CUMULATIVE_ENERGY_IMPORTED = 0x0001;
+const uint32_t ENERGY_FEATURE_MAP = 0x01 | 0x04; // ImportedEnergy | CumulativeEnergy
+
 // Matterデバイスに割り当てられるエンドポイントと属性参照
 uint16_t plugin_unit_endpoint_id_1 = 0;
 uint16_t plugin_unit_endpoint_id_2 = 0;
 attribute_t *attribute_ref_1;
 attribute_t *attribute_ref_2;
 
+/**
+ * @brief 電力と電力量の計測クラスターをプラグインユニットのエンドポイントに追加する
+ * 
+ * 単位は mV，mA，mW，mWh．このバージョンのesp_matterは構造体型の属性を作れないので，仕様どおりではないところがある．
+ * - CumulativeEnergyImported は EnergyMeasurementStruct の energy フィールドだけを int64 の属性として公開している．
+ * - Electrical Power Measurement の必須の属性のうち Accuracy（MeasurementAccuracyStruct のリスト）は作れず，ない．
+ *   NumberOfMeasurementTypes は公開している計測値の数にしている．
+ * 認証テストやコントローラーによっては Electrical Sensor として扱われないことがある．
+ * @param plugin_unit_endpoint プラグインユニットのエンドポイント
+ */
+static void create_power_clusters(endpoint_t *plugin_unit_endpoint) {
+  endpoint::add_device_type(plugin_unit_endpoint, DEVICE_TYPE_ID_ELECTRICAL_SENSOR, 1);
+
+  cluster_t *topology_cluster = cluster::create(plugin_unit_endpoint, CLUSTER_ID_POWER_TOPOLOGY, CLUSTER_FLAG_SERVER);
+  cluster::global::attribute::create_feature_map(topology_cluster, POWER_TOPOLOGY_FEATURE_MAP);
+  cluster::global::attribute::create_cluster_revision(topology_cluster, 1);
+
+  cluster_t *power_cluster = cluster::create(plugin_unit_endpoint, CLUSTER_ID_POWER, CLUSTER_FLAG_SERVER);
+  cluster::global::attribute::create_feature_map(power_cluster, POWER_FEATURE_MAP);
+  cluster::global::attribute::create_cluster_revision(power_cluster, 1);
+  attribute::create(power_cluster, ATTRIBUTE_ID_POWER_MODE, ATTRIBUTE_FLAG_NONE, esp_matter_enum8(POWER_MODE_AC));
+  uint8_t measurement_count = sizeof(MEASUREMENT_ATTRIBUTE_IDS) / sizeof(MEASUREMENT_ATTRIBUTE_IDS[0]);
+  attribute::create(power_cluster, ATTRIBUTE_ID_NUMBER_OF_MEASUREMENT_TYPES, ATTRIBUTE_FLAG_NONE, esp_matter_uint8(measurement_count));
+  for (uint32_t attribute_id : MEASUREMENT_ATTRIBUTE_IDS) {
+    attribute::create(power_cluster, attribute_id, ATTRIBUTE_FLAG_NULLABLE, esp_matter_nullable_int64(nullable<int64_t>()));
+  }
+
+  cluster_t *energy_cluster = cluster::create(plugin_unit_endpoint, CLUSTER_ID_ENERGY, CLUSTER_FLAG_SERVER);
+  cluster::global::attribute::create_feature_map(energy_cluster, ENERGY_FEATURE_MAP);
+  cluster::global::attribute::create_cluster_revision(energy_cluster, 1);
+  attribute::create(energy_cluster, ATTRIBUTE_ID_CUMULATIVE_ENERGY_IMPORTED, ATTRIBUTE_FLAG_NULLABLE, esp_matter_nullable_int64(0));
+}
+
 // セットアッププロセスに関連するさまざまなデバイスイベントをリッスンする可能性があります。簡単のために空のままにしてあります。
 static void on_device_event(const ChipDeviceEvent *event, intptr_t arg) {}
 static esp_err_t on_identification(identification::callback_type_t type,
@@ -83,7 +171,7 @@ static esp_err_t on_identification(identification::callback_type_t type,
 
 /**
  * @brief 属性更新リクエストのリスナー
- * この例では、更新がリクエストされたとき、パス（エンドポイント、クラスター、属性）がプラグインユニット属性と一致するかどうかを確認します。もし一致する場合、LEDは新しい状態に変更されます。
+ * この例では、更新がリクエストされたとき、パス（エンドポイント、クラスター、属性）がプラグインユニット属性と一致するかどうかを確認します。もし一致する場合、リレーを次のゼロクロスで新しい状態に切り替えます（ここでは予約するだけですぐに戻ります）。
  * 
  * @param type 属性更新のタイプ
  * @param endpoint_id エンドポイントID
@@ -102,9 +190,9 @@ static esp_err_t on_attribute_update(attribute::callback_type_t type,
   // プラグインユニットのオン/オフ属性の更新を受け取りました！
   bool new_state = val->val.b;
   if (endpoint_id == plugin_unit_endpoint_id_1) {
-    digitalWrite(LED_PIN_1, new_state);
+    zero_cross_relay::request(0, new_state);
   } else if (endpoint_id == plugin_unit_endpoint_id_2) {
-    digitalWrite(LED_PIN_2, new_state);
+    zero_cross_relay::request(1, new_state);
   }
   }
   return ESP_OK;
@@ -112,8 +200,8 @@ static esp_err_t on_attribute_update(attribute::callback_type_t type,
 
 void setup() {
   Serial.begin(115200);
-  pinMode(LED_PIN_1, OUTPUT);
-  pinMode(LED_PIN_2, OUTPUT);
+  // リレーの出力はゼロクロスのスケジューラが持つ
+  zero_cross_relay::begin(ZERO_CROSS_PIN, RELAY_CHANNELS, 2);
   pinMode(TOGGLE_BUTTON_PIN_1, INPUT);
   pinMode(TOGGLE_BUTTON_PIN_2, INPUT);
 
@@ -144,6 +232,14 @@ void setup() {
   plugin_unit_endpoint_id_1 = endpoint::get_id(endpoint_1);
   plugin_unit_endpoint_id_2 = endpoint::get_id(endpoint_2);
 
+  // 電力の計測（ADCのDMAで電圧と2チャネルの電流を連続サンプリングする）
+  create_power_clusters(endpoint_1);
+  create_power_clusters(endpoint_2);
+  power_meter::Config meter_config = {VOLTAGE_SENSE_PIN, CURRENT_SENSE_PINS, 2, VOLTAGE_UV_PER_COUNT, CURRENT_UA_PER_COUNT};
+  if (!power_meter::begin(meter_config)) {
+    Serial.println("Power meter not available");
+  }
+
   // DACをセットアップ（ここでカスタム委任データ、パスコードなどを設定するのが良い場所です）
   esp_matter::set_custom_dac_provider(chip::Credentials::Examples::GetExampleDACProvider());
 
@@ -167,8 +263,63 @@ void set_onoff_attribute_value(esp_matter_attr_val_t *onoff_value, uint16_t plug
   attribute::update(plugin_unit_endpoint_id, CLUSTER_ID, ATTRIBUTE_ID, onoff_value);
 }
 
+// リレーの動作時間を測ったら，狙ったゼロクロスとのずれと一緒に表示します
+void print_relay_measurements() {
+  static uint32_t last_measurements[2] = {0, 0};
+  for (uint8_t i = 0; i < 2; i++) {
+    zero_cross_relay::ChannelStatus status = zero_cross_relay::status(i);
+    if (status.measurements != last_measurements[i]) {
+      last_measurements[i] = status.measurements;
+      Serial.printf("relay %u: %s, operate %lu us, release %lu us, error %ld us, half period %lu us\n", i + 1,
+                    status.on ? "on" : "off", static_cast<unsigned long>(status.operate_us),
+                    static_cast<unsigned long>(status.release_us), static_cast<long>(status.last_error_us),
+                    static_cast<unsigned long>(zero_cross_relay::half_period_us()));
+    }
+  }
+}
+
+// 電力の計測値の窓が1つ終わるたびに，各エンドポイントの属性に反映します
+void report_power() {
+  static uint32_t last_windows = 0;
+  power_meter::Stats stats = power_meter::stats();
+  if (stats.windows == last_windows) {
+    return;
+  }
+  last_windows = stats.windows;
+  const uint16_t endpoint_ids[] = {plugin_unit_endpoint_id_1, plugin_unit_endpoint_id_2};
+  for (uint8_t i = 0; i < 2; i++) {
+    power_meter::Measurement measurement = power_meter::measurement(i);
+    const struct {
+      uint32_t cluster_id;
+      uint32_t attribute_id;
+      int64_t value;
+    } reports[] = {
+      {CLUSTER_ID_POWER, ATTRIBUTE_ID_VOLTAGE, measurement.rms_voltage_mv},
+      {CLUSTER_ID_POWER, ATTRIBUTE_ID_RMS_VOLTAGE, measurement.rms_voltage_mv},
+      {CLUSTER_ID_POWER, ATTRIBUTE_ID_ACTIVE_CURRENT, measurement.rms_current_ma},
+      {CLUSTER_ID_POWER, ATTRIBUTE_ID_RMS_CURRENT, measurement.rms_current_ma},
+      {CLUSTER_ID_POWER, ATTRIBUTE_ID_ACTIVE_POWER, measurement.active_power_mw},
+      {CLUSTER_ID_POWER, ATTRIBUTE_ID_APPARENT_POWER, measurement.apparent_power_mw},
+      {CLUSTER_ID_ENERGY, ATTRIBUTE_ID_CUMULATIVE_ENERGY_IMPORTED, measurement.energy_mwh},
+    };
+    for (const auto &report : reports) {
+      esp_matter_attr_val_t value = esp_matter_nullable_int64(report.value);
+      attribute::update(endpoint_ids[i], report.cluster_id, report.attribute_id, &value);
+    }
+  }
+  // 10窓（10秒）ごとにサンプリングの負荷を表示します
+  if (stats.windows % 10 == 0) {
+    Serial.printf("power meter: %lu samples/s per input, cpu %lu permille, overruns %lu\n",
+                  static_cast<unsigned long>(stats.samples), static_cast<unsigned long>(stats.cpu_permille),
+                  static_cast<unsigned long>(stats.overruns));
+  }
+}
+
 // トグルプラグインユニットボタンが押されたとき（デバウンス付き）、プラグインユニット属性値が変更されます
 void loop() {
+  print_relay_measurements();
+  report_power();
+
   if ((millis() - last_toggle) > DEBOUNCE_DELAY) {
   if (!digitalRead(TOGGLE_BUTTON_PIN_1)) {
     last_toggle = millis();
@@ -0,0 +1,277 @@
+/**
+ * @file power_meter.cpp
+ * @brief プラグインユニットの電圧・電流をADCのDMAで連続サンプリングし，実効値と電力と電力量を求める
+ */
+#include "power_meter.h"
+
+#include <Arduino.h>
+#include <driver/adc.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace power_meter {
+
+// 1つの入力（電圧，各チャネルの電流）あたりのサンプリング周波数 [Hz]
+const uint32_t SAMPLE_RATE_PER_INPUT_HZ = 3000;
+// 1回に受け取るDMAのブロック [byte]（1変換 SOC_ADC_DIGI_RESULT_BYTES）．9kHz で約28ms分
+const uint32_t BLOCK_BYTES = 1024;
+// ドライバが受け取ったブロックをためておく大きさ（処理が遅れたときの余裕）
+const uint32_t POOL_BYTES = 4 * BLOCK_BYTES;
+// 計測のタスク．ブロックが来るまで寝ているので，loop より少し上に置く
+const uint32_t TASK_STACK_SIZE = 4096;
+const UBaseType_t TASK_PRIORITY = 3;
+// 入力の番号（0: 電圧，1から: 各チャネルの電流）．ADCのチャネルから引く
+const int8_t NOT_USED = -1;
+
+/**
+ * @brief 1つの入力の和
+ */
+struct Sums {
+  int64_t sum;
+  int64_t sum_squares;
+  uint32_t count;
+};
+
+/**
+ * @brief 1チャネルの窓の和（電流と，直前の電圧との積）
+ */
+struct ChannelSums {
+  Sums current;
+  int64_t sum_products;
+};
+
+static Config meter_config = {};
+static int8_t input_of_channel[SOC_ADC_MAX_CHANNEL_NUM];
+static uint8_t block[BLOCK_BYTES];
+
+// 計測のタスクだけが触る
+static Sums voltage_sums = {};
+static ChannelSums channel_sums[MAX_CHANNELS] = {};
+static int32_t last_voltage = 0;
+static int64_t window_start_us = 0;
+static int64_t busy_us = 0;
+static int64_t energy_uj[MAX_CHANNELS] = {};
+
+// 公開する値（mux で守る）
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+static Measurement published[MAX_CHANNELS] = {};
+static Stats current_stats = {};
+
+/**
+ * @brief 64ビットの整数平方根（切り捨て）
+ */
+static uint32_t isqrt64(uint64_t value) {
+  uint64_t root = 0;
+  uint64_t bit = 1ULL << 62;
+  while (bit > value) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return static_cast<uint32_t>(root);
+}
+
+/**
+ * @brief 平均 [count, Q8]
+ */
+static int64_t mean_q8(const Sums &sums) {
+  return sums.count == 0 ? 0 : (sums.sum << 8) / sums.count;
+}
+
+/**
+ * @brief バイアスを引いた実効値 [count, Q8]
+ */
+static int64_t rms_q8(const Sums &sums) {
+  if (sums.count == 0) {
+    return 0;
+  }
+  int64_t mean = mean_q8(sums);
+  int64_t variance_q16 = (sums.sum_squares << 16) / sums.count - mean * mean;
+  return variance_q16 > 0 ? isqrt64(static_cast<uint64_t>(variance_q16)) : 0;
+}
+
+/**
+ * @brief DMAのブロック1つを和に足し込む（変換結果は入力の順に並んでいる）
+ */
+static void accumulate(const uint8_t *data, size_t length) {
+  for (size_t offset = 0; offset + SOC_ADC_DIGI_RESULT_BYTES <= length; offset += SOC_ADC_DIGI_RESULT_BYTES) {
+    const adc_digi_output_data_t *result = reinterpret_cast<const adc_digi_output_data_t *>(data + offset);
+    if (result->type2.unit != 0 || result->type2.channel >= SOC_ADC_MAX_CHANNEL_NUM) {
+      continue;
+    }
+    int8_t input = input_of_channel[result->type2.channel];
+    int32_t value = result->type2.data;
+    if (input == 0) {
+      last_voltage = value;
+      voltage_sums.sum += value;
+      voltage_sums.sum_squares += value * value;
+      voltage_sums.count++;
+    } else if (input > 0) {
+      ChannelSums &sums = channel_sums[input - 1];
+      sums.current.sum += value;
+      sums.current.sum_squares += value * value;
+      sums.current.count++;
+      sums.sum_products += last_voltage * value;
+    }
+  }
+}
+
+/**
+ * @brief 窓の和から計測値を求めて公開し，和を空にする
+ */
+static void finish_window(int64_t now) {
+  int64_t window_us = now - window_start_us;
+  int64_t voltage_rms = rms_q8(voltage_sums);
+  int64_t voltage_mean = mean_q8(voltage_sums);
+  Measurement results[MAX_CHANNELS];
+  for (uint8_t i = 0; i < meter_config.channel_count; i++) {
+    ChannelSums &sums = channel_sums[i];
+    Measurement &result = results[i];
+    int64_t current_rms = rms_q8(sums.current);
+    int64_t covariance_q16 = sums.current.count == 0 ? 0
+      : (sums.sum_products << 16) / sums.current.count - voltage_mean * mean_q8(sums.current);
+    result.rms_voltage_mv = voltage_rms * meter_config.voltage_uv_per_count / 1000 / 256;
+    result.rms_current_ma = current_rms * meter_config.current_ua_per_count / 1000 / 256;
+    // [count²] × [uV/count] × [uA/count] = [pW]．途中で桁があふれないように分けて割る
+    result.active_power_mw = covariance_q16 * meter_config.voltage_uv_per_count / 1000
+                             * meter_config.current_ua_per_count / 1000000 / 65536;
+    result.apparent_power_mw = result.rms_voltage_mv * result.rms_current_ma / 1000;
+    if (result.active_power_mw > 0) {
+      // [mW] × [ms] = [uJ]
+      energy_uj[i] += result.active_power_mw * window_us / 1000;
+    }
+    result.energy_mwh = energy_uj[i] / 3600000;
+    sums = {};
+  }
+
+  portENTER_CRITICAL(&mux);
+  for (uint8_t i = 0; i < meter_config.channel_count; i++) {
+    published[i] = results[i];
+  }
+  current_stats.windows++;
+  current_stats.samples = voltage_sums.count;
+  current_stats.cpu_permille = window_us > 0 ? static_cast<uint32_t>(busy_us * 1000 / window_us) : 0;
+  portEXIT_CRITICAL(&mux);
+
+  voltage_sums = {};
+  busy_us = 0;
+  window_start_us = now;
+}
+
+/**
+ * @brief DMAのブロックが来るたびに和に足し込み，窓が終わったら計測値を求める
+ */
+static void meter_task(void *arg) {
+  window_start_us = esp_timer_get_time();
+  while (true) {
+    uint32_t length = 0;
+    esp_err_t result = adc_digi_read_bytes(block, BLOCK_BYTES, &length, ADC_MAX_DELAY);
+    int64_t start = esp_timer_get_time();
+    if (result == ESP_ERR_INVALID_STATE) {
+      // ドライバのプールがあふれて古いブロックが捨てられた（窓の値は残りのサンプルで求める）
+      portENTER_CRITICAL(&mux);
+      current_stats.overruns++;
+      portEXIT_CRITICAL(&mux);
+    } else if (result != ESP_OK) {
+      continue;
+    }
+    accumulate(block, length);
+    int64_t now = esp_timer_get_time();
+    busy_us += now - start;
+    portENTER_CRITICAL(&mux);
+    current_stats.blocks++;
+    portEXIT_CRITICAL(&mux);
+    if (now - window_start_us >= WINDOW_US) {
+      finish_window(now);
+    }
+  }
+}
+
+/**
+ * @brief ピンを ADC1 のチャネルにする
+ * @return ADC1 でなければ -1
+ */
+static int adc1_channel_of(int pin) {
+  int8_t channel = digitalPinToAnalogChannel(pin);
+  return channel >= 0 && channel < SOC_ADC_MAX_CHANNEL_NUM ? channel : -1;
+}
+
+bool begin(const Config &config) {
+  meter_config = config;
+  if (meter_config.channel_count > MAX_CHANNELS) {
+    meter_config.channel_count = MAX_CHANNELS;
+  }
+  for (int8_t &input : input_of_channel) {
+    input = NOT_USED;
+  }
+
+  // 電圧，電流1，電流2，... の順に変換する
+  adc_digi_pattern_config_t pattern[1 + MAX_CHANNELS] = {};
+  uint32_t channel_mask = 0;
+  uint8_t input_count = 1 + meter_config.channel_count;
+  for (uint8_t input = 0; input < input_count; input++) {
+    int pin = input == 0 ? meter_config.voltage_pin : meter_config.current_pins[input - 1];
+    int channel = adc1_channel_of(pin);
+    if (channel < 0) {
+      Serial.printf("power_meter: pin %d is not on ADC1\n", pin);
+      return false;
+    }
+    input_of_channel[channel] = static_cast<int8_t>(input);
+    channel_mask |= 1U << channel;
+    pattern[input].atten = ADC_ATTEN_DB_11;
+    pattern[input].channel = static_cast<uint8_t>(channel);
+    pattern[input].unit = 0;
+    pattern[input].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  }
+
+  adc_digi_init_config_t init_config = {};
+  init_config.max_store_buf_size = POOL_BYTES;
+  init_config.conv_num_each_intr = BLOCK_BYTES;
+  init_config.adc1_chan_mask = channel_mask;
+  init_config.adc2_chan_mask = 0;
+  if (adc_digi_initialize(&init_config) != ESP_OK) {
+    return false;
+  }
+
+  adc_digi_configuration_t digi_config = {};
+  digi_config.conv_limit_en = false;
+  digi_config.conv_limit_num = 250;
+  digi_config.pattern_num = input_count;
+  digi_config.adc_pattern = pattern;
+  digi_config.sample_freq_hz = SAMPLE_RATE_PER_INPUT_HZ * input_count;
+  digi_config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  digi_config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+  if (adc_digi_controller_configure(&digi_config) != ESP_OK || adc_digi_start() != ESP_OK) {
+    return false;
+  }
+  xTaskCreate(meter_task, "power", TASK_STACK_SIZE, nullptr, TASK_PRIORITY, nullptr);
+  return true;
+}
+
+Measurement measurement(uint8_t channel) {
+  Measurement result = {};
+  if (channel >= meter_config.channel_count) {
+    return result;
+  }
+  portENTER_CRITICAL(&mux);
+  result = published[channel];
+  portEXIT_CRITICAL(&mux);
+  return result;
+}
+
+Stats stats() {
+  portENTER_CRITICAL(&mux);
+  Stats result = current_stats;
+  portEXIT_CRITICAL(&mux);
+  return result;
+}
+
+} // namespace power_meter
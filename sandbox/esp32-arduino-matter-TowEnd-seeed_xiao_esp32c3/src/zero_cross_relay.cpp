@@ -0,0 +1,206 @@
+/**
+ * @file zero_cross_relay.cpp
+ * @brief リレーの接点を交流のゼロクロスで開閉するスケジューラ
+ */
+#include "zero_cross_relay.h"
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+namespace zero_cross_relay {
+
+// ゼロクロス検出の出力が負論理（フォトカプラがゼロクロスの前後でLにする）
+const bool ZERO_CROSS_ACTIVE_LOW = true;
+// 半周期として受け付ける範囲 [us]（50Hz: 10000，60Hz: 8333）．これより短い間隔は雑音として捨てる
+const int64_t MIN_HALF_PERIOD_US = 7000;
+const int64_t MAX_HALF_PERIOD_US = 12000;
+// ゼロクロスがこの時間来なければ交流がないとみなし，すぐに駆動する
+const int64_t MAINS_TIMEOUT_US = 100000;
+// 駆動の時刻は今からこれ以上先にする（タイマーを仕掛ける時間とタイマータスクの遅れの分）
+const int64_t MIN_LEAD_US = 300;
+// これだけ先までの駆動はまとめて行う（タイマーの遅れで次の周期に回さないように）
+const int64_t TIMER_SLACK_US = 50;
+// 測った動作時間として受け付ける範囲 [us]（接点のチャタリングや配線の雑音を捨てる）
+const uint32_t MIN_MEASURED_US = 1000;
+const uint32_t MAX_MEASURED_US = 30000;
+// 測った時間を平均に取り込む割合（1/2^n）
+const uint8_t AVERAGE_SHIFT = 2;
+
+/**
+ * @brief リレー1つ分の状態（mux で守る）
+ */
+struct Channel {
+  ChannelConfig config;
+  bool on;
+  bool pending;         ///< 駆動を待っている
+  bool awaiting_sense;  ///< 駆動したあと，接点が動くのを待っている
+  int64_t drive_at_us;  ///< 駆動する時刻
+  int64_t aim_at_us;    ///< 接点を動かしたいゼロクロスの時刻（交流がなければ駆動の時刻）
+  int64_t driven_at_us; ///< 実際に駆動した時刻
+  int32_t last_error_us;
+  uint32_t measurements;
+};
+
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+static Channel channels[MAX_CHANNELS];
+static uint8_t channel_count = 0;
+static int zero_cross_input = -1;
+static esp_timer_handle_t drive_timer = nullptr;
+
+// ゼロクロスの測定（mux で守る）
+static int64_t pulse_start_us = 0;
+static int64_t last_crossing_us = 0;
+static int64_t half_period = 0;
+
+/**
+ * @brief ゼロクロス検出のパルスの始まりと終わり．中点をゼロクロスとし，間隔の平均を半周期とする
+ */
+static void IRAM_ATTR on_zero_cross_edge() {
+  int64_t now = esp_timer_get_time();
+  bool active = (digitalRead(zero_cross_input) == LOW) == ZERO_CROSS_ACTIVE_LOW;
+  portENTER_CRITICAL_ISR(&mux);
+  if (active) {
+    pulse_start_us = now;
+  } else if (pulse_start_us != 0) {
+    int64_t crossing = (pulse_start_us + now) / 2;
+    int64_t interval = crossing - last_crossing_us;
+    pulse_start_us = 0;
+    if (interval >= MIN_HALF_PERIOD_US) {
+      if (interval <= MAX_HALF_PERIOD_US) {
+        half_period = half_period == 0 ? interval : half_period + (interval - half_period) / 8;
+      }
+      last_crossing_us = crossing;
+    }
+  }
+  portEXIT_CRITICAL_ISR(&mux);
+}
+
+/**
+ * @brief 空きの接点が動いた．駆動してから最初の変化だけを使う（あとはチャタリング）
+ */
+static void IRAM_ATTR on_sense_edge(void *arg) {
+  int64_t now = esp_timer_get_time();
+  Channel &channel = *static_cast<Channel *>(arg);
+  portENTER_CRITICAL_ISR(&mux);
+  if (channel.awaiting_sense) {
+    channel.awaiting_sense = false;
+    uint32_t measured = static_cast<uint32_t>(now - channel.driven_at_us);
+    if (measured >= MIN_MEASURED_US && measured <= MAX_MEASURED_US) {
+      uint32_t &average = channel.on ? channel.config.operate_us : channel.config.release_us;
+      average = static_cast<uint32_t>(static_cast<int32_t>(average) +
+                                      ((static_cast<int32_t>(measured) - static_cast<int32_t>(average)) >> AVERAGE_SHIFT));
+      channel.last_error_us = static_cast<int32_t>(now - channel.aim_at_us);
+      channel.measurements++;
+    }
+  }
+  portEXIT_CRITICAL_ISR(&mux);
+}
+
+/**
+ * @brief 一番早い駆動の時刻にタイマーを仕掛ける（mux の中で呼ぶ）
+ */
+static void arm_timer(int64_t now) {
+  int64_t earliest = INT64_MAX;
+  for (uint8_t i = 0; i < channel_count; i++) {
+    if (channels[i].pending && channels[i].drive_at_us < earliest) {
+      earliest = channels[i].drive_at_us;
+    }
+  }
+  esp_timer_stop(drive_timer);
+  if (earliest != INT64_MAX) {
+    int64_t wait = earliest - now;
+    esp_timer_start_once(drive_timer, wait > 0 ? static_cast<uint64_t>(wait) : 1);
+  }
+}
+
+/**
+ * @brief 駆動の時刻が来たリレーを動かす（esp_timer のタスクで呼ばれる）
+ */
+static void on_drive_timer(void *arg) {
+  portENTER_CRITICAL(&mux);
+  int64_t now = esp_timer_get_time();
+  for (uint8_t i = 0; i < channel_count; i++) {
+    Channel &channel = channels[i];
+    if (channel.pending && channel.drive_at_us <= now + TIMER_SLACK_US) {
+      digitalWrite(channel.config.relay_pin, channel.on ? HIGH : LOW);
+      channel.pending = false;
+      channel.driven_at_us = now;
+      channel.awaiting_sense = channel.config.sense_pin >= 0;
+    }
+  }
+  arm_timer(now);
+  portEXIT_CRITICAL(&mux);
+}
+
+void begin(int zero_cross_pin, const ChannelConfig *configs, uint8_t count) {
+  channel_count = count < MAX_CHANNELS ? count : MAX_CHANNELS;
+  for (uint8_t i = 0; i < channel_count; i++) {
+    channels[i] = {};
+    channels[i].config = configs[i];
+    pinMode(configs[i].relay_pin, OUTPUT);
+    digitalWrite(configs[i].relay_pin, LOW);
+    if (configs[i].sense_pin >= 0) {
+      pinMode(configs[i].sense_pin, INPUT_PULLUP);
+      attachInterruptArg(digitalPinToInterrupt(configs[i].sense_pin), on_sense_edge, &channels[i], CHANGE);
+    }
+  }
+
+  esp_timer_create_args_t timer_args = {};
+  timer_args.callback = on_drive_timer;
+  timer_args.name = "relay";
+  esp_timer_create(&timer_args, &drive_timer);
+
+  zero_cross_input = zero_cross_pin;
+  pinMode(zero_cross_pin, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(zero_cross_pin), on_zero_cross_edge, CHANGE);
+}
+
+void request(uint8_t channel_index, bool on) {
+  if (channel_index >= channel_count) {
+    return;
+  }
+  portENTER_CRITICAL(&mux);
+  int64_t now = esp_timer_get_time();
+  Channel &channel = channels[channel_index];
+  channel.on = on;
+  channel.pending = true;
+  int64_t delay = on ? channel.config.operate_us : channel.config.release_us;
+  if (half_period == 0 || now - last_crossing_us > MAINS_TIMEOUT_US) {
+    // 交流がない（直流の負荷や検出の故障）．待たずに駆動する
+    channel.drive_at_us = now;
+    channel.aim_at_us = now + delay;
+  } else {
+    // 接点が動く時刻がゼロクロスになるように，動作時間の分だけ前に駆動する
+    int64_t crossing = last_crossing_us;
+    while (crossing - delay < now + MIN_LEAD_US) {
+      crossing += half_period;
+    }
+    channel.aim_at_us = crossing;
+    channel.drive_at_us = crossing - delay;
+  }
+  arm_timer(now);
+  portEXIT_CRITICAL(&mux);
+}
+
+uint32_t half_period_us() {
+  portENTER_CRITICAL(&mux);
+  bool present = half_period != 0 && esp_timer_get_time() - last_crossing_us <= MAINS_TIMEOUT_US;
+  uint32_t period = present ? static_cast<uint32_t>(half_period) : 0;
+  portEXIT_CRITICAL(&mux);
+  return period;
+}
+
+ChannelStatus status(uint8_t channel_index) {
+  ChannelStatus result = {};
+  if (channel_index >= channel_count) {
+    return result;
+  }
+  portENTER_CRITICAL(&mux);
+  const Channel &channel = channels[channel_index];
+  result = {channel.on, channel.config.operate_us, channel.config.release_us, channel.last_error_us, channel.measurements};
+  portEXIT_CRITICAL(&mux);
+  return result;
+}
+
+} // namespace zero_cross_relay
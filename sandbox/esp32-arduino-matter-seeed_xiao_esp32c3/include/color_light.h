@@ -0,0 +1,112 @@
+/**
+ * @file color_light.h
+ * @brief ColorControl の色と明るさを，表を引いてLEDのPWMにする（RGB と調色の白）
+ *
+ * @details
+ * 色（色相・彩度，xy，色温度）と明るさから各チャネルのデューティを求めるのに浮動小数点は使わず，
+ * 前もって計算した固定小数点の表（color_tables.h）を引いて補間するだけにする．
+ * 1回の更新の計算は色の方式やトランジションの長さによらずほぼ一定で，stats() で実際のサイクル数を見られる．
+ *
+ * トランジション（MoveToHue などの遷移時間）は Matter のクラスターサーバーが属性を 100ms ごとに少しずつ更新して行う．
+ * ここでは更新のたびに，今のデューティから新しいデューティへ LEDC のハードウェアフェードを全チャネル同時に掛けるので，
+ * 段の間もなめらかに変わり，CPUはフェードの途中の値を計算しない．
+ * フェードはLEDタスクが掛ける（フェードの途中のチャネルには次のフェードを掛けられず待たされるので，
+ * 属性を更新する Matter のタスクを止めないように）．LEDタスクが待っている間の更新は最後のものだけを使う．
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace color_light {
+
+// チャネルの数の上限（RGB）
+const uint8_t MAX_OUTPUTS = 3;
+// デューティの分解能 [bit]（LEDC は 80MHz / 2^13 で約 9.7kHz まで）
+const uint8_t DUTY_BITS = 13;
+const uint32_t DUTY_MAX = (1U << DUTY_BITS) - 1;
+
+/**
+ * @brief 器具の種類
+ */
+enum class Fixture : uint8_t {
+    RGB,           ///< 赤・緑・青のLED（色相・彩度，xy，色温度）
+    TUNABLE_WHITE, ///< 暖色と寒色の白のLED（色温度だけ）
+};
+
+/**
+ * @brief 色の方式（ColorControl の ColorMode の値）
+ */
+enum class ColorMode : uint8_t {
+    HUE_SATURATION = 0,
+    XY = 1,
+    COLOR_TEMPERATURE = 2,
+};
+
+/**
+ * @brief 器具の設定
+ */
+struct Config {
+    Fixture fixture;
+    const int *pins;       ///< 出力のピン．RGB は赤・緑・青，調色は暖色・寒色の順
+    const uint16_t *gains; ///< チャネルごとのホワイトバランスの係数（Q12．4096 で補正なし）．nullptr なら補正しない
+    uint32_t pwm_hz;       ///< PWMの周波数
+    uint16_t fade_ms;      ///< 1回の更新で掛けるフェードの時間（サーバーがトランジションの属性を更新する間隔）
+};
+
+/**
+ * @brief 明るさと色（ColorControl と LevelControl と OnOff の属性の値）
+ */
+struct State {
+    bool on;
+    uint8_t level;      ///< CurrentLevel（0〜254）
+    ColorMode mode;
+    uint8_t hue;        ///< CurrentHue（0〜254）
+    uint8_t saturation; ///< CurrentSaturation（0〜254）
+    uint16_t x;         ///< CurrentX（Q16）
+    uint16_t y;         ///< CurrentY（Q16）
+    uint16_t mireds;    ///< ColorTemperatureMireds
+};
+
+/**
+ * @brief 更新の統計
+ */
+struct Stats {
+    uint32_t updates;      ///< 色や明るさの更新の回数
+    uint32_t last_cycles;  ///< 直近の更新で，デューティを求めてLEDタスクに渡すまでのCPUサイクル
+    uint32_t max_cycles;   ///< その最大
+    uint64_t total_cycles; ///< その合計（平均を求める）
+    uint32_t fades;        ///< 掛けたフェードの回数（全チャネルで1回）
+    uint32_t coalesced;    ///< LEDタスクが待っている間に，次の更新で置き換えられた更新の数
+};
+
+/**
+ * @brief LEDC とLEDタスクを設定し，initial の明るさと色で点ける
+ */
+void begin(const Config &config, const State &initial);
+
+/**
+ * @brief 属性の更新を反映する（どのタスクからでもよい．すぐに戻る）
+ *
+ * 色相・彩度，xy，色温度を変えると，その色の方式に切り替わる．
+ */
+void set_on(bool on);
+void set_level(uint8_t level);
+void set_mode(ColorMode mode);
+void set_hue(uint8_t hue);
+void set_saturation(uint8_t saturation);
+void set_x(uint16_t x);
+void set_y(uint16_t y);
+void set_mireds(uint16_t mireds);
+
+/**
+ * @brief 明るさと色からデューティを求める（表を引くだけ）
+ * @param duties 出力ごとのデューティ（RGB は3つ，調色は2つ）
+ */
+void compute_duties(Fixture fixture, const State &state, const uint16_t *gains, uint16_t duties[MAX_OUTPUTS]);
+
+/**
+ * @brief 統計
+ */
+Stats stats();
+
+} // namespace color_light
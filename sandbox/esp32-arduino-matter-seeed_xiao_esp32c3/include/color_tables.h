@@ -0,0 +1,39 @@
+/**
+ * @file color_tables.h
+ * @brief 色の変換表（固定小数点）
+ *
+ * @details
+ * 中身は tools/color_tables.py が src/color_tables.cpp に生成する．大きさを変えるときは両方を合わせること．
+ * 値はどれも光の強さ（リニア）で，ONE が 1．RGB の表は一番明るいチャネルが ONE．
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace color_tables {
+
+// 割合の 1（Q12）
+const uint16_t ONE = 4096;
+
+// Matter の明るさ（0〜254）→ 光の強さ（Q16）．段を CIE の明度で等間隔にする
+const uint16_t LEVEL_COUNT = 255;
+extern const uint16_t LEVEL_TO_LINEAR[LEVEL_COUNT];
+
+// Matter の色相（0〜254）→ 彩度最大の RGB
+const uint16_t HUE_COUNT = 255;
+extern const uint16_t HUE_TO_RGB[HUE_COUNT][3];
+
+// 色度 xy（Q16）→ RGB．格子は 1 << XY_SHIFT ごとで，間は双線形に補間する
+const uint8_t XY_SHIFT = 11;
+const uint16_t XY_GRID = (65536 >> XY_SHIFT) + 1;
+extern const uint16_t XY_TO_RGB[XY_GRID][XY_GRID][3];
+
+// 色温度 [mired] → 黒体軌跡の RGB と，調色のLEDの寒色の割合．MIRED_MIN から 1 << MIRED_SHIFT ごと
+const uint16_t MIRED_MIN = 152;
+const uint8_t MIRED_SHIFT = 3;
+const uint16_t MIRED_COUNT = 45;
+const uint16_t MIRED_MAX = MIRED_MIN + ((MIRED_COUNT - 1) << MIRED_SHIFT);
+extern const uint16_t MIRED_TO_RGB[MIRED_COUNT][3];
+extern const uint16_t MIRED_TO_COOL[MIRED_COUNT];
+
+} // namespace color_tables
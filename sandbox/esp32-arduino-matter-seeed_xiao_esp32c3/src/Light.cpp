@@ -3,9 +3,11 @@
  * @brief Matterとトグルボタンで制御するLEDライトデバイスの実装例
  * 
  * このプログラムは、LEDをMatterとトグルボタンで制御することにより、OnOffクラスターを持つMatterライトデバイスの例を示します。
+ * 明るさ（LevelControl）と色（ColorControl）も持ち，RGB のLEDか調色（暖色と寒色の白）のLEDを点けます（FIXTURE で選ぶ）。
+ * 色の変換は前もって計算した表を引くだけで，トランジションは LEDC のハードウェアフェードでつなぎます（color_light.h）。
  * 
  * @details
- * - ESPにビルドインLEDがない場合は、LED_PINに接続してください。
+ * - LEDは LED_PINS に接続してください（RGB は赤・緑・青，調色は暖色・寒色の順）。
  * - ライトをトグルする方法は以下の通りです：
  *   - Matter（CHIPToolや他のMatterコントローラーを介して）
  *   - トグルボタン（デフォルトではGPIO0 - リセットボタンに接
@@ -32,15 +34,36 @@
 #include "Matter.h"
 #include <app/server/OnboardingCodesUtil.h>
 #include <credentials/examples/DeviceAttestationCredsExample.h>
+#include "color_light.h"
 using namespace chip;
 using namespace chip::app::Clusters;
 using namespace esp_matter;
 using namespace esp_matter::endpoint;
 
+// 器具の種類（RGB か調色）
+const color_light::Fixture FIXTURE = color_light::Fixture::RGB;
+
 // PINを設定してください
-const int LED_PIN = D0;
+const int LED_PINS[] = {D0, D1, D2};
 const int TOGGLE_BUTTON_PIN = D9;
 
+// LEDのPWM
+const uint32_t PWM_HZ = 5000;
+// 1回の属性の更新で掛けるフェード [ms]（クラスターサーバーがトランジションの途中の値を更新する間隔に合わせる）
+const uint16_t FADE_MS = 100;
+// チャネルごとのホワイトバランス（Q12）．白（彩度0）を点けて色がずれていれば明るすぎるチャネルを下げる
+const uint16_t WHITE_BALANCE[] = {4096, 4096, 4096};
+// 出せる色温度の範囲 [mired]．RGB は黒体軌跡の表の範囲，調色はLEDの色温度（6500K と 2700K）
+const uint16_t RGB_MIN_MIREDS = 153;
+const uint16_t RGB_MAX_MIREDS = 500;
+const uint16_t TUNABLE_WHITE_MIN_MIREDS = 154;
+const uint16_t TUNABLE_WHITE_MAX_MIREDS = 370;
+// 起動したときの明るさと色
+const uint8_t INITIAL_LEVEL = 254;
+const uint16_t INITIAL_MIREDS = 250;
+// 更新のCPUサイクルを表示する間隔 [ms]
+const unsigned long STATS_INTERVAL = 10000;
+
 // トグルボタンのデバウンス
 const int DEBOUNCE_DELAY = 500;
 int last_toggle;
@@ -96,11 +119,38 @@ static esp_err_t on_identification(identification::callback_type_t type, uint16_
   */
 static esp_err_t on_attribute_update(attribute::callback_type_t type, uint16_t endpoint_id, uint32_t cluster_id,
                    uint32_t attribute_id, esp_matter_attr_val_t *val, void *priv_data) {
-    if (type == attribute::PRE_UPDATE && endpoint_id == light_endpoint_id &&
-        cluster_id == CLUSTER_ID && attribute_id == ATTRIBUTE_ID) {
+    if (type != attribute::PRE_UPDATE || endpoint_id != light_endpoint_id) {
+        return ESP_OK;
+    }
+    if (cluster_id == CLUSTER_ID && attribute_id == ATTRIBUTE_ID) {
         // ライトのオン/オフ属性の更新を受け取りました！
-        bool new_state = val->val.b;
-        digitalWrite(LED_PIN, new_state);
+        color_light::set_on(val->val.b);
+    } else if (cluster_id == LevelControl::Id && attribute_id == LevelControl::Attributes::CurrentLevel::Id) {
+        color_light::set_level(val->val.u8);
+    } else if (cluster_id == ColorControl::Id) {
+        // トランジションの間は，クラスターサーバーが途中の値をここに送ってくる
+        switch (attribute_id) {
+        case ColorControl::Attributes::CurrentHue::Id:
+            color_light::set_hue(val->val.u8);
+            break;
+        case ColorControl::Attributes::CurrentSaturation::Id:
+            color_light::set_saturation(val->val.u8);
+            break;
+        case ColorControl::Attributes::CurrentX::Id:
+            color_light::set_x(val->val.u16);
+            break;
+        case ColorControl::Attributes::CurrentY::Id:
+            color_light::set_y(val->val.u16);
+            break;
+        case ColorControl::Attributes::ColorTemperatureMireds::Id:
+            color_light::set_mireds(val->val.u16);
+            break;
+        case ColorControl::Attributes::ColorMode::Id:
+            color_light::set_mode(static_cast<color_light::ColorMode>(val->val.u8));
+            break;
+        default:
+            break;
+        }
     }
     return ESP_OK;
 }
@@ -173,15 +223,72 @@ void ResetNodeId() {
     ChipLogProgress(DeviceLayer, "Node ID reset successfully.");
 }
 
+/**
+ * @brief 色温度の範囲（ColorTempPhysicalMin/MaxMireds）を器具に合わせる
+ * @param endpoint ライトのエンドポイント
+ * @param min_mireds 一番高い色温度 [mired]
+ * @param max_mireds 一番低い色温度 [mired]
+ */
+static void set_color_temperature_range(endpoint_t *endpoint, uint16_t min_mireds, uint16_t max_mireds) {
+    cluster_t *color_cluster = cluster::get(endpoint, ColorControl::Id);
+    const struct {
+        uint32_t attribute_id;
+        uint16_t value;
+    } limits[] = {
+        {ColorControl::Attributes::ColorTempPhysicalMinMireds::Id, min_mireds},
+        {ColorControl::Attributes::ColorTempPhysicalMaxMireds::Id, max_mireds},
+    };
+    for (const auto &limit : limits) {
+        attribute_t *limit_attribute = attribute::get(color_cluster, limit.attribute_id);
+        if (limit_attribute != NULL) {
+            esp_matter_attr_val_t value = esp_matter_uint16(limit.value);
+            attribute::set_val(limit_attribute, &value);
+        }
+    }
+}
+
+/**
+ * @brief ライトのエンドポイントを器具の種類に合わせて作る
+ * 
+ * RGB は拡張カラーライト（色温度と xy に色相・彩度を足す），調色は色温度ライト．
+ * @param node Matterノード
+ * @return ライトのエンドポイント
+ */
+static endpoint_t *create_light_endpoint(node_t *node) {
+    if (FIXTURE == color_light::Fixture::TUNABLE_WHITE) {
+        color_temperature_light::config_t light_config;
+        light_config.on_off.on_off = false;
+        light_config.on_off.lighting.start_up_on_off = false;
+        light_config.level_control.current_level = INITIAL_LEVEL;
+        light_config.color_control.color_mode = static_cast<uint8_t>(color_light::ColorMode::COLOR_TEMPERATURE);
+        light_config.color_control.enhanced_color_mode = static_cast<uint8_t>(color_light::ColorMode::COLOR_TEMPERATURE);
+        endpoint_t *endpoint = color_temperature_light::create(node, &light_config, ENDPOINT_FLAG_NONE, NULL);
+        set_color_temperature_range(endpoint, TUNABLE_WHITE_MIN_MIREDS, TUNABLE_WHITE_MAX_MIREDS);
+        return endpoint;
+    }
+
+    extended_color_light::config_t light_config;
+    light_config.on_off.on_off = false;
+    light_config.on_off.lighting.start_up_on_off = false;
+    light_config.level_control.current_level = INITIAL_LEVEL;
+    light_config.color_control.color_mode = static_cast<uint8_t>(color_light::ColorMode::COLOR_TEMPERATURE);
+    light_config.color_control.enhanced_color_mode = static_cast<uint8_t>(color_light::ColorMode::COLOR_TEMPERATURE);
+    endpoint_t *endpoint = extended_color_light::create(node, &light_config, ENDPOINT_FLAG_NONE, NULL);
+    cluster::color_control::feature::hue_saturation::config_t hue_saturation_config;
+    cluster::color_control::feature::hue_saturation::add(cluster::get(endpoint, ColorControl::Id), &hue_saturation_config);
+    set_color_temperature_range(endpoint, RGB_MIN_MIREDS, RGB_MAX_MIREDS);
+    return endpoint;
+}
+
 /**
  * @brief Matterノードを初期化し、ライトエンドポイントを設定するためのセットアップ関数。
  * 
  * この関数は以下のタスクを実行します：
  * - シリアル通信を115200ボーで初期化します。
- * - LEDピンを出力として、トグルボタンピンを入力として設定します。
+ * - LEDのPWMとフェードを設定し、トグルボタンピンを入力として設定します。
  * - すべてのコンポーネントのデバッグログを有効にします。
  * - 指定された設定とコールバック関数を使用してMatterノードをセットアップします。
- * - オン/オフクラスターと属性のデフォルト値でライトエンドポイントを設定します。
+ * - オン/オフ，明るさ，色のクラスターと属性のデフォルト値でライトエンドポイントを設定します。
  * - 後で使用するためにオン/オフ属性の参照を保存します。
  * - ライトエンドポイントの生成されたエンドポイントIDを保存します。
  * - カスタムコミッショニングデータを使用してDAC（デバイス認証証明書）を設定します。
@@ -192,7 +299,12 @@ void setup() {
 
     Serial.println("--- Start Settings ---");
 
-    pinMode(LED_PIN, OUTPUT);
+    color_light::State initial_state = {};
+    initial_state.on = false;
+    initial_state.level = INITIAL_LEVEL;
+    initial_state.mode = color_light::ColorMode::COLOR_TEMPERATURE;
+    initial_state.mireds = INITIAL_MIREDS;
+    color_light::begin({FIXTURE, LED_PINS, WHITE_BALANCE, PWM_HZ, FADE_MS}, initial_state);
     pinMode(TOGGLE_BUTTON_PIN, INPUT);
 
     Serial.println("Start Matter Settings"); 
@@ -218,10 +330,7 @@ void setup() {
 
     // デフォルト値でライトエンドポイント/クラスター/属性をセットアップする
     Serial.println("Setup Light Endpoint");
-    on_off_light::config_t light_config;
-    light_config.on_off.on_off = false;
-    light_config.on_off.lighting.start_up_on_off = false;
-    endpoint_t *endpoint = on_off_light::create(node, &light_config, ENDPOINT_FLAG_NONE, NULL);
+    endpoint_t *endpoint = create_light_endpoint(node);
 
     // オン/オフ属性の参照を保存します。後で属性値を読み取るために使用されます。
     attribute_ref = attribute::get(cluster::get(endpoint, CLUSTER_ID), ATTRIBUTE_ID);
@@ -265,11 +374,36 @@ void set_onoff_attribute_value(esp_matter_attr_val_t* onoff_value) {
     attribute::update(light_endpoint_id, CLUSTER_ID, ATTRIBUTE_ID, onoff_value);
 }
 
+/**
+  * @brief 色と明るさの更新にかかったCPUサイクルを，更新があれば一定の間隔で表示する。
+  * トランジションの長さによらず，1回の更新の平均と最大はほぼ一定になる。
+  */
+void print_light_stats() {
+    static unsigned long last_print = 0;
+    static uint32_t last_updates = 0;
+    if (millis() - last_print < STATS_INTERVAL) {
+        return;
+    }
+    last_print = millis();
+    color_light::Stats stats = color_light::stats();
+    if (stats.updates == last_updates) {
+        return;
+    }
+    last_updates = stats.updates;
+    Serial.printf("light: %lu updates, cycles avg %lu max %lu, %lu fades, %lu coalesced\n",
+                  static_cast<unsigned long>(stats.updates),
+                  static_cast<unsigned long>(stats.total_cycles / stats.updates),
+                  static_cast<unsigned long>(stats.max_cycles), static_cast<unsigned long>(stats.fades),
+                  static_cast<unsigned long>(stats.coalesced));
+}
+
 /**
   * @brief メインループ。
   * トグルライトボタンが押されたとき（デバウンス処理付き），ライトのオン/オフ属性値を変更します。
+  * 色と明るさの更新にかかったCPUサイクルを表示します。
   */
 void loop() {
+    print_light_stats();
     if ((millis() - last_toggle) > DEBOUNCE_DELAY) {
         if (!digitalRead(TOGGLE_BUTTON_PIN)) {
             last_toggle = millis();
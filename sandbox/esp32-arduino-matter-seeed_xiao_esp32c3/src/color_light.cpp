@@ -0,0 +1,293 @@
+/**
+ * @file color_light.cpp
+ * @brief ColorControl の色と明るさを，表を引いてLEDのPWMにする（RGB と調色の白）
+ */
+#include "color_light.h"
+
+#include <Arduino.h>
+#include <driver/ledc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "color_tables.h"
+
+namespace color_light {
+
+using color_tables::ONE;
+
+const ledc_mode_t SPEED_MODE = LEDC_LOW_SPEED_MODE;
+const ledc_timer_t TIMER = LEDC_TIMER_0;
+// LEDタスク．フェードを掛けたら次の更新まで寝ている
+const uint32_t TASK_STACK_SIZE = 2048;
+const UBaseType_t TASK_PRIORITY = 2;
+// 明るさ（Q16）× 割合（Q12）をデューティ（DUTY_BITS）にするシフト
+const uint8_t DUTY_SHIFT = 16 + 12 - DUTY_BITS;
+
+static Config light_config = {};
+static uint8_t output_count = 0;
+static TaskHandle_t fade_task = nullptr;
+
+// 属性の値と，LEDタスクに渡すデューティ（mux で守る）
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+static State state = {};
+static uint16_t pending_duties[MAX_OUTPUTS] = {};
+static bool pending = false;
+static Stats current_stats = {};
+
+/**
+ * @brief a から b へ fraction / 2^shift だけ進んだ値
+ */
+static inline int32_t lerp(int32_t a, int32_t b, uint32_t fraction, uint8_t shift) {
+    return a + (((b - a) * static_cast<int32_t>(fraction)) >> shift);
+}
+
+/**
+ * @brief 色温度の表の位置（範囲の外は端にそろえる）
+ */
+static void mired_index(uint16_t mireds, uint16_t &index, uint32_t &fraction) {
+    if (mireds < color_tables::MIRED_MIN) {
+        mireds = color_tables::MIRED_MIN;
+    } else if (mireds > color_tables::MIRED_MAX) {
+        mireds = color_tables::MIRED_MAX;
+    }
+    uint16_t offset = mireds - color_tables::MIRED_MIN;
+    index = offset >> color_tables::MIRED_SHIFT;
+    fraction = offset & ((1U << color_tables::MIRED_SHIFT) - 1);
+    if (index >= color_tables::MIRED_COUNT - 1) {
+        index = color_tables::MIRED_COUNT - 2;
+        fraction = 1U << color_tables::MIRED_SHIFT;
+    }
+}
+
+/**
+ * @brief 色相・彩度の RGB．彩度の分だけ白（ONE, ONE, ONE）に寄せる
+ */
+static void hue_saturation_rgb(uint8_t hue, uint8_t saturation, int32_t rgb[3]) {
+    const uint16_t *pure = color_tables::HUE_TO_RGB[hue < color_tables::HUE_COUNT ? hue : color_tables::HUE_COUNT - 1];
+    uint32_t amount = (saturation < 254 ? saturation : 254) * ONE / 254;
+    for (uint8_t c = 0; c < 3; c++) {
+        rgb[c] = ONE - static_cast<int32_t>(((ONE - pure[c]) * amount) >> 12);
+    }
+}
+
+/**
+ * @brief xy の RGB（格子の4点から双線形に補間する）
+ */
+static void xy_rgb(uint16_t x, uint16_t y, int32_t rgb[3]) {
+    const uint32_t mask = (1U << color_tables::XY_SHIFT) - 1;
+    uint16_t ix = x >> color_tables::XY_SHIFT;
+    uint16_t iy = y >> color_tables::XY_SHIFT;
+    uint32_t fx = x & mask;
+    uint32_t fy = y & mask;
+    for (uint8_t c = 0; c < 3; c++) {
+        int32_t low = lerp(color_tables::XY_TO_RGB[ix][iy][c], color_tables::XY_TO_RGB[ix + 1][iy][c], fx, color_tables::XY_SHIFT);
+        int32_t high = lerp(color_tables::XY_TO_RGB[ix][iy + 1][c], color_tables::XY_TO_RGB[ix + 1][iy + 1][c], fx, color_tables::XY_SHIFT);
+        rgb[c] = lerp(low, high, fy, color_tables::XY_SHIFT);
+    }
+}
+
+/**
+ * @brief 色温度の RGB（黒体軌跡）
+ */
+static void mired_rgb(uint16_t mireds, int32_t rgb[3]) {
+    uint16_t index;
+    uint32_t fraction;
+    mired_index(mireds, index, fraction);
+    for (uint8_t c = 0; c < 3; c++) {
+        rgb[c] = lerp(color_tables::MIRED_TO_RGB[index][c], color_tables::MIRED_TO_RGB[index + 1][c], fraction,
+                      color_tables::MIRED_SHIFT);
+    }
+}
+
+/**
+ * @brief 割合（Q12）と明るさ（Q16）とホワイトバランスからデューティを求める
+ */
+static uint16_t to_duty(int32_t fraction, uint32_t luminance, uint16_t gain) {
+    uint32_t duty = (static_cast<uint32_t>(fraction) * luminance) >> DUTY_SHIFT;
+    duty = (duty * gain) >> 12;
+    return static_cast<uint16_t>(duty < DUTY_MAX ? duty : DUTY_MAX);
+}
+
+void compute_duties(Fixture fixture, const State &light, const uint16_t *gains, uint16_t duties[MAX_OUTPUTS]) {
+    uint8_t level = light.level < color_tables::LEVEL_COUNT ? light.level : color_tables::LEVEL_COUNT - 1;
+    uint32_t luminance = light.on ? color_tables::LEVEL_TO_LINEAR[level] : 0;
+    int32_t fractions[MAX_OUTPUTS] = {};
+    uint8_t count;
+    if (fixture == Fixture::TUNABLE_WHITE) {
+        // 色温度だけ．寒色と暖色の光を合わせて明るさにする
+        uint16_t index;
+        uint32_t fraction;
+        mired_index(light.mireds, index, fraction);
+        int32_t cool = lerp(color_tables::MIRED_TO_COOL[index], color_tables::MIRED_TO_COOL[index + 1], fraction,
+                            color_tables::MIRED_SHIFT);
+        fractions[0] = ONE - cool;
+        fractions[1] = cool;
+        count = 2;
+    } else {
+        if (light.mode == ColorMode::HUE_SATURATION) {
+            hue_saturation_rgb(light.hue, light.saturation, fractions);
+        } else if (light.mode == ColorMode::XY) {
+            xy_rgb(light.x, light.y, fractions);
+        } else {
+            mired_rgb(light.mireds, fractions);
+        }
+        count = 3;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        duties[i] = to_duty(fractions[i], luminance, gains == nullptr ? ONE : gains[i]);
+    }
+}
+
+/**
+ * @brief 今の属性の値からデューティを求めてLEDタスクに渡し，かかったサイクル数を数える
+ */
+static void apply() {
+    uint32_t start = ESP.getCycleCount();
+    portENTER_CRITICAL(&mux);
+    bool replaced = pending;
+    compute_duties(light_config.fixture, state, light_config.gains, pending_duties);
+    pending = true;
+    portEXIT_CRITICAL(&mux);
+    if (fade_task != nullptr) {
+        xTaskNotifyGive(fade_task);
+    }
+    uint32_t cycles = ESP.getCycleCount() - start;
+
+    portENTER_CRITICAL(&mux);
+    current_stats.updates++;
+    if (replaced) {
+        current_stats.coalesced++;
+    }
+    current_stats.last_cycles = cycles;
+    current_stats.total_cycles += cycles;
+    if (cycles > current_stats.max_cycles) {
+        current_stats.max_cycles = cycles;
+    }
+    portEXIT_CRITICAL(&mux);
+}
+
+/**
+ * @brief 渡されたデューティへ全チャネルのフェードを掛ける
+ *
+ * フェードの途中のチャネルに掛けると，そのフェードが終わるまで ledc のドライバで待たされる．
+ */
+static void fade_loop(void *arg) {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint16_t duties[MAX_OUTPUTS];
+        portENTER_CRITICAL(&mux);
+        bool has_duties = pending;
+        pending = false;
+        for (uint8_t i = 0; i < output_count; i++) {
+            duties[i] = pending_duties[i];
+        }
+        portEXIT_CRITICAL(&mux);
+        if (!has_duties) {
+            continue;
+        }
+        for (uint8_t i = 0; i < output_count; i++) {
+            ledc_set_fade_time_and_start(SPEED_MODE, static_cast<ledc_channel_t>(i), duties[i], light_config.fade_ms,
+                                         LEDC_FADE_NO_WAIT);
+        }
+        portENTER_CRITICAL(&mux);
+        current_stats.fades++;
+        portEXIT_CRITICAL(&mux);
+    }
+}
+
+void begin(const Config &config, const State &initial) {
+    light_config = config;
+    output_count = config.fixture == Fixture::TUNABLE_WHITE ? 2 : 3;
+    state = initial;
+    uint16_t duties[MAX_OUTPUTS] = {};
+    compute_duties(config.fixture, initial, config.gains, duties);
+
+    ledc_timer_config_t timer_config = {};
+    timer_config.speed_mode = SPEED_MODE;
+    timer_config.duty_resolution = static_cast<ledc_timer_bit_t>(DUTY_BITS);
+    timer_config.timer_num = TIMER;
+    timer_config.freq_hz = config.pwm_hz;
+    timer_config.clk_cfg = LEDC_AUTO_CLK;
+    ledc_timer_config(&timer_config);
+    for (uint8_t i = 0; i < output_count; i++) {
+        ledc_channel_config_t channel_config = {};
+        channel_config.gpio_num = config.pins[i];
+        channel_config.speed_mode = SPEED_MODE;
+        channel_config.channel = static_cast<ledc_channel_t>(i);
+        channel_config.timer_sel = TIMER;
+        channel_config.duty = duties[i];
+        channel_config.hpoint = 0;
+        ledc_channel_config(&channel_config);
+    }
+    ledc_fade_func_install(0);
+    xTaskCreate(fade_loop, "light", TASK_STACK_SIZE, nullptr, TASK_PRIORITY, &fade_task);
+}
+
+void set_on(bool on) {
+    portENTER_CRITICAL(&mux);
+    state.on = on;
+    portEXIT_CRITICAL(&mux);
+    apply();
+}
+
+void set_level(uint8_t level) {
+    portENTER_CRITICAL(&mux);
+    state.level = level;
+    portEXIT_CRITICAL(&mux);
+    apply();
+}
+
+void set_mode(ColorMode mode) {
+    portENTER_CRITICAL(&mux);
+    state.mode = mode;
+    portEXIT_CRITICAL(&mux);
+    apply();
+}
+
+void set_hue(uint8_t hue) {
+    portENTER_CRITICAL(&mux);
+    state.hue = hue;
+    state.mode = ColorMode::HUE_SATURATION;
+    portEXIT_CRITICAL(&mux);
+    apply();
+}
+
+void set_saturation(uint8_t saturation) {
+    portENTER_CRITICAL(&mux);
+    state.saturation = saturation;
+    state.mode = ColorMode::HUE_SATURATION;
+    portEXIT_CRITICAL(&mux);
+    apply();
+}
+
+void set_x(uint16_t x) {
+    portENTER_CRITICAL(&mux);
+    state.x = x;
+    state.mode = ColorMode::XY;
+    portEXIT_CRITICAL(&mux);
+    apply();
+}
+
+void set_y(uint16_t y) {
+    portENTER_CRITICAL(&mux);
+    state.y = y;
+    state.mode = ColorMode::XY;
+    portEXIT_CRITICAL(&mux);
+    apply();
+}
+
+void set_mireds(uint16_t mireds) {
+    portENTER_CRITICAL(&mux);
+    state.mireds = mireds;
+    state.mode = ColorMode::COLOR_TEMPERATURE;
+    portEXIT_CRITICAL(&mux);
+    apply();
+}
+
+Stats stats() {
+    portENTER_CRITICAL(&mux);
+    Stats result = current_stats;
+    portEXIT_CRITICAL(&mux);
+    return result;
+}
+
+} // namespace color_light
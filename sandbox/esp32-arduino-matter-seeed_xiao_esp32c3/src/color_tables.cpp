@@ -0,0 +1,489 @@
+/**
+ * @file color_tables.cpp
+ * @brief 色の変換表（tools/color_tables.py で生成．手で書き換えないこと）
+ */
+#include "color_tables.h"
+
+namespace color_tables {
+
+const uint16_t LEVEL_TO_LINEAR[LEVEL_COUNT] = {
+    0, 29, 57, 86, 114, 143, 171, 200, 229, 257, 286, 314,
+    343, 371, 400, 428, 457, 486, 514, 543, 571, 600, 630, 660,
+    692, 725, 758, 793, 829, 865, 903, 942, 982, 1023, 1065, 1109,
+    1153, 1199, 1246, 1294, 1344, 1394, 1446, 1499, 1554, 1609, 1666, 1725,
+    1784, 1845, 1908, 1972, 2037, 2104, 2172, 2241, 2312, 2385, 2459, 2535,
+    2612, 2690, 2770, 2852, 2936, 3021, 3107, 3195, 3285, 3377, 3470, 3565,
+    3662, 3760, 3860, 3962, 4066, 4171, 4279, 4388, 4499, 4611, 4726, 4843,
+    4961, 5081, 5204, 5328, 5454, 5582, 5713, 5845, 5979, 6115, 6253, 6394,
+    6536, 6681, 6828, 6976, 7127, 7280, 7436, 7593, 7753, 7915, 8079, 8245,
+    8414, 8585, 8758, 8934, 9112, 9292, 9475, 9660, 9847, 10037, 10229, 10424,
+    10621, 10820, 11023, 11227, 11434, 11644, 11856, 12071, 12288, 12508, 12730, 12955,
+    13183, 13414, 13647, 13883, 14121, 14362, 14606, 14853, 15102, 15354, 15609, 15867,
+    16128, 16391, 16658, 16927, 17199, 17474, 17752, 18033, 18316, 18603, 18893, 19185,
+    19481, 19780, 20082, 20386, 20694, 21005, 21319, 21637, 21957, 22280, 22607, 22937,
+    23270, 23606, 23945, 24288, 24634, 24983, 25336, 25691, 26050, 26413, 26779, 27148,
+    27520, 27896, 28275, 28658, 29044, 29434, 29827, 30223, 30623, 31027, 31434, 31845,
+    32259, 32677, 33098, 33523, 33952, 34384, 34820, 35259, 35703, 36150, 36600, 37055,
+    37513, 37975, 38440, 38910, 39383, 39860, 40341, 40826, 41315, 41807, 42304, 42804,
+    43308, 43817, 44329, 44845, 45365, 45889, 46417, 46950, 47486, 48026, 48571, 49119,
+    49672, 50229, 50790, 51355, 51924, 52497, 53075, 53657, 54243, 54833, 55428, 56027,
+    56630, 57238, 57849, 58466, 59086, 59711, 60340, 60974, 61612, 62255, 62902, 63553,
+    64209, 64870, 65535,
+};
+
+const uint16_t HUE_TO_RGB[HUE_COUNT][3] = {
+    {4096, 0, 0}, {4096, 7, 0}, {4096, 15, 0}, {4096, 25, 0},
+    {4096, 38, 0}, {4096, 54, 0}, {4096, 73, 0}, {4096, 96, 0},
+    {4096, 122, 0}, {4096, 152, 0}, {4096, 187, 0}, {4096, 225, 0},
+    {4096, 268, 0}, {4096, 315, 0}, {4096, 366, 0}, {4096, 422, 0},
+    {4096, 483, 0}, {4096, 549, 0}, {4096, 619, 0}, {4096, 695, 0},
+    {4096, 776, 0}, {4096, 862, 0}, {4096, 953, 0}, {4096, 1050, 0},
+    {4096, 1152, 0}, {4096, 1260, 0}, {4096, 1374, 0}, {4096, 1493, 0},
+    {4096, 1618, 0}, {4096, 1749, 0}, {4096, 1886, 0}, {4096, 2029, 0},
+    {4096, 2178, 0}, {4096, 2334, 0}, {4096, 2495, 0}, {4096, 2663, 0},
+    {4096, 2838, 0}, {4096, 3019, 0}, {4096, 3206, 0}, {4096, 3400, 0},
+    {4096, 3601, 0}, {4096, 3809, 0}, {4096, 4023, 0}, {3951, 4096, 0},
+    {3739, 4096, 0}, {3533, 4096, 0}, {3335, 4096, 0}, {3143, 4096, 0},
+    {2958, 4096, 0}, {2779, 4096, 0}, {2607, 4096, 0}, {2441, 4096, 0},
+    {2281, 4096, 0}, {2128, 4096, 0}, {1981, 4096, 0}, {1840, 4096, 0},
+    {1705, 4096, 0}, {1576, 4096, 0}, {1452, 4096, 0}, {1335, 4096, 0},
+    {1223, 4096, 0}, {1118, 4096, 0}, {1017, 4096, 0}, {922, 4096, 0},
+    {833, 4096, 0}, {748, 4096, 0}, {669, 4096, 0}, {595, 4096, 0},
+    {526, 4096, 0}, {462, 4096, 0}, {403, 4096, 0}, {348, 4096, 0},
+    {298, 4096, 0}, {253, 4096, 0}, {212, 4096, 0}, {175, 4096, 0},
+    {142, 4096, 0}, {113, 4096, 0}, {88, 4096, 0}, {66, 4096, 0},
+    {48, 4096, 0}, {33, 4096, 0}, {21, 4096, 0}, {12, 4096, 0},
+    {5, 4096, 0}, {0, 4096, 2}, {0, 4096, 10}, {0, 4096, 18},
+    {0, 4096, 29}, {0, 4096, 43}, {0, 4096, 60}, {0, 4096, 80},
+    {0, 4096, 104}, {0, 4096, 132}, {0, 4096, 163}, {0, 4096, 199},
+    {0, 4096, 239}, {0, 4096, 283}, {0, 4096, 331}, {0, 4096, 384},
+    {0, 4096, 442}, {0, 4096, 504}, {0, 4096, 572}, {0, 4096, 644},
+    {0, 4096, 721}, {0, 4096, 804}, {0, 4096, 892}, {0, 4096, 985},
+    {0, 4096, 1083}, {0, 4096, 1188}, {0, 4096, 1297}, {0, 4096, 1413},
+    {0, 4096, 1534}, {0, 4096, 1661}, {0, 4096, 1794}, {0, 4096, 1933},
+    {0, 4096, 2078}, {0, 4096, 2229}, {0, 4096, 2387}, {0, 4096, 2551},
+    {0, 4096, 2721}, {0, 4096, 2897}, {0, 4096, 3080}, {0, 4096, 3270},
+    {0, 4096, 3466}, {0, 4096, 3669}, {0, 4096, 3879}, {0, 4096, 4096},
+    {0, 3879, 4096}, {0, 3669, 4096}, {0, 3466, 4096}, {0, 3270, 4096},
+    {0, 3080, 4096}, {0, 2897, 4096}, {0, 2721, 4096}, {0, 2551, 4096},
+    {0, 2387, 4096}, {0, 2229, 4096}, {0, 2078, 4096}, {0, 1933, 4096},
+    {0, 1794, 4096}, {0, 1661, 4096}, {0, 1534, 4096}, {0, 1413, 4096},
+    {0, 1297, 4096}, {0, 1188, 4096}, {0, 1083, 4096}, {0, 985, 4096},
+    {0, 892, 4096}, {0, 804, 4096}, {0, 721, 4096}, {0, 644, 4096},
+    {0, 572, 4096}, {0, 504, 4096}, {0, 442, 4096}, {0, 384, 4096},
+    {0, 331, 4096}, {0, 283, 4096}, {0, 239, 4096}, {0, 199, 4096},
+    {0, 163, 4096}, {0, 132, 4096}, {0, 104, 4096}, {0, 80, 4096},
+    {0, 60, 4096}, {0, 43, 4096}, {0, 29, 4096}, {0, 18, 4096},
+    {0, 10, 4096}, {0, 2, 4096}, {5, 0, 4096}, {12, 0, 4096},
+    {21, 0, 4096}, {33, 0, 4096}, {48, 0, 4096}, {66, 0, 4096},
+    {88, 0, 4096}, {113, 0, 4096}, {142, 0, 4096}, {175, 0, 4096},
+    {212, 0, 4096}, {253, 0, 4096}, {298, 0, 4096}, {348, 0, 4096},
+    {403, 0, 4096}, {462, 0, 4096}, {526, 0, 4096}, {595, 0, 4096},
+    {669, 0, 4096}, {748, 0, 4096}, {833, 0, 4096}, {922, 0, 4096},
+    {1017, 0, 4096}, {1118, 0, 4096}, {1223, 0, 4096}, {1335, 0, 4096},
+    {1452, 0, 4096}, {1576, 0, 4096}, {1705, 0, 4096}, {1840, 0, 4096},
+    {1981, 0, 4096}, {2128, 0, 4096}, {2281, 0, 4096}, {2441, 0, 4096},
+    {2607, 0, 4096}, {2779, 0, 4096}, {2958, 0, 4096}, {3143, 0, 4096},
+    {3335, 0, 4096}, {3533, 0, 4096}, {3739, 0, 4096}, {3951, 0, 4096},
+    {4096, 0, 4023}, {4096, 0, 3809}, {4096, 0, 3601}, {4096, 0, 3400},
+    {4096, 0, 3206}, {4096, 0, 3019}, {4096, 0, 2838}, {4096, 0, 2663},
+    {4096, 0, 2495}, {4096, 0, 2334}, {4096, 0, 2178}, {4096, 0, 2029},
+    {4096, 0, 1886}, {4096, 0, 1749}, {4096, 0, 1618}, {4096, 0, 1493},
+    {4096, 0, 1374}, {4096, 0, 1260}, {4096, 0, 1152}, {4096, 0, 1050},
+    {4096, 0, 953}, {4096, 0, 862}, {4096, 0, 776}, {4096, 0, 695},
+    {4096, 0, 619}, {4096, 0, 549}, {4096, 0, 483}, {4096, 0, 422},
+    {4096, 0, 366}, {4096, 0, 315}, {4096, 0, 268}, {4096, 0, 225},
+    {4096, 0, 187}, {4096, 0, 152}, {4096, 0, 122}, {4096, 0, 96},
+    {4096, 0, 73}, {4096, 0, 54}, {4096, 0, 38}, {4096, 0, 25},
+    {4096, 0, 15}, {4096, 0, 7}, {4096, 0, 0},
+};
+
+const uint16_t XY_TO_RGB[XY_GRID][XY_GRID][3] = {
+    {
+        {0, 168, 4096}, {0, 398, 4096}, {0, 654, 4096}, {0, 931, 4096},
+        {0, 1233, 4096}, {0, 1563, 4096}, {0, 1924, 4096}, {0, 2322, 4096},
+        {0, 2761, 4096}, {0, 3251, 4096}, {0, 3798, 4096}, {0, 4096, 3800},
+        {0, 4096, 3280}, {0, 4096, 2836}, {0, 4096, 2452}, {0, 4096, 2117},
+        {0, 4096, 1822}, {0, 4096, 1561}, {0, 4096, 1327}, {0, 4096, 1117},
+        {0, 4096, 927}, {0, 4096, 755}, {0, 4096, 598}, {0, 4096, 454},
+        {0, 4096, 322}, {0, 4096, 200}, {0, 4096, 87}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0},
+    },
+    {
+        {0, 47, 4096}, {0, 279, 4096}, {0, 539, 4096}, {0, 821, 4096},
+        {0, 1129, 4096}, {0, 1466, 4096}, {0, 1836, 4096}, {0, 2246, 4096},
+        {0, 2701, 4096}, {0, 3210, 4096}, {0, 3781, 4096}, {0, 4096, 3788},
+        {0, 4096, 3245}, {0, 4096, 2785}, {0, 4096, 2390}, {0, 4096, 2047},
+        {0, 4096, 1746}, {0, 4096, 1480}, {0, 4096, 1244}, {0, 4096, 1032},
+        {0, 4096, 842}, {0, 4096, 669}, {0, 4096, 512}, {0, 4096, 368},
+        {0, 4096, 236}, {0, 4096, 115}, {0, 4096, 3}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0},
+    },
+    {
+        {0, 0, 4096}, {0, 153, 4096}, {0, 416, 4096}, {0, 703, 4096},
+        {0, 1016, 4096}, {0, 1361, 4096}, {0, 1742, 4096}, {0, 2164, 4096},
+        {0, 2635, 4096}, {0, 3164, 4096}, {0, 3763, 4096}, {0, 4096, 3774},
+        {0, 4096, 3207}, {0, 4096, 2729}, {0, 4096, 2322}, {0, 4096, 1971},
+        {0, 4096, 1665}, {0, 4096, 1395}, {0, 4096, 1156}, {0, 4096, 943},
+        {0, 4096, 751}, {0, 4096, 578}, {0, 4096, 421}, {0, 4096, 278},
+        {0, 4096, 147}, {0, 4096, 27}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0},
+    },
+    {
+        {0, 0, 4096}, {0, 18, 4096}, {0, 284, 4096}, {0, 576, 4096},
+        {0, 895, 4096}, {0, 1248, 4096}, {0, 1639, 4096}, {0, 2074, 4096},
+        {0, 2563, 4096}, {0, 3115, 4096}, {0, 3743, 4096}, {0, 4096, 3758},
+        {0, 4096, 3164}, {0, 4096, 2669}, {0, 4096, 2249}, {0, 4096, 1889},
+        {0, 4096, 1577}, {0, 4096, 1304}, {0, 4096, 1062}, {0, 4096, 848},
+        {0, 4096, 656}, {0, 4096, 483}, {0, 4096, 326}, {0, 4096, 184},
+        {0, 4096, 54}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0},
+    },
+    {
+        {0, 0, 4096}, {0, 0, 4096}, {0, 143, 4096}, {0, 439, 4096},
+        {0, 764, 4096}, {0, 1125, 4096}, {0, 1526, 4096}, {0, 1976, 4096},
+        {0, 2483, 4096}, {0, 3059, 4096}, {0, 3720, 4096}, {0, 4096, 3740},
+        {0, 4096, 3117}, {0, 4096, 2602}, {0, 4096, 2170}, {0, 4096, 1801},
+        {0, 4096, 1483}, {0, 4096, 1206}, {0, 4096, 962}, {0, 4096, 747},
+        {0, 4096, 554}, {0, 4096, 382}, {0, 4096, 226}, {0, 4096, 85},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0},
+    },
+    {
+        {385, 0, 4096}, {253, 0, 4096}, {103, 0, 4096}, {0, 291, 4096},
+        {0, 623, 4096}, {0, 991, 4096}, {0, 1403, 4096}, {0, 1868, 4096},
+        {0, 2395, 4096}, {0, 2998, 4096}, {0, 3695, 4096}, {0, 4096, 3721},
+        {0, 4096, 3065}, {0, 4096, 2529}, {0, 4096, 2083}, {0, 4096, 1705},
+        {0, 4096, 1381}, {0, 4096, 1101}, {0, 4096, 856}, {0, 4096, 639},
+        {0, 4096, 447}, {0, 4096, 275}, {0, 4096, 120}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0},
+    },
+    {
+        {951, 0, 4096}, {839, 0, 4096}, {713, 0, 4096}, {573, 131, 4096},
+        {418, 468, 4096}, {245, 845, 4096}, {50, 1269, 4096}, {0, 1748, 4096},
+        {0, 2297, 4096}, {0, 2929, 4096}, {0, 3666, 4096}, {0, 4096, 3699},
+        {0, 4096, 3007}, {0, 4096, 2448}, {0, 4096, 1987}, {0, 4096, 1600},
+        {0, 4096, 1271}, {0, 4096, 988}, {0, 4096, 741}, {0, 4096, 525},
+        {0, 4096, 333}, {0, 4096, 162}, {0, 4096, 9}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0},
+    },
+    {
+        {1558, 0, 4096}, {1472, 0, 4096}, {1373, 0, 4096}, {1263, 0, 4096},
+        {1141, 300, 4096}, {1004, 684, 4096}, {849, 1119, 4096}, {672, 1616, 4096},
+        {468, 2187, 4096}, {231, 2851, 4096}, {0, 3633, 4096}, {0, 4096, 3674},
+        {0, 4096, 2942}, {0, 4096, 2358}, {0, 4096, 1882}, {0, 4096, 1486},
+        {0, 4096, 1152}, {0, 4096, 866}, {0, 4096, 618}, {0, 4096, 402},
+        {0, 4096, 211}, {0, 4096, 42}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0},
+    },
+    {
+        {2213, 0, 4096}, {2155, 0, 4096}, {2089, 0, 4096}, {2016, 0, 4096},
+        {1933, 115, 4096}, {1840, 507, 4096}, {1734, 954, 4096}, {1613, 1467, 4096},
+        {1472, 2063, 4096}, {1306, 2762, 4096}, {1108, 3595, 4096}, {773, 4096, 3645},
+        {401, 4096, 2868}, {109, 4096, 2258}, {0, 4096, 1766}, {0, 4096, 1361},
+        {0, 4096, 1022}, {0, 4096, 734}, {0, 4096, 486}, {0, 4096, 270},
+        {0, 4096, 81}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0},
+    },
+    {
+        {2921, 0, 4096}, {2897, 0, 4096}, {2870, 0, 4096}, {2840, 0, 4096},
+        {2806, 0, 4096}, {2767, 311, 4096}, {2723, 770, 4096}, {2672, 1300, 4096},
+        {2612, 1922, 4096}, {2540, 2660, 4096}, {2454, 3551, 4096}, {2070, 4096, 3611},
+        {1505, 4096, 2783}, {1069, 4096, 2145}, {722, 4096, 1637}, {439, 4096, 1223},
+        {205, 4096, 880}, {7, 4096, 590}, {0, 4096, 343}, {0, 4096, 129},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0},
+    },
+    {
+        {3688, 0, 4096}, {3705, 0, 4096}, {3725, 0, 4096}, {3747, 0, 4096},
+        {3772, 0, 4096}, {3801, 93, 4096}, {3834, 562, 4096}, {3873, 1111, 4096},
+        {3918, 1761, 4096}, {3974, 2542, 4096}, {4041, 3498, 4096}, {3597, 4096, 3571},
+        {2777, 4096, 2686}, {2157, 4096, 2016}, {1671, 4096, 1492}, {1280, 4096, 1070},
+        {959, 4096, 724}, {691, 4096, 434}, {463, 4096, 188}, {268, 4096, 0},
+        {98, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0},
+    },
+    {
+        {4096, 0, 3709}, {4096, 0, 3657}, {4096, 0, 3598}, {4096, 0, 3533},
+        {4096, 0, 3462}, {4096, 0, 3383}, {4096, 264, 3296}, {4096, 699, 3199},
+        {4096, 1187, 3089}, {4096, 1740, 2966}, {4096, 2370, 2825}, {4096, 3095, 2662},
+        {4096, 3939, 2474}, {3401, 4096, 1869}, {2741, 4096, 1329}, {2217, 4096, 900},
+        {1792, 4096, 551}, {1440, 4096, 263}, {1143, 4096, 20}, {889, 4096, 0},
+        {671, 4096, 0}, {480, 4096, 0}, {312, 4096, 0}, {163, 4096, 0},
+        {30, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0},
+    },
+    {
+        {4096, 0, 3087}, {4096, 0, 3019}, {4096, 0, 2943}, {4096, 0, 2862},
+        {4096, 0, 2773}, {4096, 0, 2677}, {4096, 38, 2572}, {4096, 387, 2457},
+        {4096, 771, 2330}, {4096, 1196, 2189}, {4096, 1668, 2033}, {4096, 2197, 1859},
+        {4096, 2792, 1662}, {4096, 3468, 1439}, {3956, 4096, 1143}, {3267, 4096, 709},
+        {2715, 4096, 360}, {2262, 4096, 75}, {1884, 4096, 0}, {1563, 4096, 0},
+        {1288, 4096, 0}, {1050, 4096, 0}, {841, 4096, 0}, {656, 4096, 0},
+        {492, 4096, 0}, {345, 4096, 0}, {212, 4096, 0}, {92, 4096, 0},
+        {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0}, {0, 4096, 0},
+        {0, 4096, 0},
+    },
+    {
+        {4096, 0, 2608}, {4096, 0, 2532}, {4096, 0, 2449}, {4096, 0, 2361},
+        {4096, 0, 2265}, {4096, 0, 2163}, {4096, 0, 2053}, {4096, 167, 1933},
+        {4096, 482, 1803}, {4096, 826, 1662}, {4096, 1202, 1508}, {4096, 1615, 1338},
+        {4096, 2070, 1151}, {4096, 2575, 944}, {4096, 3137, 713}, {4096, 3768, 454},
+        {3745, 4096, 147}, {3171, 4096, 0}, {2696, 4096, 0}, {2297, 4096, 0},
+        {1956, 4096, 0}, {1663, 4096, 0}, {1407, 4096, 0}, {1182, 4096, 0},
+        {983, 4096, 0}, {805, 4096, 0}, {645, 4096, 0}, {501, 4096, 0},
+        {370, 4096, 0}, {251, 4096, 0}, {142, 4096, 0}, {42, 4096, 0},
+        {0, 4096, 0},
+    },
+    {
+        {4096, 0, 2227}, {4096, 0, 2148}, {4096, 0, 2063}, {4096, 0, 1972},
+        {4096, 0, 1875}, {4096, 0, 1772}, {4096, 0, 1662}, {4096, 3, 1544},
+        {4096, 271, 1417}, {4096, 559, 1281}, {4096, 870, 1133}, {4096, 1207, 974},
+        {4096, 1574, 800}, {4096, 1973, 611}, {4096, 2411, 403}, {4096, 2892, 175},
+        {4096, 3424, 0}, {4096, 4015, 0}, {3589, 4096, 0}, {3097, 4096, 0},
+        {2681, 4096, 0}, {2324, 4096, 0}, {2015, 4096, 0}, {1744, 4096, 0},
+        {1505, 4096, 0}, {1293, 4096, 0}, {1103, 4096, 0}, {932, 4096, 0},
+        {777, 4096, 0}, {636, 4096, 0}, {508, 4096, 0}, {390, 4096, 0},
+        {282, 4096, 0},
+    },
+    {
+        {4096, 0, 1917}, {4096, 0, 1838}, {4096, 0, 1753}, {4096, 0, 1662},
+        {4096, 0, 1567}, {4096, 0, 1465}, {4096, 0, 1358}, {4096, 0, 1244},
+        {4096, 109, 1122}, {4096, 357, 992}, {4096, 622, 853}, {4096, 906, 704},
+        {4096, 1211, 544}, {4096, 1541, 371}, {4096, 1897, 184}, {4096, 2283, 0},
+        {4096, 2703, 0}, {4096, 3163, 0}, {4096, 3666, 0}, {3974, 4096, 0},
+        {3469, 4096, 0}, {3039, 4096, 0}, {2669, 4096, 0}, {2346, 4096, 0},
+        {2063, 4096, 0}, {1812, 4096, 0}, {1588, 4096, 0}, {1387, 4096, 0},
+        {1206, 4096, 0}, {1042, 4096, 0}, {892, 4096, 0}, {755, 4096, 0},
+        {630, 4096, 0},
+    },
+    {
+        {4096, 0, 1660}, {4096, 0, 1582}, {4096, 0, 1498}, {4096, 0, 1409},
+        {4096, 0, 1316}, {4096, 0, 1218}, {4096, 0, 1114}, {4096, 0, 1005},
+        {4096, 0, 889}, {4096, 198, 766}, {4096, 429, 635}, {4096, 674, 496},
+        {4096, 935, 348}, {4096, 1215, 190}, {4096, 1514, 21}, {4096, 1835, 0},
+        {4096, 2181, 0}, {4096, 2554, 0}, {4096, 2957, 0}, {4096, 3396, 0},
+        {4096, 3874, 0}, {3816, 4096, 0}, {3375, 4096, 0}, {2993, 4096, 0},
+        {2659, 4096, 0}, {2365, 4096, 0}, {2103, 4096, 0}, {1869, 4096, 0},
+        {1659, 4096, 0}, {1469, 4096, 0}, {1296, 4096, 0}, {1138, 4096, 0},
+        {993, 4096, 0},
+    },
+    {
+        {4096, 0, 1443}, {4096, 0, 1367}, {4096, 0, 1285}, {4096, 0, 1198},
+        {4096, 0, 1108}, {4096, 0, 1014}, {4096, 0, 914}, {4096, 0, 810},
+        {4096, 0, 700}, {4096, 71, 584}, {4096, 274, 461}, {4096, 490, 332},
+        {4096, 718, 195}, {4096, 960, 49}, {4096, 1218, 0}, {4096, 1492, 0},
+        {4096, 1784, 0}, {4096, 2097, 0}, {4096, 2432, 0}, {4096, 2792, 0},
+        {4096, 3180, 0}, {4096, 3599, 0}, {4096, 4054, 0}, {3689, 4096, 0},
+        {3298, 4096, 0}, {2955, 4096, 0}, {2651, 4096, 0}, {2380, 4096, 0},
+        {2137, 4096, 0}, {1918, 4096, 0}, {1720, 4096, 0}, {1539, 4096, 0},
+        {1374, 4096, 0},
+    },
+    {
+        {4096, 0, 1258}, {4096, 0, 1184}, {4096, 0, 1104}, {4096, 0, 1021},
+        {4096, 0, 934}, {4096, 0, 843}, {4096, 0, 748}, {4096, 0, 648},
+        {4096, 0, 544}, {4096, 0, 434}, {4096, 148, 319}, {4096, 340, 198},
+        {4096, 543, 70}, {4096, 756, 0}, {4096, 982, 0}, {4096, 1220, 0},
+        {4096, 1473, 0}, {4096, 1741, 0}, {4096, 2027, 0}, {4096, 2331, 0},
+        {4096, 2656, 0}, {4096, 3004, 0}, {4096, 3377, 0}, {4096, 3778, 0},
+        {3984, 4096, 0}, {3586, 4096, 0}, {3234, 4096, 0}, {2923, 4096, 0},
+        {2644, 4096, 0}, {2393, 4096, 0}, {2167, 4096, 0}, {1961, 4096, 0},
+        {1773, 4096, 0},
+    },
+    {
+        {4096, 0, 1098}, {4096, 0, 1026}, {4096, 0, 949}, {4096, 0, 868},
+        {4096, 0, 784}, {4096, 0, 697}, {4096, 0, 606}, {4096, 0, 512},
+        {4096, 0, 413}, {4096, 0, 309}, {4096, 43, 201}, {4096, 216, 87},
+        {4096, 398, 0}, {4096, 589, 0}, {4096, 789, 0}, {4096, 1000, 0},
+        {4096, 1222, 0}, {4096, 1457, 0}, {4096, 1705, 0}, {4096, 1967, 0},
+        {4096, 2246, 0}, {4096, 2542, 0}, {4096, 2857, 0}, {4096, 3193, 0},
+        {4096, 3552, 0}, {4096, 3936, 0}, {3858, 4096, 0}, {3500, 4096, 0},
+        {3181, 4096, 0}, {2895, 4096, 0}, {2638, 4096, 0}, {2405, 4096, 0},
+        {2193, 4096, 0},
+    },
+    {
+        {4096, 0, 958}, {4096, 0, 889}, {4096, 0, 814}, {4096, 0, 736},
+        {4096, 0, 656}, {4096, 0, 572}, {4096, 0, 485}, {4096, 0, 395},
+        {4096, 0, 301}, {4096, 0, 203}, {4096, 0, 100}, {4096, 112, 0},
+        {4096, 277, 0}, {4096, 449, 0}, {4096, 629, 0}, {4096, 818, 0},
+        {4096, 1016, 0}, {4096, 1224, 0}, {4096, 1443, 0}, {4096, 1673, 0},
+        {4096, 1916, 0}, {4096, 2173, 0}, {4096, 2445, 0}, {4096, 2732, 0},
+        {4096, 3038, 0}, {4096, 3362, 0}, {4096, 3708, 0}, {4096, 4077, 0},
+        {3751, 4096, 0}, {3427, 4096, 0}, {3135, 4096, 0}, {2872, 4096, 0},
+        {2633, 4096, 0},
+    },
+    {
+        {4096, 0, 836}, {4096, 0, 768}, {4096, 0, 696}, {4096, 0, 621},
+        {4096, 0, 544}, {4096, 0, 463}, {4096, 0, 380}, {4096, 0, 294},
+        {4096, 0, 204}, {4096, 0, 111}, {4096, 0, 15}, {4096, 23, 0},
+        {4096, 173, 0}, {4096, 330, 0}, {4096, 494, 0}, {4096, 665, 0},
+        {4096, 843, 0}, {4096, 1030, 0}, {4096, 1226, 0}, {4096, 1431, 0},
+        {4096, 1646, 0}, {4096, 1872, 0}, {4096, 2110, 0}, {4096, 2361, 0},
+        {4096, 2626, 0}, {4096, 2906, 0}, {4096, 3202, 0}, {4096, 3516, 0},
+        {4096, 3849, 0}, {3991, 4096, 0}, {3661, 4096, 0}, {3365, 4096, 0},
+        {3096, 4096, 0},
+    },
+    {
+        {4096, 0, 727}, {4096, 0, 661}, {4096, 0, 591}, {4096, 0, 519},
+        {4096, 0, 445}, {4096, 0, 368}, {4096, 0, 288}, {4096, 0, 206},
+        {4096, 0, 121}, {4096, 0, 32}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 85, 0}, {4096, 228, 0}, {4096, 378, 0}, {4096, 534, 0},
+        {4096, 696, 0}, {4096, 866, 0}, {4096, 1042, 0}, {4096, 1227, 0},
+        {4096, 1420, 0}, {4096, 1622, 0}, {4096, 1834, 0}, {4096, 2056, 0},
+        {4096, 2289, 0}, {4096, 2534, 0}, {4096, 2792, 0}, {4096, 3064, 0},
+        {4096, 3351, 0}, {4096, 3655, 0}, {4096, 3977, 0}, {3885, 4096, 0},
+        {3584, 4096, 0},
+    },
+    {
+        {4096, 0, 629}, {4096, 0, 566}, {4096, 0, 498}, {4096, 0, 429},
+        {4096, 0, 357}, {4096, 0, 284}, {4096, 0, 207}, {4096, 0, 128},
+        {4096, 0, 47}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 7, 0}, {4096, 140, 0}, {4096, 278, 0}, {4096, 421, 0},
+        {4096, 570, 0}, {4096, 725, 0}, {4096, 886, 0}, {4096, 1053, 0},
+        {4096, 1228, 0}, {4096, 1410, 0}, {4096, 1601, 0}, {4096, 1799, 0},
+        {4096, 2007, 0}, {4096, 2225, 0}, {4096, 2453, 0}, {4096, 2693, 0},
+        {4096, 2945, 0}, {4096, 3209, 0}, {4096, 3488, 0}, {4096, 3782, 0},
+        {4096, 4093, 0},
+    },
+    {
+        {4096, 0, 542}, {4096, 0, 480}, {4096, 0, 415}, {4096, 0, 348},
+        {4096, 0, 279}, {4096, 0, 208}, {4096, 0, 135}, {4096, 0, 59},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 63, 0}, {4096, 191, 0}, {4096, 323, 0},
+        {4096, 460, 0}, {4096, 603, 0}, {4096, 751, 0}, {4096, 904, 0},
+        {4096, 1063, 0}, {4096, 1229, 0}, {4096, 1402, 0}, {4096, 1582, 0},
+        {4096, 1769, 0}, {4096, 1965, 0}, {4096, 2169, 0}, {4096, 2382, 0},
+        {4096, 2606, 0}, {4096, 2840, 0}, {4096, 3085, 0}, {4096, 3343, 0},
+        {4096, 3614, 0},
+    },
+    {
+        {4096, 0, 463}, {4096, 0, 403}, {4096, 0, 340}, {4096, 0, 276},
+        {4096, 0, 209}, {4096, 0, 141}, {4096, 0, 70}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 114, 0}, {4096, 237, 0},
+        {4096, 364, 0}, {4096, 496, 0}, {4096, 633, 0}, {4096, 774, 0},
+        {4096, 920, 0}, {4096, 1073, 0}, {4096, 1230, 0}, {4096, 1394, 0},
+        {4096, 1565, 0}, {4096, 1742, 0}, {4096, 1926, 0}, {4096, 2119, 0},
+        {4096, 2319, 0}, {4096, 2528, 0}, {4096, 2747, 0}, {4096, 2976, 0},
+        {4096, 3215, 0},
+    },
+    {
+        {4096, 0, 391}, {4096, 0, 333}, {4096, 0, 273}, {4096, 0, 210},
+        {4096, 0, 146}, {4096, 0, 80}, {4096, 0, 12}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 45, 0}, {4096, 160, 0},
+        {4096, 279, 0}, {4096, 402, 0}, {4096, 529, 0}, {4096, 660, 0},
+        {4096, 795, 0}, {4096, 935, 0}, {4096, 1081, 0}, {4096, 1231, 0},
+        {4096, 1387, 0}, {4096, 1549, 0}, {4096, 1717, 0}, {4096, 1892, 0},
+        {4096, 2074, 0}, {4096, 2263, 0}, {4096, 2459, 0}, {4096, 2665, 0},
+        {4096, 2879, 0},
+    },
+    {
+        {4096, 0, 325}, {4096, 0, 270}, {4096, 0, 211}, {4096, 0, 150},
+        {4096, 0, 88}, {4096, 0, 25}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 92, 0},
+        {4096, 203, 0}, {4096, 318, 0}, {4096, 436, 0}, {4096, 558, 0},
+        {4096, 684, 0}, {4096, 815, 0}, {4096, 949, 0}, {4096, 1088, 0},
+        {4096, 1232, 0}, {4096, 1381, 0}, {4096, 1535, 0}, {4096, 1695, 0},
+        {4096, 1861, 0}, {4096, 2033, 0}, {4096, 2212, 0}, {4096, 2398, 0},
+        {4096, 2591, 0},
+    },
+    {
+        {4096, 0, 265}, {4096, 0, 211}, {4096, 0, 154}, {4096, 0, 96},
+        {4096, 0, 36}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 31, 0},
+        {4096, 135, 0}, {4096, 243, 0}, {4096, 354, 0}, {4096, 468, 0},
+        {4096, 586, 0}, {4096, 707, 0}, {4096, 832, 0}, {4096, 962, 0},
+        {4096, 1095, 0}, {4096, 1233, 0}, {4096, 1375, 0}, {4096, 1523, 0},
+        {4096, 1675, 0}, {4096, 1833, 0}, {4096, 1996, 0}, {4096, 2166, 0},
+        {4096, 2342, 0},
+    },
+    {
+        {4096, 0, 210}, {4096, 0, 158}, {4096, 0, 103}, {4096, 0, 46},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 74, 0}, {4096, 176, 0}, {4096, 280, 0}, {4096, 387, 0},
+        {4096, 498, 0}, {4096, 611, 0}, {4096, 728, 0}, {4096, 849, 0},
+        {4096, 973, 0}, {4096, 1101, 0}, {4096, 1233, 0}, {4096, 1370, 0},
+        {4096, 1511, 0}, {4096, 1657, 0}, {4096, 1807, 0}, {4096, 1963, 0},
+        {4096, 2124, 0},
+    },
+    {
+        {4096, 0, 159}, {4096, 0, 109}, {4096, 0, 55}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 19, 0}, {4096, 115, 0}, {4096, 213, 0}, {4096, 314, 0},
+        {4096, 418, 0}, {4096, 525, 0}, {4096, 635, 0}, {4096, 748, 0},
+        {4096, 864, 0}, {4096, 984, 0}, {4096, 1107, 0}, {4096, 1234, 0},
+        {4096, 1365, 0}, {4096, 1500, 0}, {4096, 1640, 0}, {4096, 1784, 0},
+        {4096, 1932, 0},
+    },
+    {
+        {4096, 0, 112}, {4096, 0, 63}, {4096, 0, 11}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 59, 0}, {4096, 152, 0}, {4096, 248, 0},
+        {4096, 346, 0}, {4096, 447, 0}, {4096, 550, 0}, {4096, 657, 0},
+        {4096, 766, 0}, {4096, 878, 0}, {4096, 994, 0}, {4096, 1112, 0},
+        {4096, 1235, 0}, {4096, 1361, 0}, {4096, 1490, 0}, {4096, 1624, 0},
+        {4096, 1762, 0},
+    },
+    {
+        {4096, 0, 69}, {4096, 0, 21}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0}, {4096, 0, 0},
+        {4096, 0, 0}, {4096, 8, 0}, {4096, 97, 0}, {4096, 188, 0},
+        {4096, 281, 0}, {4096, 376, 0}, {4096, 474, 0}, {4096, 574, 0},
+        {4096, 677, 0}, {4096, 783, 0}, {4096, 891, 0}, {4096, 1003, 0},
+        {4096, 1117, 0}, {4096, 1235, 0}, {4096, 1357, 0}, {4096, 1481, 0},
+        {4096, 1610, 0},
+    },
+};
+
+const uint16_t MIRED_TO_RGB[MIRED_COUNT][3] = {
+    {4054, 3851, 4096}, {4096, 3778, 3830}, {4096, 3667, 3542}, {4096, 3558, 3274},
+    {4096, 3452, 3024}, {4096, 3348, 2793}, {4096, 3247, 2577}, {4096, 3148, 2378},
+    {4096, 3052, 2192}, {4096, 2959, 2021}, {4096, 2869, 1862}, {4096, 2781, 1714},
+    {4096, 2696, 1578}, {4096, 2614, 1450}, {4096, 2537, 1333}, {4096, 2461, 1226},
+    {4096, 2389, 1127}, {4096, 2319, 1035}, {4096, 2251, 951}, {4096, 2185, 873},
+    {4096, 2121, 800}, {4096, 2059, 733}, {4096, 1999, 671}, {4096, 1941, 613},
+    {4096, 1885, 560}, {4096, 1830, 510}, {4096, 1776, 464}, {4096, 1725, 422},
+    {4096, 1674, 382}, {4096, 1625, 345}, {4096, 1577, 311}, {4096, 1531, 280},
+    {4096, 1486, 250}, {4096, 1442, 223}, {4096, 1400, 197}, {4096, 1358, 174},
+    {4096, 1318, 152}, {4096, 1279, 132}, {4096, 1241, 113}, {4096, 1204, 96},
+    {4096, 1168, 80}, {4096, 1133, 65}, {4096, 1099, 51}, {4096, 1066, 39},
+    {4096, 1034, 27},
+};
+
+const uint16_t MIRED_TO_COOL[MIRED_COUNT] = {
+    4096, 3933, 3719, 3510, 3305, 3105, 2910, 2720, 2535, 2356, 2182, 2013,
+    1850, 1690, 1538, 1391, 1251, 1116, 986, 861, 741, 626, 515, 409,
+    306, 208, 113, 22, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+} // namespace color_tables
@@ -0,0 +1,191 @@
+"""ColorControl の色（色相・彩度，xy，色温度）と明るさを，LEDの出力の割合に変える表を作る．
+
+浮動小数点の色空間の変換（sRGB の逆ガンマ，xy → XYZ → RGB の行列，黒体軌跡の近似）は
+ESP32-C3（FPUなし）では重いので，ここで前もって計算し，固定小数点の表として src/color_tables.cpp に書く．
+ファームウェアは表を引いて，隣の要素と線形（xy は双線形）に補間するだけにする．
+
+表の大きさと固定小数点の形式は include/color_tables.h と合わせること．値はどれも光の強さ（リニア）で，
+1 が ONE（Q12）．RGB は一番明るいチャネルが ONE になるように正規化する．
+RGB の原色は sRGB（D65）とみなす．LEDの原色が大きく違うなら XYZ_TO_RGB を測った値に替える．
+
+使い方（表を変えたら実行して，できたファイルをコミットする）:
+    python tools/color_tables.py [プロジェクトのディレクトリ]
+"""
+import math
+import os
+import sys
+
+OUTPUT = os.path.join("src", "color_tables.cpp")
+
+# include/color_tables.h と同じ値
+ONE = 4096
+LEVEL_COUNT = 255
+HUE_COUNT = 255
+XY_SHIFT = 11
+XY_GRID = (65536 >> XY_SHIFT) + 1
+MIRED_MIN = 152
+MIRED_SHIFT = 3
+MIRED_COUNT = 45
+# 調色（2色の白）のLEDの色温度 [mired]（2700K と 6500K）
+WARM_MIREDS = 370
+COOL_MIREDS = 154
+
+XYZ_TO_RGB = (
+    (3.2406, -1.5372, -0.4986),
+    (-0.9689, 1.8758, 0.0415),
+    (0.0557, -0.2040, 1.0570),
+)
+
+
+def srgb_to_linear(value):
+    """sRGB の符号化した値（0〜1）を光の強さにする"""
+    if value <= 0.04045:
+        return value / 12.92
+    return ((value + 0.055) / 1.055) ** 2.4
+
+
+def level_to_linear(level):
+    """Matter の明るさ（0〜254）を光の強さ（Q16）にする．明るさの段を CIE の明度 L* で等間隔にする"""
+    if level == 0:
+        return 0
+    lightness = 100.0 * level / 254
+    if lightness > 8:
+        luminance = ((lightness + 16) / 116) ** 3
+    else:
+        luminance = lightness / 903.3
+    return min(65535, round(luminance * 65535))
+
+
+def normalize(rgb):
+    """負の成分（表せない色）を0にし，一番明るいチャネルを ONE にする"""
+    rgb = [max(0.0, c) for c in rgb]
+    peak = max(rgb)
+    if peak <= 0:
+        return [ONE, ONE, ONE]
+    return [round(c / peak * ONE) for c in rgb]
+
+
+def hue_to_rgb(hue):
+    """Matter の色相（0〜254 で一周）の彩度最大の色．sRGB の色相環で求めて光の強さにする"""
+    degrees = hue * 360.0 / 254
+    sector = degrees / 60.0
+    ramp = 1 - abs(sector % 2 - 1)
+    encoded = [
+        (1, ramp, 0), (ramp, 1, 0), (0, 1, ramp), (0, ramp, 1), (ramp, 0, 1), (1, 0, ramp),
+    ][int(sector) % 6]
+    return normalize([srgb_to_linear(c) for c in encoded])
+
+
+def xy_to_rgb(x, y):
+    """色度 xy（明るさ Y = 1）の RGB"""
+    y = max(y, 1e-3)
+    xyz = (x / y, 1.0, (1 - x - y) / y)
+    return normalize([sum(m * v for m, v in zip(row, xyz)) for row in XYZ_TO_RGB])
+
+
+def planckian_xy(mireds):
+    """黒体軌跡の色度（Kim らの3次式．1667K〜25000K）"""
+    kelvin = 1e6 / mireds
+    t = 1e3 / kelvin
+    if kelvin <= 4000:
+        x = -0.2661239 * t ** 3 - 0.2343589 * t ** 2 + 0.8776956 * t + 0.179910
+    else:
+        x = -3.0258469 * t ** 3 + 2.1070379 * t ** 2 + 0.2226347 * t + 0.240390
+    if kelvin <= 2222:
+        y = -1.1063814 * x ** 3 - 1.34811020 * x ** 2 + 2.18555832 * x - 0.20219683
+    elif kelvin <= 4000:
+        y = -0.9549476 * x ** 3 - 1.37418593 * x ** 2 + 2.09137015 * x - 0.16748867
+    else:
+        y = 3.0817580 * x ** 3 - 5.87338670 * x ** 2 + 3.75112997 * x - 0.37001483
+    return x, y
+
+
+def cool_fraction(mireds):
+    """調色のLEDで色温度 mireds を出すときの，寒色のLEDの光の割合（Q12）
+
+    目標の色度を2つのLEDの色度を結ぶ線分に射影し，その点を作る光の強さの比を求める．
+    """
+    if mireds <= COOL_MIREDS:
+        return ONE
+    if mireds >= WARM_MIREDS:
+        return 0
+    wx, wy = planckian_xy(WARM_MIREDS)
+    cx, cy = planckian_xy(COOL_MIREDS)
+    px, py = planckian_xy(mireds)
+    dx, dy = cx - wx, cy - wy
+    t = ((px - wx) * dx + (py - wy) * dy) / (dx * dx + dy * dy)
+    t = min(1.0, max(0.0, t))
+    # 色度は Y/y の重みで混ざる（t = (Yc/cy) / (Yw/wy + Yc/cy)）
+    fraction = t * cy / ((1 - t) * wy + t * cy)
+    return round(fraction * ONE)
+
+
+def mired_at(index):
+    return MIRED_MIN + (index << MIRED_SHIFT)
+
+
+def format_rows(rows, indent="    ", per_line=8):
+    lines = []
+    for start in range(0, len(rows), per_line):
+        lines.append(indent + " ".join(rows[start:start + per_line]))
+    return "\n".join(lines)
+
+
+def rgb_rows(values):
+    return ["{%d, %d, %d}," % tuple(rgb) for rgb in values]
+
+
+def generate():
+    levels = [str(level_to_linear(level)) + "," for level in range(LEVEL_COUNT)]
+    hues = rgb_rows(hue_to_rgb(hue) for hue in range(HUE_COUNT))
+    xy = []
+    for ix in range(XY_GRID):
+        row = rgb_rows(xy_to_rgb((ix << XY_SHIFT) / 65536, (iy << XY_SHIFT) / 65536) for iy in range(XY_GRID))
+        xy.append("    {\n" + format_rows(row, indent="        ", per_line=4) + "\n    },")
+    mired_rgb = rgb_rows(xy_to_rgb(*planckian_xy(mired_at(i))) for i in range(MIRED_COUNT))
+    mired_cool = [str(cool_fraction(mired_at(i))) + "," for i in range(MIRED_COUNT)]
+
+    return "\n".join([
+        "/**",
+        " * @file color_tables.cpp",
+        " * @brief 色の変換表（tools/color_tables.py で生成．手で書き換えないこと）",
+        " */",
+        '#include "color_tables.h"',
+        "",
+        "namespace color_tables {",
+        "",
+        "const uint16_t LEVEL_TO_LINEAR[LEVEL_COUNT] = {",
+        format_rows(levels, per_line=12),
+        "};",
+        "",
+        "const uint16_t HUE_TO_RGB[HUE_COUNT][3] = {",
+        format_rows(hues, per_line=4),
+        "};",
+        "",
+        "const uint16_t XY_TO_RGB[XY_GRID][XY_GRID][3] = {",
+        "\n".join(xy),
+        "};",
+        "",
+        "const uint16_t MIRED_TO_RGB[MIRED_COUNT][3] = {",
+        format_rows(mired_rgb, per_line=4),
+        "};",
+        "",
+        "const uint16_t MIRED_TO_COOL[MIRED_COUNT] = {",
+        format_rows(mired_cool, per_line=12),
+        "};",
+        "",
+        "} // namespace color_tables",
+        "",
+    ])
+
+
+def main():
+    project = sys.argv[1] if len(sys.argv) > 1 else os.path.join(os.path.dirname(__file__), "..")
+    path = os.path.join(project, OUTPUT)
+    with open(path, "w", encoding="utf-8", newline="\n") as output:
+        output.write(generate())
+    print("wrote", os.path.normpath(path))
+
+
+if __name__ == "__main__":
+    main()